@@ -1,70 +1,67 @@
-CREATE TABLE firms (
-    id INTEGER PRIMARY KEY AUTOINCREMENT,
-    name TEXT UNIQUE
-);
-
-CREATE TABLE filings (
-    id INTEGER PRIMARY KEY AUTOINCREMENT,
-    firm_id INTEGER,
-    filing_date TEXT,
-    quarter TEXT,
-    created_at TEXT DEFAULT CURRENT_TIMESTAMP,
-    FOREIGN KEY(firm_id) REFERENCES firms(id)
-);
-
-CREATE TABLE holdings (
-    id INTEGER PRIMARY KEY AUTOINCREMENT,
-    filing_id INTEGER,
-    cusip TEXT,
-    name_of_issuer TEXT,
-    shares INTEGER,
-    value INTEGER,
-    put_call TEXT,
-    created_at TEXT DEFAULT CURRENT_TIMESTAMP,
-    UNIQUE(filing_id, cusip),
-    FOREIGN KEY(filing_id) REFERENCES filings(id)
-);
-
-CREATE VIEW quarter_firm_stats AS
-SELECT
-    f.quarter,
-    fi.name AS firm_name,
-    SUM(h.value) AS total_value,
-    SUM(h.shares) AS total_shares,
-    COUNT(*) AS num_holdings
-FROM holdings h
-JOIN filings f ON h.filing_id = f.id
-JOIN firms fi ON f.firm_id = fi.id
-GROUP BY f.quarter, fi.name;
-
--- Optional for performance
-CREATE INDEX idx_filings_firm_quarter ON filings(firm_id, quarter);
-CREATE INDEX idx_holdings_filing_cusip ON holdings(filing_id, cusip);
-CREATE INDEX idx_holdings_cusip ON holdings(cusip); -- for fast issuer-wide queries
+-- The holdings.db schema is defined in schema.cc as versioned migrations
+-- (tracked in PRAGMA user_version) and applied by FinanceApp on startup.
+-- Current layout, for reference:
+--
+--   firms(id, cik UNIQUE, name)   name is the latest one filed under the CIK
+--   firm_names(firm_id -> firms, name, first_quarter, last_quarter)
+--   filings(id, firm_id -> firms, filing_date, quarter, created_at, accession, cik,
+--           form_type, period_of_report, amendment_type)
+--   securities(id, cusip UNIQUE, name_of_issuer, title_of_class)
+--              id is the CUSIP packed into an integer (see securities.h)
+--   holdings(id, filing_id -> filings, security_id -> securities, shares, value,
+--            put_call, UNIQUE(filing_id, security_id, put_call))
+--            one row per position: rows filed for the same CUSIP and put/call
+--            are summed; put_call is '' for shares
+--   holdings_detail(filing_id, line, security_id, title_of_class, shares, shares_type,
+--                   value, put_call, investment_discretion, other_manager,
+--                   voting_sole, voting_shared, voting_none)
+--            the rows as filed, only with --line-detail
+--   quarter_firm_stats(quarter, firm_id, firm_name, total_value, total_shares, num_holdings)
+--   issuer_quarter_stats(quarter, security_id, total_value, total_shares, num_holders)
+--            over share positions only; put and call rows are left out
+--   quarter_stats(quarter, num_filings, total_value, total_shares, num_holdings)
+--   meta(key, value)   holdings_version: bumped by each writer batch that changes holdings;
+--                      bulk_load: present while --bulk-load has the secondary indexes dropped
+--   ingest_ledger(accession, cik, form_type, firm_name, quarter, state, attempts,
+--                 error, next_attempt_at, updated_at)
+--
+-- The *_stats tables are maintained by FinanceApp as filings are written;
+-- do not insert into holdings by hand without updating them.
+--
+-- Indexes: idx_firms_name, idx_filings_firm_quarter, idx_filings_quarter,
+--          idx_holdings_filing_security (filing_id, security_id, shares, value),
+--          idx_holdings_security (security_id, filing_id, shares, value)
 
 /* -- usful prompts to show information after ./sqlite3.exe holdings.db
 SELECT
-  MIN(h.name_of_issuer) AS issuer_name,
+  MIN(s.name_of_issuer) AS issuer_name,
   SUM(h.shares) AS total_shares,
   SUM(h.value) AS total_value
 FROM holdings h
-WHERE LOWER(h.name_of_issuer) LIKE '%ast space%';
+JOIN securities s ON h.security_id = s.id
+WHERE LOWER(s.name_of_issuer) LIKE '%ast space%';
 
 
+-- Grouped on the integer key; names are joined to the aggregated rows only
 SELECT
-  RANK() OVER (ORDER BY SUM(h.value) DESC) AS rank,
-  h.name_of_issuer AS issuer_name,
-  SUM(h.shares) AS total_shares,
-  SUM(h.value) AS total_value
-FROM holdings h
-GROUP BY h.name_of_issuer
-ORDER BY total_value DESC;
+  RANK() OVER (ORDER BY t.total_value DESC) AS rank,
+  s.name_of_issuer AS issuer_name,
+  t.total_shares,
+  t.total_value
+FROM (
+  SELECT security_id, SUM(shares) AS total_shares, SUM(value) AS total_value
+  FROM holdings
+  GROUP BY security_id
+) t
+JOIN securities s ON t.security_id = s.id
+ORDER BY t.total_value DESC;
 
 
 */
 /*
-SELECT h.*
+SELECT s.cusip, s.name_of_issuer, h.shares, h.value, h.put_call
 FROM holdings h
+JOIN securities s ON h.security_id = s.id
 JOIN filings f ON h.filing_id = f.id
 JOIN firms fi ON f.firm_id = fi.id
 WHERE fi.name = 'TRAN CAPITAL MANAGEMENT, L.P.';
@@ -73,17 +70,19 @@ WHERE fi.name = 'TRAN CAPITAL MANAGEMENT, L.P.';
 /* try this when you have downloaded data from multiple quarters.
 -- Compare how many shares of AAPL a firm held in Q2 vs Q3
 SELECT
-    h.name_of_issuer,
+    s.name_of_issuer,
     SUM(CASE WHEN f.quarter = '2025Q1' THEN h.value ELSE 0 END) AS q1_holdings,
     SUM(CASE WHEN f.quarter = '2025Q2' THEN h.value ELSE 0 END) AS q2_holdings
 FROM
     holdings h
 JOIN
     filings f ON h.filing_id = f.id
+JOIN
+    securities s ON h.security_id = s.id
 WHERE
     f.quarter IN ('2025Q1', '2025Q2')
 GROUP BY
-    h.name_of_issuer
+    s.name_of_issuer
 ORDER BY
     q2_holdings DESC;
 
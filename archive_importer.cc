@@ -0,0 +1,614 @@
+#include "archive_importer.h"
+#include "archive_reader.h"
+#include "bounded_queue.h"
+#include "holder_index.h"
+#include "holdings_writer.h"
+#include "infotable_parser.h"
+#include "metrics.h"
+#include "submission_parser.h"
+#include <atomic>
+#include <cctype>
+#include <charconv>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <optional>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+
+using namespace std;
+
+namespace {
+
+// INFOTABLE.tsv goes to the parsers in blocks of about this size, cut between
+// accessions so that no filing is split across two jobs
+const size_t kRowBlock = 1 << 20;
+
+struct ImportJob {
+    enum class Kind { Submission, XmlFolder, InfoTableRows };
+    Kind kind;
+    string source;                              // entry or folder name, for messages
+    vector<string> names;                       // one per document
+    vector<string> documents;                   // filled by the worker for zip entries
+    vector<const ZipArchive::Entry*> zipEntries;
+};
+
+enum class EntryKind { Skip, Submission, Xml };
+
+bool endsWith(const string& s, const char* suffix) {
+    size_t n = strlen(suffix);
+    return s.size() >= n && s.compare(s.size() - n, n, suffix) == 0;
+}
+
+string lower(string s) {
+    for (char& c : s) c = static_cast<char>(tolower(static_cast<unsigned char>(c)));
+    return s;
+}
+
+string baseName(const string& path) {
+    size_t slash = path.rfind('/');
+    return slash == string::npos ? path : path.substr(slash + 1);
+}
+
+string dirName(const string& path) {
+    size_t slash = path.rfind('/');
+    return slash == string::npos ? "" : path.substr(0, slash);
+}
+
+EntryKind classify(const string& name) {
+    string n = lower(name);
+    if (endsWith(n, ".txt") || endsWith(n, ".nc")) return EntryKind::Submission;
+    if (endsWith(n, ".xml")) return EntryKind::Xml;
+    return EntryKind::Skip;
+}
+
+bool isHoldingsReport(const string& formType) {
+    return formType == "13F-HR" || formType == "13F-HR/A";
+}
+
+// "000199937125008914" -> "0001999371-25-008914"
+string accessionFromFolder(const string& dir) {
+    string name = baseName(dir);
+    if (name.size() != 18 || name.find_first_not_of("0123456789") != string::npos) return "";
+    return name.substr(0, 10) + "-" + name.substr(10, 2) + "-" + name.substr(12);
+}
+
+// "30-JUN-2025" -> "2025-06-30", as the 13F data sets write dates
+string isoDateDmy(string_view d) {
+    static const char* kMonths[] = {"JAN", "FEB", "MAR", "APR", "MAY", "JUN",
+                                    "JUL", "AUG", "SEP", "OCT", "NOV", "DEC"};
+    if (d.size() != 11 || d[2] != '-' || d[6] != '-') return string(d);
+    string month;
+    for (int i = 0; i < 3; ++i) month += static_cast<char>(toupper(static_cast<unsigned char>(d[3 + i])));
+    for (int m = 0; m < 12; ++m) {
+        if (month != kMonths[m]) continue;
+        char mm[3] = {static_cast<char>('0' + (m + 1) / 10), static_cast<char>('0' + (m + 1) % 10), 0};
+        return string(d.substr(7, 4)) + "-" + mm + "-" + string(d.substr(0, 2));
+    }
+    return string(d);
+}
+
+long long toInteger(string_view s) {
+    long long v = 0;
+    from_chars(s.data(), s.data() + s.size(), v);
+    return v;
+}
+
+void splitTabs(string_view line, vector<string_view>& fields) {
+    fields.clear();
+    size_t start = 0;
+    for (;;) {
+        size_t tab = line.find('\t', start);
+        if (tab == string_view::npos) {
+            fields.push_back(line.substr(start));
+            return;
+        }
+        fields.push_back(line.substr(start, tab - start));
+        start = tab + 1;
+    }
+}
+
+string_view field(const vector<string_view>& fields, size_t column) {
+    return column < fields.size() ? fields[column] : string_view();
+}
+
+// One field of a tab-separated line, without splitting the rest
+string_view field(string_view line, size_t column) {
+    for (size_t i = 0; i < column && !line.empty(); ++i) {
+        size_t tab = line.find('\t');
+        line = tab == string_view::npos ? string_view() : line.substr(tab + 1);
+    }
+    return line.substr(0, line.find('\t'));
+}
+
+// Column positions by header name, so added or reordered columns are harmless
+class TsvHeader {
+public:
+    explicit TsvHeader(string_view line) {
+        vector<string_view> names;
+        splitTabs(line, names);
+        for (size_t i = 0; i < names.size(); ++i) columns_.emplace(string(names[i]), i);
+    }
+    size_t operator[](const char* name) const {
+        auto it = columns_.find(name);
+        return it == columns_.end() ? string::npos : it->second;
+    }
+
+private:
+    unordered_map<string, size_t> columns_;
+};
+
+// Splits a chunked stream into lines, without the newline or a trailing '\r'
+class LineSplitter {
+public:
+    explicit LineSplitter(function<void(string_view)> onLine) : onLine_(std::move(onLine)) {}
+
+    void feed(const char* data, size_t len) {
+        const char* end = data + len;
+        while (data < end) {
+            const char* nl = static_cast<const char*>(memchr(data, '\n', end - data));
+            if (!nl) {
+                pending_.append(data, end - data);
+                return;
+            }
+            if (pending_.empty()) {
+                emit(string_view(data, nl - data));
+            } else {
+                pending_.append(data, nl - data);
+                emit(pending_);
+                pending_.clear();
+            }
+            data = nl + 1;
+        }
+    }
+    void finish() {
+        if (!pending_.empty()) emit(pending_);
+        pending_.clear();
+    }
+
+private:
+    void emit(string_view line) {
+        if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+        onLine_(line);
+    }
+
+    function<void(string_view)> onLine_;
+    string pending_;
+};
+
+// Calls onRow for each data row of a TSV entry
+bool readTsv(const ZipArchive& zip, const ZipArchive::Entry& entry,
+             const function<void(const TsvHeader&, const vector<string_view>&)>& onRow) {
+    optional<TsvHeader> header;
+    vector<string_view> fields;
+    LineSplitter lines([&](string_view line) {
+        if (!header) {
+            header.emplace(line);
+            return;
+        }
+        if (line.empty()) return;
+        splitTabs(line, fields);
+        onRow(*header, fields);
+    });
+    bool ok = zip.read(entry, [&](const char* data, size_t len) {
+        lines.feed(data, len);
+        return true;
+    });
+    lines.finish();
+    return ok;
+}
+
+FilingRecord recordFor(const SubmissionHeader& header, vector<Holding>&& holdings) {
+    FilingRecord record;
+    record.firmName = header.companyName;
+    record.filingDate = header.filedAsOf;
+    record.quarter = quarterFromDateView(header.filedAsOf);
+    record.holdings = std::move(holdings);
+    record.amendment = header.formType == "13F-HR/A";
+    record.accession = header.accession;
+    record.cik = parseCik(header.cik);
+    record.formType = header.formType;
+    record.periodOfReport = header.periodOfReport;
+    record.amendmentType = header.amendmentType;
+    return record;
+}
+
+// INFOTABLE.tsv columns the parsers need
+struct InfoTableColumns {
+    size_t accession, issuer, titleOfClass, cusip, value, shares, putCall;
+    size_t sharesType, discretion, otherManager, votingSole, votingShared, votingNone;
+};
+
+// Shared by the reading thread and the parse workers
+class Importer {
+public:
+    Importer(sqlite3* db, const ImportConfig& config, HolderIndex* holderIndex)
+        : config_(config), writer_(db, config.filingsPerTransaction), jobs_(config.queueCapacity) {
+        loadCommitted(db);
+        if (holderIndex) {
+            writer_.onFilingWritten([holderIndex](int64_t filingId, const FilingRecord& filing) {
+                holderIndex->addFiling(filingId, filing.cik, filing.firmName, filing.quarter, filing.holdings,
+                                       filing.amendment, filing.isRestatement());
+            });
+            writer_.onCommit([holderIndex](int64_t before, int64_t after) { holderIndex->advance(before, after); });
+        }
+    }
+
+    ImportStats run(const string& path) {
+        writer_.start(config_.queueCapacity);
+        size_t workers = config_.workers ? config_.workers : 1;
+        vector<thread> threads;
+        for (size_t i = 0; i < workers; ++i) {
+            threads.emplace_back([this] {
+                while (auto job = jobs_.pop()) parse(*job);
+            });
+        }
+
+        bool ok = isZip(path) ? readZip(path) : readTarArchive(path);
+        flushFolder();
+        jobs_.close();
+        for (auto& t : threads) t.join();
+        writer_.finish();
+
+        ImportStats stats;
+        stats.entries = entries_;
+        stats.filings = filings_;
+        stats.skipped = skipped_;
+        stats.written = writer_.filingsWritten();
+        stats.failed = failed_ + writer_.failures() + (ok ? 0 : 1);
+        return stats;
+    }
+
+private:
+    void loadCommitted(sqlite3* db) {
+        sqlite3_stmt* stmt;
+        if (sqlite3_prepare_v2(db, "SELECT accession FROM ingest_ledger WHERE state = 'committed';", -1, &stmt,
+                               nullptr) != SQLITE_OK) {
+            cerr << "SQL error: " << sqlite3_errmsg(db) << endl;
+            return;
+        }
+        while (sqlite3_step(stmt) == SQLITE_ROW) {
+            committed_.emplace(reinterpret_cast<const char*>(sqlite3_column_text(stmt, 0)));
+        }
+        sqlite3_finalize(stmt);
+    }
+
+    static bool isZip(const string& path) {
+        char magic[4] = {};
+        ifstream in(path, ios::binary);
+        in.read(magic, sizeof(magic));
+        return memcmp(magic, "PK\x03\x04", 4) == 0 || memcmp(magic, "PK\x05\x06", 4) == 0;
+    }
+
+    // Full submissions are named after their accession, so committed ones
+    // are skipped without being read
+    bool wanted(const string& name, EntryKind kind) {
+        if (kind == EntryKind::Skip) return false;
+        if (kind == EntryKind::Submission) {
+            string base = baseName(name);
+            if (committed_.count(base.substr(0, base.rfind('.')))) {
+                ++skipped_;
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // XML entries are held back until their folder is complete, which relies
+    // on the archive listing a folder's files together
+    void add(const string& name, string data, const ZipArchive::Entry* zipEntry) {
+        EntryKind kind = classify(name);
+        ImportJob* job;
+        ImportJob single;
+        if (kind == EntryKind::Xml) {
+            string dir = dirName(name);
+            if (folder_ && folder_->source != dir) flushFolder();
+            if (!folder_) folder_ = ImportJob{ImportJob::Kind::XmlFolder, dir, {}, {}, {}};
+            job = &*folder_;
+        } else {
+            single = ImportJob{ImportJob::Kind::Submission, name, {}, {}, {}};
+            job = &single;
+        }
+        job->names.push_back(name);
+        if (zipEntry) job->zipEntries.push_back(zipEntry);
+        else job->documents.push_back(std::move(data));
+        if (kind != EntryKind::Xml) jobs_.push(std::move(single));
+    }
+
+    void flushFolder() {
+        if (!folder_) return;
+        if (committed_.count(accessionFromFolder(folder_->source))) ++skipped_;
+        else jobs_.push(std::move(*folder_));
+        folder_.reset();
+    }
+
+    bool readTarArchive(const string& path) {
+        string name, data;
+        bool pending = false;
+        bool ok = readTar(path, [&](const string& entryName, uint64_t size) -> EntryChunkHandler {
+            ++entries_;
+            if (pending) add(name, std::move(data), nullptr);
+            pending = wanted(entryName, classify(entryName));
+            if (!pending) return {};
+            name = entryName;
+            data.clear();
+            data.reserve(static_cast<size_t>(size));
+            return [&data](const char* chunk, size_t len) {
+                data.append(chunk, len);
+                return true;
+            };
+        });
+        if (pending) add(name, std::move(data), nullptr);
+        return ok;
+    }
+
+    bool readZip(const string& path) {
+        if (!zip_.open(path)) return false;
+        const ZipArchive::Entry* submission = nullptr;
+        const ZipArchive::Entry* coverPage = nullptr;
+        const ZipArchive::Entry* infoTable = nullptr;
+        for (const auto& entry : zip_.entries()) {
+            string base = lower(baseName(entry.name));
+            if (base == "submission.tsv") submission = &entry;
+            else if (base == "coverpage.tsv") coverPage = &entry;
+            else if (base == "infotable.tsv") infoTable = &entry;
+        }
+
+        bool ok = true;
+        if (submission && infoTable) {
+            entries_ += coverPage ? 3 : 2;
+            ok = readDataset(*submission, coverPage, *infoTable);
+        }
+        for (const auto& entry : zip_.entries()) {
+            if (&entry == submission || &entry == coverPage || &entry == infoTable) continue;
+            ++entries_;
+            if (wanted(entry.name, classify(entry.name))) add(entry.name, "", &entry);
+        }
+        return ok;
+    }
+
+    // Form 13F data set: filing metadata first, then the holdings streamed
+    // out in blocks of whole filings. A filing's rows are normally listed
+    // together; those of a filing that is not are held back and sent as one
+    // block at the end, so it is never written in parts
+    bool readDataset(const ZipArchive::Entry& submission, const ZipArchive::Entry* coverPage,
+                     const ZipArchive::Entry& infoTable) {
+        bool ok = readTsv(zip_, submission, [&](const TsvHeader& h, const vector<string_view>& f) {
+            string formType(field(f, h["SUBMISSIONTYPE"]));
+            string accession(field(f, h["ACCESSION_NUMBER"]));
+            if (!isHoldingsReport(formType) || committed_.count(accession)) {
+                ++skipped_;
+                return;
+            }
+            FilingRecord& r = dataset_[accession];
+            r.accession = accession;
+            r.formType = formType;
+            r.amendment = formType == "13F-HR/A";
+            r.filingDate = isoDateDmy(field(f, h["FILING_DATE"]));
+            r.quarter = quarterFromDateView(r.filingDate);
+            r.cik = parseCik(field(f, h["CIK"]));
+            r.periodOfReport = isoDateDmy(field(f, h["PERIODOFREPORT"]));
+        });
+        if (coverPage) {
+            ok = readTsv(zip_, *coverPage, [&](const TsvHeader& h, const vector<string_view>& f) {
+                auto it = dataset_.find(string(field(f, h["ACCESSION_NUMBER"])));
+                if (it == dataset_.end()) return;
+                it->second.firmName = string(field(f, h["FILINGMANAGER_NAME"]));
+                it->second.amendmentType = string(field(f, h["AMENDMENTTYPE"]));
+            }) && ok;
+        }
+
+        unordered_set<string> scattered;
+        ok = scatteredAccessions(infoTable, scattered) && ok;
+        unordered_map<string, string> heldBack;
+
+        optional<TsvHeader> header;
+        string block;
+        string accession;
+        bool keep = false;
+        string* target = &block;
+        LineSplitter lines([&](string_view line) {
+            if (!header) {
+                header.emplace(line);
+                const TsvHeader& h = *header;
+                columns_ = InfoTableColumns{h["ACCESSION_NUMBER"], h["NAMEOFISSUER"], h["TITLEOFCLASS"], h["CUSIP"],
+                                            h["VALUE"], h["SSHPRNAMT"], h["PUTCALL"], h["SSHPRNAMTTYPE"],
+                                            h["INVESTMENTDISCRETION"], h["OTHERMANAGER"], h["VOTING_AUTH_SOLE"],
+                                            h["VOTING_AUTH_SHARED"], h["VOTING_AUTH_NONE"]};
+                return;
+            }
+            if (line.empty()) return;
+            string_view lineAccession = field(line, columns_.accession);
+            if (lineAccession != accession) {
+                if (block.size() >= kRowBlock) pushRows(block);
+                accession = string(lineAccession);
+                keep = dataset_.count(accession) > 0;
+                target = scattered.count(accession) ? &heldBack[accession] : &block;
+            }
+            if (!keep) return;
+            target->append(line);
+            *target += '\n';
+        });
+        ok = zip_.read(infoTable, [&](const char* data, size_t len) {
+            lines.feed(data, len);
+            return true;
+        }) && ok;
+        lines.finish();
+        pushRows(block);
+        for (auto& rows : heldBack) pushRows(rows.second);
+        return ok;
+    }
+
+    // Pre-pass over INFOTABLE.tsv for the data set's filings whose rows are
+    // split into several runs. It only inflates and reads one column, which
+    // is cheap next to parsing and writing the rows
+    bool scatteredAccessions(const ZipArchive::Entry& infoTable, unordered_set<string>& scattered) {
+        optional<size_t> column;
+        unordered_set<string> ended;
+        string accession;
+        LineSplitter lines([&](string_view line) {
+            if (!column) {
+                column = TsvHeader(line)["ACCESSION_NUMBER"];
+                return;
+            }
+            if (line.empty()) return;
+            string_view lineAccession = field(line, *column);
+            if (lineAccession == accession) return;
+            if (!accession.empty()) ended.insert(std::move(accession));
+            accession = string(lineAccession);
+            if (ended.count(accession) && dataset_.count(accession)) scattered.insert(accession);
+        });
+        bool ok = zip_.read(infoTable, [&](const char* data, size_t len) {
+            lines.feed(data, len);
+            return true;
+        });
+        lines.finish();
+        if (!scattered.empty()) {
+            cerr << "INFOTABLE.tsv lists the rows of " << scattered.size() << " filing(s) apart, e.g. "
+                 << *scattered.begin() << "; grouping them" << endl;
+        }
+        return ok;
+    }
+
+    void pushRows(string& block) {
+        if (block.empty()) return;
+        jobs_.push(ImportJob{ImportJob::Kind::InfoTableRows, "INFOTABLE.tsv", {}, {std::move(block)}, {}});
+        block.clear();
+    }
+
+    void parse(ImportJob& job) {
+        for (size_t i = 0; i < job.zipEntries.size(); ++i) {
+            string data;
+            zip_.read(*job.zipEntries[i], [&](const char* chunk, size_t len) {
+                data.append(chunk, len);
+                return true;
+            });
+            job.documents.push_back(std::move(data));
+        }
+        switch (job.kind) {
+        case ImportJob::Kind::Submission: parseSubmissionJob(job); break;
+        case ImportJob::Kind::XmlFolder: parseFolderJob(job); break;
+        case ImportJob::Kind::InfoTableRows: parseRowsJob(job); break;
+        }
+    }
+
+    void submit(FilingRecord record) {
+        if (committed_.count(record.accession)) {
+            ++skipped_;
+            return;
+        }
+        ++filings_;
+        record.consolidate(config_.keepLineDetail);
+        writer_.submit(std::move(record));
+    }
+
+    void parseSubmissionJob(const ImportJob& job) {
+        const string& doc = job.documents.front();
+        SubmissionHeader header;
+        vector<Holding> holdings;
+        bool ok = parseSubmission(doc.data(), doc.size(), job.source, header, holdings);
+        if (!isHoldingsReport(header.formType)) {
+            ++skipped_;
+            return;
+        }
+        if (!ok) {
+            cerr << "No information table in submission: " << job.source << endl;
+            ++failed_;
+            return;
+        }
+        submit(recordFor(header, std::move(holdings)));
+    }
+
+    void parseFolderJob(const ImportJob& job) {
+        SubmissionHeader header;
+        header.accession = accessionFromFolder(job.source);
+        for (size_t i = 0; i < job.names.size(); ++i) {
+            if (lower(baseName(job.names[i])) == "primary_doc.xml") parseCoverPage(job.documents[i], header);
+        }
+        if (!header.formType.empty() && !isHoldingsReport(header.formType)) {
+            ++skipped_;
+            return;
+        }
+
+        vector<Holding> holdings;
+        InfoTableParser parser([&](const Holding& h) { holdings.push_back(h); });
+        bool found = false;
+        for (size_t i = 0; i < job.names.size() && !found; ++i) {
+            if (lower(baseName(job.names[i])) == "primary_doc.xml") continue;
+            parser.reset();
+            holdings.clear();
+            const string& doc = job.documents[i];
+            found = parser.feed(doc.data(), doc.size()) && parser.sawInfoTable() && parser.finish();
+        }
+        if (!found || header.companyName.empty()) {
+            cerr << "No information table or cover page in folder: " << job.source << endl;
+            ++failed_;
+            return;
+        }
+        submit(recordFor(header, std::move(holdings)));
+    }
+
+    void parseRowsJob(const ImportJob& job) {
+        const string& block = job.documents.front();
+        const InfoTableColumns& c = columns_;
+        vector<string_view> fields;
+        FilingRecord record;
+        string accession;
+        size_t pos = 0;
+        while (pos < block.size()) {
+            size_t nl = block.find('\n', pos);
+            splitTabs(string_view(block).substr(pos, nl - pos), fields);
+            pos = nl + 1;
+
+            string_view lineAccession = field(fields, c.accession);
+            if (lineAccession != accession) {
+                if (!accession.empty()) submit(std::move(record));
+                accession = string(lineAccession);
+                record = dataset_.at(accession);
+            }
+            Holding h;
+            h.nameOfIssuer = string(field(fields, c.issuer));
+            h.titleOfClass = string(field(fields, c.titleOfClass));
+            h.cusip = string(field(fields, c.cusip));
+            h.value = toInteger(field(fields, c.value));
+            h.shares = toInteger(field(fields, c.shares));
+            h.putCall = string(field(fields, c.putCall));
+            if (config_.keepLineDetail) {
+                h.sharesType = string(field(fields, c.sharesType));
+                h.investmentDiscretion = string(field(fields, c.discretion));
+                h.otherManager = string(field(fields, c.otherManager));
+                h.votingSole = toInteger(field(fields, c.votingSole));
+                h.votingShared = toInteger(field(fields, c.votingShared));
+                h.votingNone = toInteger(field(fields, c.votingNone));
+            }
+            record.holdings.push_back(std::move(h));
+            countMetric(Counter::RowsParsed);
+        }
+        if (!accession.empty()) submit(std::move(record));
+    }
+
+    ImportConfig config_;
+    HoldingsWriter writer_;
+    BoundedQueue<ImportJob> jobs_;
+    ZipArchive zip_;
+
+    // Read-only once the workers see jobs that use them
+    unordered_set<string> committed_;
+    unordered_map<string, FilingRecord> dataset_;   // metadata of the data set's filings, no rows
+    InfoTableColumns columns_{};
+
+    optional<ImportJob> folder_;   // XML folder being collected
+
+    atomic<size_t> entries_{0};
+    atomic<size_t> filings_{0};
+    atomic<size_t> skipped_{0};
+    atomic<size_t> failed_{0};
+};
+
+} // namespace
+
+ImportStats importArchive(const string& path, sqlite3* db, const ImportConfig& config, HolderIndex* holderIndex) {
+    Importer importer(db, config, holderIndex);
+    return importer.run(path);
+}
@@ -0,0 +1,42 @@
+// archive_importer.h
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <sqlite3.h>
+
+class HolderIndex;
+
+struct ImportConfig {
+    size_t workers = 4;                 // parse threads
+    size_t queueCapacity = 16;          // archive entries waiting for a parser
+    size_t filingsPerTransaction = 256; // filings committed together by the DB writer
+    bool keepLineDetail = false;        // also store each infoTable row in holdings_detail
+};
+
+struct ImportStats {
+    size_t entries = 0;   // archive entries read
+    size_t filings = 0;   // 13F holdings reports found
+    size_t skipped = 0;   // committed by an earlier run, or not a holdings report
+    size_t written = 0;
+    size_t failed = 0;
+};
+
+// Loads 13F filings from a local bulk archive instead of fetching them one
+// by one from EDGAR. Supported layouts:
+//
+//  - a Form 13F data set .zip: SUBMISSION.tsv and COVERPAGE.tsv supply the
+//    filing metadata, INFOTABLE.tsv the holdings;
+//  - a .zip, .tar or .tar.gz of full submissions (*.txt, or feed *.nc files);
+//  - a .zip, .tar or .tar.gz of mirrored filing folders, one primary_doc.xml
+//    cover page and one information table .xml per folder.
+//
+// One thread reads the archive while `workers` threads parse entries; all
+// rows go through the same HoldingsWriter as the HTTP pipeline. Accessions
+// the ingest ledger already marks committed are skipped, so an interrupted
+// import can simply be rerun.
+ImportStats importArchive(const std::string& path,
+                          sqlite3* db,
+                          const ImportConfig& config,
+                          HolderIndex* holderIndex = nullptr);
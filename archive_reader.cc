@@ -0,0 +1,259 @@
+#include "archive_reader.h"
+#include <cstring>
+#include <iostream>
+#include <zlib.h>
+
+using namespace std;
+
+namespace {
+
+const size_t kChunk = 256 * 1024;
+
+uint16_t le16(const unsigned char* p) { return static_cast<uint16_t>(p[0] | (p[1] << 8)); }
+uint32_t le32(const unsigned char* p) { return le16(p) | (static_cast<uint32_t>(le16(p + 2)) << 16); }
+uint64_t le64(const unsigned char* p) { return le32(p) | (static_cast<uint64_t>(le32(p + 4)) << 32); }
+
+// tar numeric field: octal text, or base-256 when the high bit is set
+uint64_t tarNumber(const char* field, size_t len) {
+    const unsigned char* p = reinterpret_cast<const unsigned char*>(field);
+    uint64_t v = 0;
+    if (p[0] & 0x80) {
+        v = p[0] & 0x7f;
+        for (size_t i = 1; i < len; ++i) v = (v << 8) | p[i];
+        return v;
+    }
+    for (size_t i = 0; i < len && p[i]; ++i) {
+        if (p[i] >= '0' && p[i] <= '7') v = v * 8 + (p[i] - '0');
+    }
+    return v;
+}
+
+string tarString(const char* field, size_t len) {
+    return string(field, strnlen(field, len));
+}
+
+// "path" record out of a pax extended header ("<len> path=<value>\n" ...)
+string paxPath(const string& records) {
+    size_t pos = 0;
+    while (pos < records.size()) {
+        size_t space = records.find(' ', pos);
+        if (space == string::npos) break;
+        size_t len = strtoul(records.c_str() + pos, nullptr, 10);
+        if (len == 0 || pos + len > records.size()) break;
+        string record = records.substr(space + 1, pos + len - space - 2);
+        if (record.compare(0, 5, "path=") == 0) return record.substr(5);
+        pos += len;
+    }
+    return "";
+}
+
+} // namespace
+
+bool ZipArchive::open(const string& path) {
+    entries_.clear();
+    if (!file_.open(path)) {
+        cerr << "Could not open " << path << endl;
+        return false;
+    }
+    const unsigned char* data = reinterpret_cast<const unsigned char*>(file_.data());
+    size_t size = file_.size();
+
+    // End of central directory: last 22 bytes, or earlier if there is a comment
+    size_t eocd = string::npos;
+    if (size >= 22) {
+        size_t lowest = size - 22 > 0xffff ? size - 22 - 0xffff : 0;
+        for (size_t i = size - 22;; --i) {
+            if (le32(data + i) == 0x06054b50) {
+                eocd = i;
+                break;
+            }
+            if (i == lowest) break;
+        }
+    }
+    if (eocd == string::npos) {
+        cerr << "Not a zip archive: " << path << endl;
+        return false;
+    }
+
+    uint64_t count = le16(data + eocd + 10);
+    uint64_t cdOffset = le32(data + eocd + 16);
+    if ((count == 0xffff || cdOffset == 0xffffffff) && eocd >= 20 && le32(data + eocd - 20) == 0x07064b50) {
+        uint64_t z64 = le64(data + eocd - 20 + 8);
+        if (z64 + 56 > size || le32(data + z64) != 0x06064b50) {
+            cerr << "Corrupt zip64 directory: " << path << endl;
+            return false;
+        }
+        count = le64(data + z64 + 32);
+        cdOffset = le64(data + z64 + 48);
+    }
+
+    size_t p = cdOffset;
+    for (uint64_t n = 0; n < count; ++n) {
+        if (p + 46 > size || le32(data + p) != 0x02014b50) {
+            cerr << "Corrupt zip directory: " << path << endl;
+            return false;
+        }
+        Entry e;
+        e.method = le16(data + p + 10);
+        e.compressedSize = le32(data + p + 20);
+        e.size = le32(data + p + 24);
+        size_t nameLen = le16(data + p + 28), extraLen = le16(data + p + 30), commentLen = le16(data + p + 32);
+        e.localHeaderOffset = le32(data + p + 42);
+        if (p + 46 + nameLen + extraLen > size) return false;
+        e.name.assign(reinterpret_cast<const char*>(data + p + 46), nameLen);
+
+        // zip64 extra field holds whichever of the three did not fit, in order
+        const unsigned char* extra = data + p + 46 + nameLen;
+        for (size_t x = 0; x + 4 <= extraLen;) {
+            uint16_t id = le16(extra + x);
+            size_t len = min<size_t>(le16(extra + x + 2), extraLen - x - 4);
+            if (id == 0x0001) {
+                const unsigned char* f = extra + x + 4;
+                const unsigned char* end = f + len;
+                if (e.size == 0xffffffff && f + 8 <= end) { e.size = le64(f); f += 8; }
+                if (e.compressedSize == 0xffffffff && f + 8 <= end) { e.compressedSize = le64(f); f += 8; }
+                if (e.localHeaderOffset == 0xffffffff && f + 8 <= end) { e.localHeaderOffset = le64(f); }
+            }
+            x += 4 + len;
+        }
+        p += 46 + nameLen + extraLen + commentLen;
+        if (!e.name.empty() && e.name.back() != '/') entries_.push_back(std::move(e));
+    }
+    return true;
+}
+
+bool ZipArchive::read(const Entry& entry, const EntryChunkHandler& onChunk) const {
+    const unsigned char* data = reinterpret_cast<const unsigned char*>(file_.data());
+    size_t size = file_.size();
+    uint64_t h = entry.localHeaderOffset;
+    if (h + 30 > size || le32(data + h) != 0x04034b50) return false;
+    uint64_t start = h + 30 + le16(data + h + 26) + le16(data + h + 28);
+    if (start > size || entry.compressedSize > size - start) return false;
+    const unsigned char* in = data + start;
+
+    if (entry.method == 0) {
+        // Stored data is its own size; anything else would read past it
+        if (entry.size != entry.compressedSize) {
+            cerr << "Corrupt zip entry " << entry.name << ": stored size mismatch" << endl;
+            return false;
+        }
+        for (uint64_t off = 0; off < entry.size; off += kChunk) {
+            size_t len = static_cast<size_t>(min<uint64_t>(kChunk, entry.size - off));
+            if (!onChunk(reinterpret_cast<const char*>(in + off), len)) return true;
+        }
+        return true;
+    }
+    if (entry.method != 8) {
+        cerr << "Unsupported zip compression method " << entry.method << " for " << entry.name << endl;
+        return false;
+    }
+
+    z_stream zs{};
+    if (inflateInit2(&zs, -MAX_WBITS) != Z_OK) return false;
+    vector<char> out(kChunk);
+    uint64_t remaining = entry.compressedSize;
+    const unsigned char* next = in;
+    int rc = Z_OK;
+    bool ok = true;
+    while (rc != Z_STREAM_END) {
+        if (zs.avail_in == 0 && remaining > 0) {
+            // avail_in is 32-bit; feed zip64 entries in slices
+            uInt slice = static_cast<uInt>(min<uint64_t>(remaining, 1u << 30));
+            zs.next_in = const_cast<Bytef*>(next);
+            zs.avail_in = slice;
+            next += slice;
+            remaining -= slice;
+        }
+        zs.next_out = reinterpret_cast<Bytef*>(out.data());
+        zs.avail_out = static_cast<uInt>(out.size());
+        rc = inflate(&zs, Z_NO_FLUSH);
+        if (rc != Z_OK && rc != Z_STREAM_END) {
+            cerr << "Corrupt zip entry " << entry.name << ": " << (zs.msg ? zs.msg : "inflate failed") << endl;
+            ok = false;
+            break;
+        }
+        size_t produced = out.size() - zs.avail_out;
+        if (produced && !onChunk(out.data(), produced)) break;
+        if (rc == Z_OK && produced == 0 && zs.avail_in == 0 && remaining == 0) {
+            cerr << "Truncated zip entry " << entry.name << endl;
+            ok = false;
+            break;
+        }
+    }
+    inflateEnd(&zs);
+    return ok;
+}
+
+bool readTar(const string& path, const function<EntryChunkHandler(const string&, uint64_t)>& onEntry) {
+    // gzopen reads uncompressed files transparently
+    gzFile gz = gzopen(path.c_str(), "rb");
+    if (!gz) {
+        cerr << "Could not open " << path << endl;
+        return false;
+    }
+    gzbuffer(gz, kChunk);
+
+    vector<char> buf(kChunk);
+    char header[512];
+    string longName;
+    bool ok = true;
+    int zeroBlocks = 0;
+    while (true) {
+        int got = gzread(gz, header, sizeof(header));
+        if (got == 0) break;
+        if (got != static_cast<int>(sizeof(header))) {
+            cerr << "Truncated tar archive: " << path << endl;
+            ok = false;
+            break;
+        }
+        if (header[0] == 0) {
+            if (++zeroBlocks == 2) break;
+            continue;
+        }
+        zeroBlocks = 0;
+
+        uint64_t size = tarNumber(header + 124, 12);
+        char type = header[156];
+        string name = tarString(header, 100);
+        if (memcmp(header + 257, "ustar", 5) == 0 && header[345]) {
+            name = tarString(header + 345, 155) + "/" + name;
+        }
+        if (!longName.empty()) {
+            name = std::move(longName);
+            longName.clear();
+        }
+
+        // GNU long name and pax headers describe the next entry
+        bool meta = type == 'L' || type == 'x';
+        string metaData;
+        EntryChunkHandler handler;
+        if (meta) {
+            handler = [&](const char* data, size_t len) {
+                metaData.append(data, len);
+                return true;
+            };
+        } else if (type == '0' || type == '\0') {
+            handler = onEntry(name, size);
+        }
+
+        uint64_t padded = (size + 511) & ~uint64_t(511);
+        bool wanted = static_cast<bool>(handler);
+        for (uint64_t off = 0; off < padded;) {
+            unsigned want = static_cast<unsigned>(min<uint64_t>(buf.size(), padded - off));
+            int n = gzread(gz, buf.data(), want);
+            if (n <= 0) {
+                cerr << "Truncated tar archive: " << path << endl;
+                gzclose(gz);
+                return false;
+            }
+            uint64_t data = off < size ? min<uint64_t>(static_cast<uint64_t>(n), size - off) : 0;
+            if (wanted && data && !handler(buf.data(), static_cast<size_t>(data))) wanted = false;
+            off += static_cast<uint64_t>(n);
+        }
+
+        if (type == 'L') longName = metaData.c_str();
+        else if (type == 'x') longName = paxPath(metaData);
+    }
+    gzclose(gz);
+    return ok;
+}
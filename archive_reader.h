@@ -0,0 +1,42 @@
+// archive_reader.h
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+#include "idx_scanner.h"
+
+// Receives an entry's bytes in order; return false to skip the rest of it
+using EntryChunkHandler = std::function<bool(const char*, size_t)>;
+
+// Local .zip file, read in place through a memory mapping. Stored and
+// deflated entries are supported, as are zip64 sizes and offsets.
+class ZipArchive {
+public:
+    struct Entry {
+        std::string name;
+        uint16_t method = 0;        // 0 stored, 8 deflate
+        uint64_t compressedSize = 0;
+        uint64_t size = 0;
+        uint64_t localHeaderOffset = 0;
+    };
+
+    bool open(const std::string& path);
+    const std::vector<Entry>& entries() const { return entries_; }
+    // Inflates one entry through onChunk; false on a corrupt entry
+    bool read(const Entry& entry, const EntryChunkHandler& onChunk) const;
+
+private:
+    MappedFile file_;
+    std::vector<Entry> entries_;
+};
+
+// Streams every regular file of a .tar or .tar.gz (gzip is detected, not
+// guessed from the name). onEntry sees each name and size and returns the
+// handler for its bytes, or an empty function to skip it. Handles ustar
+// prefixes, GNU long names and pax path records.
+bool readTar(const std::string& path,
+             const std::function<EntryChunkHandler(const std::string& name, uint64_t size)>& onEntry);
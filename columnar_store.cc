@@ -0,0 +1,242 @@
+#include "columnar_store.h"
+#include "sqlite_util.h"
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+
+using namespace std;
+
+namespace {
+
+void sortByValue(vector<ColumnarStore::Aggregate>& rows) {
+    sort(rows.begin(), rows.end(), [](const ColumnarStore::Aggregate& a, const ColumnarStore::Aggregate& b) {
+        return a.value != b.value ? a.value > b.value : a.key < b.key;
+    });
+}
+
+} // namespace
+
+int32_t StringDictionary::intern(const string& s) {
+    auto it = codes_.find(s);
+    if (it != codes_.end()) return it->second;
+    int32_t code = static_cast<int32_t>(strings_.size());
+    strings_.push_back(s);
+    codes_.emplace(s, code);
+    return code;
+}
+
+int32_t StringDictionary::find(const string& s) const {
+    auto it = codes_.find(s);
+    return it == codes_.end() ? -1 : it->second;
+}
+
+int32_t FirmDictionary::intern(int64_t cik, const string& name) {
+    if (cik) {
+        auto it = byCik_.find(cik);
+        if (it != byCik_.end()) return it->second;
+    } else {
+        auto it = byName_.find(name);
+        if (it != byName_.end()) return it->second;
+    }
+    int32_t code = static_cast<int32_t>(names_.size());
+    names_.push_back(name);
+    ciks_.push_back(cik);
+    if (cik) byCik_.emplace(cik, code);
+    else byName_.emplace(name, code);
+    return code;
+}
+
+int32_t FirmDictionary::find(const string& firm) const {
+    if (!firm.empty() && all_of(firm.begin(), firm.end(), [](char c) { return c >= '0' && c <= '9'; })) {
+        auto it = byCik_.find(strtoll(firm.c_str(), nullptr, 10));
+        return it == byCik_.end() ? -1 : it->second;
+    }
+    auto it = std::find(names_.begin(), names_.end(), firm);
+    return it == names_.end() ? -1 : static_cast<int32_t>(it - names_.begin());
+}
+
+const QuarterPartition* ColumnarStore::partition(const string& quarter) const {
+    auto it = partitionIndex_.find(quarter);
+    return it == partitionIndex_.end() ? nullptr : &partitions_[it->second];
+}
+
+QuarterPartition* ColumnarStore::partition(const string& quarter) {
+    auto it = partitionIndex_.find(quarter);
+    return it == partitionIndex_.end() ? nullptr : &partitions_[it->second];
+}
+
+QuarterPartition& ColumnarStore::partitionFor(const string& quarter) {
+    auto it = partitionIndex_.find(quarter);
+    if (it != partitionIndex_.end()) return partitions_[it->second];
+    partitionIndex_.emplace(quarter, partitions_.size());
+    partitions_.emplace_back();
+    partitions_.back().quarter = quarter;
+    return partitions_.back();
+}
+
+size_t ColumnarStore::rows() const {
+    size_t n = 0;
+    for (const auto& p : partitions_) n += p.size();
+    return n;
+}
+
+void ColumnarStore::append(QuarterPartition& p, int32_t firm, int64_t filingId, const string& cusip,
+                           const string& issuer, int64_t shares, int64_t value) {
+    p.firm.push_back(firm);
+    p.security.push_back(cusips_.intern(cusip));
+    p.issuer.push_back(issuers_.intern(issuer));
+    p.filing.push_back(filingId);
+    p.shares.push_back(shares);
+    p.value.push_back(value);
+}
+
+bool ColumnarStore::load(sqlite3* db) {
+    *this = ColumnarStore();
+
+    // Grouped by quarter so each partition is filled in one run. Share
+    // positions only: a put or call row counts its underlying notional,
+    // which would add to the share totals (as in the holder index)
+    const char* sql =
+        "SELECT f.quarter, fi.cik, fi.name, h.filing_id, s.cusip, s.name_of_issuer, h.shares, h.value "
+        "FROM holdings h "
+        "JOIN securities s ON h.security_id = s.id "
+        "JOIN filings f ON h.filing_id = f.id "
+        "JOIN firms fi ON f.firm_id = fi.id "
+        "WHERE h.put_call = '' "
+        "ORDER BY f.quarter;";
+    sqlite3_stmt* stmt;
+    if (sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr) != SQLITE_OK) {
+        cerr << "SQL error: " << sqlite3_errmsg(db) << endl;
+        return false;
+    }
+
+    string quarter;
+    QuarterPartition* current = nullptr;
+    int rc;
+    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+        const char* q = columnText(stmt, 0);
+        if (!current || quarter != q) {
+            quarter = q;
+            current = &partitionFor(quarter);
+        }
+        append(*current, firms_.intern(sqlite3_column_int64(stmt, 1), columnText(stmt, 2)),
+               sqlite3_column_int64(stmt, 3), columnText(stmt, 4), columnText(stmt, 5),
+               sqlite3_column_int64(stmt, 6), sqlite3_column_int64(stmt, 7));
+    }
+    sqlite3_finalize(stmt);
+    if (rc != SQLITE_DONE) {
+        cerr << "SQL error: " << sqlite3_errmsg(db) << endl;
+        return false;
+    }
+    for (auto& p : partitions_) p.sorted = false;
+    sortPartitions();
+    return true;
+}
+
+void ColumnarStore::sortPartitions() {
+    for (auto& p : partitions_) {
+        if (p.sorted) continue;
+        size_t n = p.size();
+        vector<uint32_t> order(n);
+        for (size_t i = 0; i < n; ++i) order[i] = static_cast<uint32_t>(i);
+        sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+            return p.firm[a] != p.firm[b] ? p.firm[a] < p.firm[b] : p.security[a] < p.security[b];
+        });
+
+        auto permute = [&](auto& column) {
+            auto copy = column;
+            for (size_t i = 0; i < n; ++i) column[i] = copy[order[i]];
+        };
+        permute(p.firm);
+        permute(p.security);
+        permute(p.issuer);
+        permute(p.filing);
+        permute(p.shares);
+        permute(p.value);
+        p.sorted = true;
+    }
+}
+
+void ColumnarStore::addFiling(int64_t cik, const string& firmName, const string& quarter, int64_t filingId,
+                              const vector<Holding>& holdings) {
+    QuarterPartition& p = partitionFor(quarter);
+    int32_t firm = firms_.intern(cik, firmName);
+    if (!holdings.empty()) p.sorted = false;
+    for (const Holding& h : holdings) {
+        if (!h.putCall.empty()) continue;
+        append(p, firm, filingId, h.cusip, h.nameOfIssuer, h.shares, h.value);
+    }
+}
+
+vector<ColumnarStore::Aggregate> ColumnarStore::groupBy(const string& quarter, bool byFirm) const {
+    size_t groups = byFirm ? firms_.size() : issuers_.size();
+    vector<int64_t> shares(groups, 0), value(groups, 0), positions(groups, 0);
+
+    for (const auto& p : partitions_) {
+        if (!quarter.empty() && p.quarter != quarter) continue;
+        const int32_t* key = byFirm ? p.firm.data() : p.issuer.data();
+        const int64_t* s = p.shares.data();
+        const int64_t* v = p.value.data();
+        size_t n = p.size();
+        for (size_t i = 0; i < n; ++i) {
+            shares[key[i]] += s[i];
+            value[key[i]] += v[i];
+            ++positions[key[i]];
+        }
+    }
+
+    vector<Aggregate> result;
+    for (size_t g = 0; g < groups; ++g) {
+        if (positions[g] == 0) continue;
+        result.push_back(Aggregate{static_cast<int32_t>(g), shares[g], value[g], positions[g]});
+    }
+    sortByValue(result);
+    return result;
+}
+
+vector<ColumnarStore::Aggregate> ColumnarStore::totalsByFirm(const string& quarter) const {
+    return groupBy(quarter, true);
+}
+
+vector<ColumnarStore::Aggregate> ColumnarStore::totalsByIssuer(const string& quarter) const {
+    return groupBy(quarter, false);
+}
+
+vector<ColumnarStore::Aggregate> ColumnarStore::topHolders(const string& cusip, const string& quarter,
+                                                           size_t limit) const {
+    vector<Aggregate> result;
+    int32_t code = cusips_.find(cusip);
+    if (code < 0) return result;
+
+    vector<int64_t> shares(firms_.size(), 0), value(firms_.size(), 0), positions(firms_.size(), 0);
+    vector<uint32_t> matches;
+    for (const auto& p : partitions_) {
+        if (!quarter.empty() && p.quarter != quarter) continue;
+
+        // Filter pass: a branch-free compare over one int32 column
+        const int32_t* sec = p.security.data();
+        size_t n = p.size();
+        matches.resize(n);
+        size_t count = 0;
+        for (size_t i = 0; i < n; ++i) {
+            matches[count] = static_cast<uint32_t>(i);
+            count += sec[i] == code;
+        }
+
+        for (size_t m = 0; m < count; ++m) {
+            uint32_t i = matches[m];
+            int32_t f = p.firm[i];
+            shares[f] += p.shares[i];
+            value[f] += p.value[i];
+            ++positions[f];
+        }
+    }
+
+    for (size_t f = 0; f < positions.size(); ++f) {
+        if (positions[f] == 0) continue;
+        result.push_back(Aggregate{static_cast<int32_t>(f), shares[f], value[f], positions[f]});
+    }
+    sortByValue(result);
+    if (limit && result.size() > limit) result.resize(limit);
+    return result;
+}
@@ -0,0 +1,115 @@
+// columnar_store.h
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <sqlite3.h>
+#include "sec_parser.h"
+
+// Maps strings to dense int32 codes in first-seen order
+class StringDictionary {
+public:
+    int32_t intern(const std::string& s);
+    // -1 if s was never interned
+    int32_t find(const std::string& s) const;
+    const std::string& at(int32_t code) const { return strings_[code]; }
+    size_t size() const { return strings_.size(); }
+
+private:
+    std::unordered_map<std::string, int32_t> codes_;
+    std::vector<std::string> strings_;
+};
+
+// Maps firms to dense int32 codes by CIK, or by name for a firm stored
+// without one, as HoldingsWriter keys them; firms filing under the same
+// name keep separate codes. at() is the name a firm was first seen with.
+class FirmDictionary {
+public:
+    int32_t intern(int64_t cik, const std::string& name);
+    // -1 if unknown. `firm` is a CIK if it is all digits, else a name, which
+    // finds the first firm seen with it.
+    int32_t find(const std::string& firm) const;
+    const std::string& at(int32_t code) const { return names_[code]; }
+    int64_t cik(int32_t code) const { return ciks_[code]; }
+    size_t size() const { return names_.size(); }
+
+private:
+    std::unordered_map<int64_t, int32_t> byCik_;
+    std::unordered_map<std::string, int32_t> byName_;   // firms without a CIK
+    std::vector<std::string> names_;
+    std::vector<int64_t> ciks_;                          // 0 for firms without one
+};
+
+// All holdings of one quarter, one contiguous array per column
+struct QuarterPartition {
+    std::string quarter;
+    std::vector<int32_t> firm;       // code in ColumnarStore::firms()
+    std::vector<int32_t> security;   // code in ColumnarStore::cusips()
+    std::vector<int32_t> issuer;     // code in ColumnarStore::issuers()
+    std::vector<int64_t> filing;     // filings.id
+    std::vector<int64_t> shares;
+    std::vector<int64_t> value;
+    bool sorted = true;              // rows ordered by (firm, security)
+
+    size_t size() const { return firm.size(); }
+};
+
+// In-process column store of holdings for analytical queries.
+//
+// CUSIPs, issuer names and firms are dictionary-encoded, so filters compare
+// int32 codes and group-bys accumulate into arrays indexed by code instead
+// of hashing strings. Every query is a straight loop over a few contiguous
+// arrays per quarter.
+class ColumnarStore {
+public:
+    struct Aggregate {
+        int32_t key;          // firm or issuer code, depending on the query
+        int64_t shares = 0;
+        int64_t value = 0;
+        int64_t positions = 0;
+    };
+
+    // Loads every share position in holdings.db, replacing the current
+    // contents; put and call rows are left out
+    bool load(sqlite3* db);
+    // Appends the share positions of one parsed filing, e.g. straight from
+    // the ingest path; cik is 0 for a firm known only by name
+    void addFiling(int64_t cik, const std::string& firmName, const std::string& quarter, int64_t filingId,
+                   const std::vector<Holding>& holdings);
+
+    // Sorted by value, descending. An empty quarter means all quarters.
+    std::vector<Aggregate> totalsByFirm(const std::string& quarter = "") const;
+    std::vector<Aggregate> totalsByIssuer(const std::string& quarter = "") const;
+    // Firms holding `cusip`, keyed by firm code
+    std::vector<Aggregate> topHolders(const std::string& cusip, const std::string& quarter = "",
+                                      size_t limit = 0) const;
+
+    const FirmDictionary& firms() const { return firms_; }
+    const StringDictionary& cusips() const { return cusips_; }
+    const StringDictionary& issuers() const { return issuers_; }
+
+    // Orders every partition by (firm, security) code, which the diff engine
+    // merge-joins on. load() leaves partitions sorted; addFiling() may not.
+    void sortPartitions();
+
+    const std::vector<QuarterPartition>& partitions() const { return partitions_; }
+    const QuarterPartition* partition(const std::string& quarter) const;
+    QuarterPartition* partition(const std::string& quarter);
+    size_t rows() const;
+
+private:
+    QuarterPartition& partitionFor(const std::string& quarter);
+    void append(QuarterPartition& p, int32_t firm, int64_t filingId, const std::string& cusip,
+                const std::string& issuer, int64_t shares, int64_t value);
+    std::vector<Aggregate> groupBy(const std::string& quarter, bool byFirm) const;
+
+    FirmDictionary firms_;
+    StringDictionary cusips_;
+    StringDictionary issuers_;
+    std::vector<QuarterPartition> partitions_;
+    std::unordered_map<std::string, size_t> partitionIndex_;
+};
@@ -0,0 +1,146 @@
+// consolidateHoldings and FilingRecord::consolidate: shares, puts and calls
+// on one CUSIP stay separate positions, duplicated lines of a position are
+// summed into its first row in filing order, and write13F stores one
+// holdings row per position.
+// Usage: consolidate_test
+
+#include "holdings_writer.h"
+#include "schema.h"
+#include "sec_parser.h"
+#include "test_util.h"
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <sqlite3.h>
+
+using namespace std;
+
+namespace {
+
+Holding row(const string& cusip, const string& putCall, long long shares, long long value,
+            const string& discretion = "SOLE") {
+    Holding h;
+    h.cusip = cusip;
+    h.nameOfIssuer = "ISSUER " + cusip;
+    h.titleOfClass = putCall.empty() ? "COM" : putCall;
+    h.shares = shares;
+    h.value = value;
+    h.putCall = putCall;
+    h.sharesType = "SH";
+    h.investmentDiscretion = discretion;
+    h.votingSole = shares;
+    return h;
+}
+
+void expectRow(const vector<Holding>& holdings, size_t i, const string& cusip, const string& putCall,
+               long long shares, long long value) {
+    string what = "row " + to_string(i);
+    if (i >= holdings.size()) {
+        expectEqual(holdings.size(), i + 1, what + " missing");
+        return;
+    }
+    expectEqual(holdings[i].cusip, cusip, what + " cusip");
+    expectEqual(holdings[i].putCall, putCall, what + " put/call");
+    expectEqual(holdings[i].shares, shares, what + " shares");
+    expectEqual(holdings[i].value, value, what + " value");
+    expectEqual(holdings[i].votingSole, shares, what + " voting sole");
+}
+
+void testSeparatePositions() {
+    vector<Holding> holdings = {row("037833100", "", 1000, 190000), row("037833100", "Put", 200, 38000),
+                                row("037833100", "Call", 300, 57000)};
+    expectEqual(consolidateHoldings(holdings), 0u, "shares/put/call merged rows");
+    expectEqual(holdings.size(), 3u, "shares/put/call positions");
+    expectRow(holdings, 0, "037833100", "", 1000, 190000);
+    expectRow(holdings, 1, "037833100", "Put", 200, 38000);
+    expectRow(holdings, 2, "037833100", "Call", 300, 57000);
+}
+
+void testDuplicatedLines() {
+    vector<Holding> holdings = {row("037833100", "", 1000, 190000, "SOLE"),
+                                row("594918104", "", 50, 20000),
+                                row("037833100", "Call", 300, 57000),
+                                row("037833100", "", 400, 76000, "DFND"),
+                                row("037833100", "Call", 100, 19000, "OTR"),
+                                row("037833100", "", 600, 114000, "OTR")};
+    expectEqual(consolidateHoldings(holdings), 3u, "duplicated lines merged");
+    expectEqual(holdings.size(), 3u, "duplicated lines positions");
+    expectRow(holdings, 0, "037833100", "", 2000, 380000);
+    expectRow(holdings, 1, "594918104", "", 50, 20000);
+    expectRow(holdings, 2, "037833100", "Call", 400, 76000);
+    // The first line's own fields are kept
+    if (!holdings.empty()) expectEqual(holdings[0].investmentDiscretion, string("SOLE"), "row 0 discretion");
+}
+
+// Enough positions to fill the probe table with collisions
+void testManyPositions() {
+    vector<Holding> holdings;
+    for (int pass = 0; pass < 2; ++pass) {
+        for (int i = 0; i < 5000; ++i) {
+            char cusip[10];
+            snprintf(cusip, sizeof(cusip), "%06dAB%d", i, i % 10);
+            holdings.push_back(row(cusip, i % 3 == 0 ? "Put" : "", i + 1, (i + 1) * 10));
+        }
+    }
+    expectEqual(consolidateHoldings(holdings), 5000u, "many positions merged");
+    expectEqual(holdings.size(), 5000u, "many positions kept");
+    long long bad = 0;
+    for (size_t i = 0; i < holdings.size(); ++i) {
+        if (holdings[i].shares != 2 * static_cast<long long>(i + 1)) ++bad;
+    }
+    expectEqual(bad, 0, "many positions with wrong sums or order");
+}
+
+void testKeepLines() {
+    FilingRecord record;
+    record.holdings = {row("037833100", "", 1000, 190000), row("037833100", "", 400, 76000, "DFND"),
+                       row("037833100", "Put", 200, 38000)};
+    record.consolidate(true);
+    expectEqual(record.holdings.size(), 2u, "consolidate(true) positions");
+    expectEqual(record.lines.size(), 3u, "consolidate(true) lines");
+    if (record.lines.size() == 3) expectEqual(record.lines[1].shares, 400, "line 1 shares");
+
+    FilingRecord bare;
+    bare.holdings = record.lines;
+    bare.consolidate(false);
+    expectEqual(bare.holdings.size(), 2u, "consolidate(false) positions");
+    expectEqual(bare.lines.size(), 0u, "consolidate(false) lines");
+}
+
+// One holdings row per position, options apart from the shares
+void testWrite13F() {
+    sqlite3* db;
+    if (sqlite3_open(":memory:", &db) != SQLITE_OK || !migrateSchema(db)) {
+        cerr << "FAILED: in-memory database: " << sqlite3_errmsg(db) << endl;
+        sqlite3_close(db);
+        ++testFailures;
+        return;
+    }
+    write13F(db, "TEST CAPITAL LLC", "2025Q3", "2025-08-14",
+             {row("037833100", "", 1000, 190000), row("037833100", "Put", 200, 38000),
+              row("037833100", "", 400, 76000, "DFND"), row("037833100", "Call", 300, 57000),
+              row("037833100", "Put", 50, 9500, "OTR")});
+    expectEqual(queryInt(db, "SELECT COUNT(*) FROM holdings"), 3, "write13F holdings rows");
+    expectEqual(queryInt(db, "SELECT SUM(value) FROM holdings"), 370500, "write13F sum(value)");
+    expectEqual(queryInt(db, "SELECT shares FROM holdings WHERE put_call = ''"), 1400, "write13F shares row");
+    expectEqual(queryInt(db, "SELECT shares FROM holdings WHERE put_call = 'Put'"), 250, "write13F put row");
+    expectEqual(queryInt(db, "SELECT shares FROM holdings WHERE put_call = 'Call'"), 300, "write13F call row");
+    sqlite3_close(db);
+}
+
+} // namespace
+
+int main() {
+    testSeparatePositions();
+    testDuplicatedLines();
+    testManyPositions();
+    testKeepLines();
+    testWrite13F();
+    if (testFailures) {
+        cerr << testFailures << " check(s) failed" << endl;
+        return 1;
+    }
+    cout << "consolidate_test passed" << endl;
+    return 0;
+}
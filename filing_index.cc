@@ -0,0 +1,105 @@
+#include "filing_index.h"
+#include "sec_parser.h"
+#include <cctype>
+
+using namespace std;
+
+namespace {
+
+string lower(string s) {
+    for (auto& c : s) c = static_cast<char>(tolower(static_cast<unsigned char>(c)));
+    return s;
+}
+
+// Text content of an HTML fragment: tags dropped, whitespace collapsed
+string cellText(const string& html, size_t begin, size_t end) {
+    string text;
+    bool inTag = false;
+    for (size_t i = begin; i < end; ++i) {
+        char c = html[i];
+        if (c == '<') inTag = true;
+        else if (c == '>') inTag = false;
+        else if (!inTag) text += isspace(static_cast<unsigned char>(c)) ? ' ' : c;
+    }
+    return trim(text);
+}
+
+// First href="..." in [begin, end)
+string firstHref(const string& html, size_t begin, size_t end) {
+    size_t h = html.find("href=\"", begin);
+    if (h == string::npos || h >= end) return "";
+    h += 6;
+    size_t close = html.find('"', h);
+    if (close == string::npos || close >= end) return "";
+    return html.substr(h, close - h);
+}
+
+} // namespace
+
+string filingIndexUrl(const FilingRef& filing) {
+    if (filing.accession.empty()) return "";
+    return filing.folderUrl + filing.accession + "-index.htm";
+}
+
+vector<FilingDocument> parseFilingIndex(const string& html, const string& baseUrl) {
+    vector<FilingDocument> documents;
+    // Match tags case-insensitively by scanning a lowered copy
+    string lc = lower(html);
+    size_t table = lc.find("class=\"tablefile\"");
+    if (table == string::npos) return documents;
+    size_t tableEnd = lc.find("</table>", table);
+    if (tableEnd == string::npos) tableEnd = lc.size();
+
+    size_t row = table;
+    while ((row = lc.find("<tr", row)) != string::npos && row < tableEnd) {
+        size_t rowEnd = lc.find("</tr>", row);
+        if (rowEnd == string::npos || rowEnd > tableEnd) rowEnd = tableEnd;
+
+        // Seq | Description | Document | Type | Size
+        vector<pair<size_t, size_t>> cells;
+        size_t cell = row;
+        while ((cell = lc.find("<td", cell)) != string::npos && cell < rowEnd) {
+            size_t open = lc.find('>', cell);
+            size_t close = lc.find("</td>", cell);
+            if (open == string::npos || close == string::npos || close > rowEnd) break;
+            cells.emplace_back(open + 1, close);
+            cell = close + 5;
+        }
+        if (cells.size() >= 4) {
+            string href = firstHref(html, cells[2].first, cells[2].second);
+            if (!href.empty()) {
+                string url = href[0] == '/' ? edgarBaseUrl() + href
+                           : href.rfind("http", 0) == 0 ? href
+                           : baseUrl + href;
+                documents.push_back(FilingDocument{std::move(url), cellText(html, cells[1].first, cells[1].second),
+                                                   cellText(html, cells[3].first, cells[3].second)});
+            }
+        }
+        row = rowEnd + 5;
+    }
+    return documents;
+}
+
+string infoTableUrl(const vector<FilingDocument>& documents) {
+    for (const auto& d : documents) {
+        if (lower(d.type) != "information table") continue;
+        string url = lower(d.url);
+        if (url.size() < 4 || url.compare(url.size() - 4, 4, ".xml") != 0) continue;
+        // xslForm13F_X02/... is the same table rendered to HTML
+        if (url.find("/xsl") != string::npos) continue;
+        return d.url;
+    }
+    return "";
+}
+
+string coverPageUrl(const vector<FilingDocument>& documents) {
+    for (const auto& d : documents) {
+        string type = lower(d.type);
+        if (type.compare(0, 3, "13f") != 0) continue;
+        string url = lower(d.url);
+        if (url.size() < 4 || url.compare(url.size() - 4, 4, ".xml") != 0) continue;
+        if (url.find("/xsl") != string::npos) continue;
+        return d.url;
+    }
+    return "";
+}
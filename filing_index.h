@@ -0,0 +1,28 @@
+// filing_index.h
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include "idx_scanner.h"
+
+// One row of the document table on an EDGAR filing index page
+struct FilingDocument {
+    std::string url;
+    std::string description;
+    std::string type;   // e.g. "13F-HR", "INFORMATION TABLE"
+};
+
+// https://www.sec.gov/Archives/edgar/data/<cik>/<accession without dashes>/<accession>-index.htm
+std::string filingIndexUrl(const FilingRef& filing);
+
+// Rows of the "Document Format Files" table in an -index.htm page. Relative
+// links are resolved against edgarBaseUrl() or `baseUrl`.
+std::vector<FilingDocument> parseFilingIndex(const std::string& html, const std::string& baseUrl);
+
+// The raw INFORMATION TABLE XML among `documents`, skipping the XSL-rendered
+// copy EDGAR also lists; empty if there is none
+std::string infoTableUrl(const std::vector<FilingDocument>& documents);
+// The raw 13F cover page XML (primary_doc.xml) among `documents`; empty if
+// there is none
+std::string coverPageUrl(const std::vector<FilingDocument>& documents);
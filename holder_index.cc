@@ -0,0 +1,445 @@
+#include "holder_index.h"
+#include "idx_scanner.h"
+#include "sqlite_util.h"
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+
+using namespace std;
+namespace fs = std::filesystem;
+
+namespace {
+
+// 0002: share positions only, options left out
+// 0003: watermark is meta.holdings_version rather than MAX(holdings.id)
+// 0004: firms keyed by CIK, stored with it
+const char kMagic[8] = {'H', 'I', 'D', 'X', '0', '0', '0', '4'};
+
+// Fixed-width native-endian encoding; the file is a local cache, not an
+// interchange format
+template <typename T>
+void put(string& out, T v) {
+    out.append(reinterpret_cast<const char*>(&v), sizeof(v));
+}
+
+void putString(string& out, const string& s) {
+    put<uint32_t>(out, static_cast<uint32_t>(s.size()));
+    out += s;
+}
+
+void putDictionary(string& out, const StringDictionary& dict) {
+    put<uint32_t>(out, static_cast<uint32_t>(dict.size()));
+    for (size_t i = 0; i < dict.size(); ++i) putString(out, dict.at(static_cast<int32_t>(i)));
+}
+
+void putFirms(string& out, const FirmDictionary& firms) {
+    put<uint32_t>(out, static_cast<uint32_t>(firms.size()));
+    for (size_t i = 0; i < firms.size(); ++i) {
+        put<int64_t>(out, firms.cik(static_cast<int32_t>(i)));
+        putString(out, firms.at(static_cast<int32_t>(i)));
+    }
+}
+
+struct Reader {
+    const char* p;
+    const char* end;
+    bool ok = true;
+
+    template <typename T>
+    T get() {
+        T v{};
+        if (end - p < static_cast<ptrdiff_t>(sizeof(T))) {
+            ok = false;
+            return v;
+        }
+        memcpy(&v, p, sizeof(T));
+        p += sizeof(T);
+        return v;
+    }
+
+    string getString() {
+        uint32_t n = get<uint32_t>();
+        if (!ok || end - p < static_cast<ptrdiff_t>(n)) {
+            ok = false;
+            return "";
+        }
+        string s(p, n);
+        p += n;
+        return s;
+    }
+
+    void getDictionary(StringDictionary& dict) {
+        uint32_t n = get<uint32_t>();
+        for (uint32_t i = 0; ok && i < n; ++i) dict.intern(getString());
+    }
+
+    void getFirms(FirmDictionary& firms) {
+        uint32_t n = get<uint32_t>();
+        for (uint32_t i = 0; ok && i < n; ++i) {
+            int64_t cik = get<int64_t>();
+            firms.intern(cik, getString());
+        }
+    }
+};
+
+vector<HolderPosting>::iterator findPosting(vector<HolderPosting>& list, int64_t filingId) {
+    return lower_bound(list.begin(), list.end(), filingId,
+                       [](const HolderPosting& p, int64_t id) { return p.filing < id; });
+}
+
+} // namespace
+
+void HolderIndex::add(int64_t filingId, FilingEntry& entry, int32_t security, int64_t shares, int64_t value,
+                      bool amend) {
+    auto& secs = entry.securities;
+    auto pos = lower_bound(secs.begin(), secs.end(), security);
+    if (pos != secs.end() && *pos == security) {
+        if (!amend) return;
+        auto p = findPosting(postings_[security], filingId);
+        if (p != postings_[security].end() && p->filing == filingId) {
+            p->shares = shares;
+            p->value = value;
+        }
+        return;
+    }
+    secs.insert(pos, security);
+
+    if (postings_.size() <= static_cast<size_t>(security)) postings_.resize(security + 1);
+    auto& list = postings_[security];
+    HolderPosting posting{filingId, shares, value};
+    // Filing ids grow as filings are inserted, so this is an append in practice
+    if (list.empty() || list.back().filing < filingId) {
+        list.push_back(posting);
+    } else {
+        list.insert(findPosting(list, filingId), posting);
+    }
+}
+
+void HolderIndex::remove(int64_t filingId, int32_t security) {
+    auto& list = postings_[security];
+    auto p = findPosting(list, filingId);
+    if (p != list.end() && p->filing == filingId) list.erase(p);
+}
+
+void HolderIndex::addFiling(int64_t filingId, int64_t cik, const string& firmName, const string& quarter,
+                            const vector<Holding>& holdings, bool amend, bool dropMissing) {
+    auto [it, inserted] = filings_.try_emplace(filingId);
+    FilingEntry& entry = it->second;
+    if (inserted) {
+        entry.firm = firms_.intern(cik, firmName);
+        entry.quarter = quarters_.intern(quarter);
+        entry.securities.reserve(holdings.size());
+    }
+    vector<int32_t> listed;
+    listed.reserve(holdings.size());
+    for (const Holding& h : holdings) {
+        if (!h.putCall.empty()) continue;
+        int32_t security = cusips_.intern(h.cusip);
+        add(filingId, entry, security, h.shares, h.value, amend);
+        listed.push_back(security);
+    }
+
+    if (dropMissing) {
+        sort(listed.begin(), listed.end());
+        vector<int32_t> kept;
+        for (int32_t s : entry.securities) {
+            if (binary_search(listed.begin(), listed.end(), s)) kept.push_back(s);
+            else remove(filingId, s);
+        }
+        entry.securities.swap(kept);
+    }
+}
+
+bool HolderIndex::build(sqlite3* db) {
+    *this = HolderIndex();
+
+    // The version and the rows are read from the same snapshot
+    bool snapshot = sqlite3_get_autocommit(db) && sqlite3_exec(db, "BEGIN;", nullptr, nullptr, nullptr) == SQLITE_OK;
+    int64_t version = holdingsVersion(db);
+    auto done = [&](bool ok) {
+        if (snapshot) sqlite3_exec(db, "COMMIT;", nullptr, nullptr, nullptr);
+        return ok;
+    };
+
+    const char* sql =
+        "SELECT h.filing_id, fi.cik, fi.name, f.quarter, s.cusip, h.shares, h.value "
+        "FROM holdings h "
+        "JOIN securities s ON h.security_id = s.id "
+        "JOIN filings f ON h.filing_id = f.id "
+        "JOIN firms fi ON f.firm_id = fi.id "
+        "WHERE h.put_call = '' "
+        "ORDER BY h.filing_id;";
+    sqlite3_stmt* stmt;
+    if (sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr) != SQLITE_OK) {
+        cerr << "SQL error: " << sqlite3_errmsg(db) << endl;
+        return done(false);
+    }
+
+    int64_t currentId = -1;
+    FilingEntry* current = nullptr;
+    int rc;
+    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+        int64_t filingId = sqlite3_column_int64(stmt, 0);
+        if (!current || filingId != currentId) {
+            currentId = filingId;
+            current = &filings_[filingId];
+            current->firm = firms_.intern(sqlite3_column_int64(stmt, 1), columnText(stmt, 2));
+            current->quarter = quarters_.intern(columnText(stmt, 3));
+        }
+        add(filingId, *current, cusips_.intern(columnText(stmt, 4)), sqlite3_column_int64(stmt, 5),
+            sqlite3_column_int64(stmt, 6));
+    }
+    sqlite3_finalize(stmt);
+    if (rc != SQLITE_DONE) {
+        cerr << "SQL error: " << sqlite3_errmsg(db) << endl;
+        return done(false);
+    }
+    watermark_ = version;
+    return done(true);
+}
+
+bool HolderIndex::save(const string& path) const {
+    string out;
+    out.reserve(64 + postings() * (sizeof(HolderPosting) + sizeof(int32_t)));
+    out.append(kMagic, sizeof(kMagic));
+    put<int64_t>(out, watermark_);
+    putFirms(out, firms_);
+    putDictionary(out, quarters_);
+    putDictionary(out, cusips_);
+
+    put<uint64_t>(out, filings_.size());
+    for (const auto& [id, entry] : filings_) {
+        put<int64_t>(out, id);
+        put<int32_t>(out, entry.firm);
+        put<int32_t>(out, entry.quarter);
+        put<uint32_t>(out, static_cast<uint32_t>(entry.securities.size()));
+        out.append(reinterpret_cast<const char*>(entry.securities.data()),
+                   entry.securities.size() * sizeof(int32_t));
+    }
+    put<uint32_t>(out, static_cast<uint32_t>(postings_.size()));
+    for (const auto& list : postings_) {
+        put<uint32_t>(out, static_cast<uint32_t>(list.size()));
+        for (const auto& p : list) {
+            put<int64_t>(out, p.filing);
+            put<int64_t>(out, p.shares);
+            put<int64_t>(out, p.value);
+        }
+    }
+
+    string tmp = path + ".tmp";
+    {
+        ofstream file(tmp, ios::binary | ios::trunc);
+        if (!file) {
+            cerr << "Can't write holder index: " << tmp << endl;
+            return false;
+        }
+        file.write(out.data(), static_cast<streamsize>(out.size()));
+        if (!file) {
+            cerr << "Can't write holder index: " << tmp << endl;
+            return false;
+        }
+    }
+    error_code ec;
+    fs::rename(tmp, path, ec);
+    if (ec) {
+        fs::remove(tmp, ec);
+        cerr << "Can't write holder index: " << path << endl;
+        return false;
+    }
+    return true;
+}
+
+bool HolderIndex::load(const string& path) {
+    *this = HolderIndex();
+    MappedFile file;
+    if (!file.open(path) || file.size() < sizeof(kMagic) || memcmp(file.data(), kMagic, sizeof(kMagic)) != 0) {
+        return false;
+    }
+
+    Reader r{file.data() + sizeof(kMagic), file.data() + file.size()};
+    watermark_ = r.get<int64_t>();
+    r.getFirms(firms_);
+    r.getDictionary(quarters_);
+    r.getDictionary(cusips_);
+
+    uint64_t filingCount = r.get<uint64_t>();
+    filings_.reserve(r.ok ? filingCount : 0);
+    for (uint64_t i = 0; r.ok && i < filingCount; ++i) {
+        int64_t id = r.get<int64_t>();
+        FilingEntry& entry = filings_[id];
+        entry.firm = r.get<int32_t>();
+        entry.quarter = r.get<int32_t>();
+        uint32_t n = r.get<uint32_t>();
+        if (!r.ok || static_cast<size_t>(r.end - r.p) < n * sizeof(int32_t)) {
+            r.ok = false;
+            break;
+        }
+        entry.securities.resize(n);
+        memcpy(entry.securities.data(), r.p, n * sizeof(int32_t));
+        r.p += n * sizeof(int32_t);
+    }
+
+    uint32_t lists = r.get<uint32_t>();
+    if (r.ok) postings_.resize(lists);
+    for (uint32_t s = 0; r.ok && s < lists; ++s) {
+        uint32_t n = r.get<uint32_t>();
+        auto& list = postings_[s];
+        list.reserve(r.ok ? n : 0);
+        for (uint32_t i = 0; r.ok && i < n; ++i) {
+            int64_t filingId = r.get<int64_t>();
+            int64_t shares = r.get<int64_t>();
+            int64_t value = r.get<int64_t>();
+            list.push_back(HolderPosting{filingId, shares, value});
+        }
+    }
+
+    // Codes index the dictionaries and postings_ directly, so a truncated or
+    // stale file must not get past here; each CUSIP list is kept sorted
+    bool valid = r.ok && postings_.size() <= cusips_.size();
+    for (auto it = filings_.begin(); valid && it != filings_.end(); ++it) {
+        const FilingEntry& entry = it->second;
+        const auto& secs = entry.securities;
+        valid = entry.firm >= 0 && static_cast<size_t>(entry.firm) < firms_.size() && entry.quarter >= 0 &&
+                static_cast<size_t>(entry.quarter) < quarters_.size() &&
+                adjacent_find(secs.begin(), secs.end(), greater_equal<int32_t>()) == secs.end() &&
+                (secs.empty() || (secs.front() >= 0 && static_cast<size_t>(secs.back()) < postings_.size()));
+    }
+    if (!valid) {
+        cerr << "Holder index is corrupt: " << path << endl;
+        *this = HolderIndex();
+        return false;
+    }
+    return true;
+}
+
+const HolderIndex::FilingEntry* HolderIndex::filing(int64_t filingId) const {
+    auto it = filings_.find(filingId);
+    return it == filings_.end() ? nullptr : &it->second;
+}
+
+size_t HolderIndex::postings() const {
+    size_t n = 0;
+    for (const auto& list : postings_) n += list.size();
+    return n;
+}
+
+bool HolderIndex::inQuarter(int64_t filingId, int32_t quarter) const {
+    if (quarter < 0) return true;
+    const FilingEntry* entry = filing(filingId);
+    return entry && entry->quarter == quarter;
+}
+
+vector<HolderPosting> HolderIndex::holders(const string& cusip, const string& quarter) const {
+    vector<HolderPosting> result;
+    int32_t code = cusips_.find(cusip);
+    if (code < 0 || static_cast<size_t>(code) >= postings_.size()) return result;
+    int32_t q = quarter.empty() ? -1 : quarters_.find(quarter);
+    if (!quarter.empty() && q < 0) return result;
+
+    for (const auto& p : postings_[code]) {
+        if (inQuarter(p.filing, q)) result.push_back(p);
+    }
+    return result;
+}
+
+vector<int64_t> HolderIndex::commonHolders(const string& a, const string& b, const string& quarter) const {
+    vector<int64_t> result;
+    int32_t ca = cusips_.find(a), cb = cusips_.find(b);
+    if (ca < 0 || cb < 0 || static_cast<size_t>(max(ca, cb)) >= postings_.size()) return result;
+    int32_t q = quarter.empty() ? -1 : quarters_.find(quarter);
+    if (!quarter.empty() && q < 0) return result;
+
+    const auto& la = postings_[ca];
+    const auto& lb = postings_[cb];
+    size_t i = 0, j = 0;
+    while (i < la.size() && j < lb.size()) {
+        if (la[i].filing < lb[j].filing) {
+            ++i;
+        } else if (lb[j].filing < la[i].filing) {
+            ++j;
+        } else {
+            if (inQuarter(la[i].filing, q)) result.push_back(la[i].filing);
+            ++i;
+            ++j;
+        }
+    }
+    return result;
+}
+
+vector<HolderIndex::CoHolding> HolderIndex::coHoldings(const string& cusip, const string& quarter,
+                                                       size_t limit) const {
+    vector<CoHolding> result;
+    vector<HolderPosting> holding = holders(cusip, quarter);
+    if (holding.empty()) return result;
+    int32_t self = cusips_.find(cusip);
+
+    // |postings(X) ∩ holders(cusip)| for every X at once: walk each holder's
+    // CUSIP list and count, rather than intersecting list by list
+    vector<uint32_t> counts(cusips_.size(), 0);
+    vector<int32_t> touched;
+    for (const auto& h : holding) {
+        const FilingEntry* entry = filing(h.filing);
+        if (!entry) continue;
+        for (int32_t s : entry->securities) {
+            if (s == self) continue;
+            if (counts[s]++ == 0) touched.push_back(s);
+        }
+    }
+    result.reserve(touched.size());
+    for (int32_t s : touched) result.push_back(CoHolding{s, counts[s], 0});
+
+    auto byHolders = [](const CoHolding& a, const CoHolding& b) {
+        return a.holders != b.holders ? a.holders > b.holders : a.security < b.security;
+    };
+    if (limit && result.size() > limit) {
+        partial_sort(result.begin(), result.begin() + limit, result.end(), byHolders);
+        result.resize(limit);
+    } else {
+        sort(result.begin(), result.end(), byHolders);
+    }
+
+    // Value only for the rows shown: one more intersection per result
+    for (auto& c : result) {
+        const auto& list = postings_[c.security];
+        size_t i = 0;
+        for (const auto& h : holding) {
+            while (i < list.size() && list[i].filing < h.filing) ++i;
+            if (i < list.size() && list[i].filing == h.filing) c.value += list[i].value;
+        }
+    }
+    return result;
+}
+
+int64_t holdingsVersion(sqlite3* db) {
+    int64_t version = -1;
+    sqlite3_stmt* stmt;
+    if (sqlite3_prepare_v2(db, "SELECT value FROM meta WHERE key = 'holdings_version';", -1, &stmt, nullptr) !=
+        SQLITE_OK) {
+        cerr << "SQL error: " << sqlite3_errmsg(db) << endl;
+        return -1;
+    }
+    if (sqlite3_step(stmt) == SQLITE_ROW) version = sqlite3_column_int64(stmt, 0);
+    sqlite3_finalize(stmt);
+    return version;
+}
+
+string holderIndexPath(sqlite3* db) {
+    const char* file = sqlite3_db_filename(db, "main");
+    return string(file ? file : "holdings.db") + ".hidx";
+}
+
+bool openHolderIndex(HolderIndex& index, sqlite3* db, const string& path) {
+    int64_t version = holdingsVersion(db);
+    if (index.load(path) && version >= 0 && index.watermark() == version) return true;
+
+    cerr << "Rebuilding holder index " << path << "..." << endl;
+    if (!index.build(db)) return false;
+    return index.save(path);
+}
+
+bool saveHolderIndex(const HolderIndex& index, const string& path) {
+    return index.save(path);
+}
@@ -0,0 +1,105 @@
+// holder_index.h
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <sqlite3.h>
+#include "columnar_store.h"
+#include "sec_parser.h"
+
+// One filing's position in a security
+struct HolderPosting {
+    int64_t filing;   // filings.id
+    int64_t shares;
+    int64_t value;
+};
+
+// Bidirectional holdings index for the "who owns this, and what else do they
+// own" queries.
+//
+// CUSIP -> posting list of filings holding it, sorted by filing id, and
+// filing -> sorted list of CUSIP codes it holds. Only share positions count
+// as holding a security; put and call rows are left out, so a filing has at
+// most one posting per CUSIP. Both sides are appended to
+// as the writer inserts filings, and the whole index is persisted to a
+// binary file next to holdings.db so queries never touch SQLite.
+class HolderIndex {
+public:
+    struct FilingEntry {
+        int32_t firm;                   // code in firms()
+        int32_t quarter;                // code in quarters()
+        std::vector<int32_t> securities; // codes in cusips(), ascending
+    };
+
+    struct CoHolding {
+        int32_t security;   // code in cusips()
+        size_t holders = 0; // filings holding both securities
+        int64_t value = 0;  // their combined value in `security`
+    };
+
+    // Adds one stored filing. CUSIPs the filing already holds are skipped,
+    // mirroring INSERT OR IGNORE on holdings, unless `amend` is set: then they
+    // take the new numbers, and with `dropMissing` (a restatement) CUSIPs not
+    // in `holdings` are removed from the filing. cik is 0 for a firm known
+    // only by name.
+    void addFiling(int64_t filingId, int64_t cik, const std::string& firmName, const std::string& quarter,
+                   const std::vector<Holding>& holdings, bool amend = false, bool dropMissing = false);
+    // Rebuilds from holdings.db, replacing the current contents
+    bool build(sqlite3* db);
+
+    bool save(const std::string& path) const;
+    bool load(const std::string& path);
+
+    // Postings for `cusip`; an empty quarter means all quarters
+    std::vector<HolderPosting> holders(const std::string& cusip, const std::string& quarter = "") const;
+    // Filings holding both securities, by intersecting their posting lists
+    std::vector<int64_t> commonHolders(const std::string& a, const std::string& b,
+                                       const std::string& quarter = "") const;
+    // Other securities held by the holders of `cusip`, most shared first
+    std::vector<CoHolding> coHoldings(const std::string& cusip, const std::string& quarter = "",
+                                      size_t limit = 20) const;
+
+    const FilingEntry* filing(int64_t filingId) const;
+    const FirmDictionary& firms() const { return firms_; }
+    const StringDictionary& quarters() const { return quarters_; }
+    const StringDictionary& cusips() const { return cusips_; }
+    size_t postings() const;
+
+    // meta.holdings_version the index reflects; used to detect a stale file
+    int64_t watermark() const { return watermark_; }
+    // Follows a committed batch that took holdings_version from `before` to
+    // `after`. If the index was not at `before`, another writer changed the
+    // table in between and the index is marked stale.
+    void advance(int64_t before, int64_t after) { watermark_ = watermark_ == before ? after : -1; }
+
+private:
+    void add(int64_t filingId, FilingEntry& entry, int32_t security, int64_t shares, int64_t value,
+             bool amend = false);
+    void remove(int64_t filingId, int32_t security);
+    bool inQuarter(int64_t filingId, int32_t quarter) const;
+
+    FirmDictionary firms_;
+    StringDictionary quarters_;
+    StringDictionary cusips_;
+    std::vector<std::vector<HolderPosting>> postings_;   // indexed by CUSIP code
+    std::unordered_map<int64_t, FilingEntry> filings_;
+    int64_t watermark_ = 0;
+};
+
+// meta.holdings_version: bumped by every writer batch that inserts, updates
+// or deletes holdings rows; -1 if it cannot be read
+int64_t holdingsVersion(sqlite3* db);
+
+// The index file for a database: "<database file>.hidx"
+std::string holderIndexPath(sqlite3* db);
+
+// Loads the index from `path`, rebuilding it from the database when the
+// file is missing or does not match the holdings table
+bool openHolderIndex(HolderIndex& index, sqlite3* db, const std::string& path);
+// Writes the index out with the watermark it has followed to; an index that
+// missed a change is saved stale and rebuilt by the next openHolderIndex
+bool saveHolderIndex(const HolderIndex& index, const std::string& path);
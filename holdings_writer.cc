@@ -0,0 +1,683 @@
+#include "holdings_writer.h"
+#include "metrics.h"
+#include <algorithm>
+#include <iostream>
+#include <set>
+
+using namespace std;
+
+namespace {
+
+void bindOptional(sqlite3_stmt* stmt, int index, const string& value) {
+    if (value.empty()) sqlite3_bind_null(stmt, index);
+    else sqlite3_bind_text(stmt, index, value.c_str(), static_cast<int>(value.size()), SQLITE_STATIC);
+}
+
+void bindCik(sqlite3_stmt* stmt, int index, int64_t cik) {
+    if (cik) sqlite3_bind_int64(stmt, index, cik);
+    else sqlite3_bind_null(stmt, index);
+}
+
+// Quarter a report for `period` (YYYY-MM-DD) is filed in when on time: the
+// one after it
+string filingQuarterFor(const string& period) {
+    if (period.size() < 7) return "";
+    int year = atoi(period.substr(0, 4).c_str());
+    int month = atoi(period.substr(5, 2).c_str());
+    if (year <= 0 || month < 1 || month > 12) return "";
+    int q = (month - 1) / 3 + 2;
+    if (q > 4) {
+        q = 1;
+        ++year;
+    }
+    return to_string(year) + "Q" + to_string(q);
+}
+
+void bindText(sqlite3_stmt* stmt, int index, const string& value) {
+    sqlite3_bind_text(stmt, index, value.c_str(), static_cast<int>(value.size()), SQLITE_STATIC);
+}
+
+} // namespace
+
+void FilingRecord::consolidate(bool keepLines) {
+    if (keepLines) lines = holdings;
+    consolidateHoldings(holdings);
+}
+
+HoldingsWriter::HoldingsWriter(sqlite3* db, size_t filingsPerTransaction)
+    : db_(db), filingsPerTransaction_(filingsPerTransaction ? filingsPerTransaction : 1), ledger_(db),
+      securities_(db) {}
+
+HoldingsWriter::~HoldingsWriter() {
+    finish();
+    flush();
+    sqlite3_finalize(upsertFirm_);
+    sqlite3_finalize(selectFirmByName_);
+    sqlite3_finalize(insertFirm_);
+    sqlite3_finalize(upsertFirmName_);
+    sqlite3_finalize(renameFirm_);
+    sqlite3_finalize(selectFiling_);
+    sqlite3_finalize(selectAmended_);
+    sqlite3_finalize(selectFilingByAccession_);
+    sqlite3_finalize(insertFiling_);
+    sqlite3_finalize(updateFiling_);
+    sqlite3_finalize(insertHolding_);
+    sqlite3_finalize(selectHolding_);
+    sqlite3_finalize(upsertHolding_);
+    sqlite3_finalize(selectFilingHoldings_);
+    sqlite3_finalize(deleteHolding_);
+    sqlite3_finalize(insertLine_);
+    sqlite3_finalize(selectLastLine_);
+    sqlite3_finalize(deleteFilingLines_);
+    sqlite3_finalize(deletePositionLines_);
+    sqlite3_finalize(upsertFirmStats_);
+    sqlite3_finalize(upsertIssuerStats_);
+    sqlite3_finalize(upsertQuarterStats_);
+    sqlite3_finalize(bumpVersion_);
+}
+
+bool HoldingsWriter::prepare() {
+    if (prepared_) return true;
+
+    struct { sqlite3_stmt** stmt; const char* sql; } statements[] = {
+        {&upsertFirm_,
+         "INSERT INTO firms (cik, name) VALUES (?, ?) "
+         "ON CONFLICT(cik) DO UPDATE SET cik = excluded.cik RETURNING id;"},
+        {&selectFirmByName_,
+         "SELECT id FROM firms WHERE name = ? ORDER BY id LIMIT 1;"},
+        {&insertFirm_,
+         "INSERT INTO firms (name) VALUES (?) RETURNING id;"},
+        {&upsertFirmName_,
+         "INSERT INTO firm_names (firm_id, name, first_quarter, last_quarter) VALUES (?1, ?2, ?3, ?3) "
+         "ON CONFLICT(firm_id, name) DO UPDATE SET first_quarter = MIN(first_quarter, excluded.first_quarter), "
+         "last_quarter = MAX(last_quarter, excluded.last_quarter);"},
+        // firms.name follows the name of the latest quarter on record
+        {&renameFirm_,
+         "UPDATE firms SET name = ?2 WHERE id = ?1 AND name IS NOT ?2 "
+         "AND ?3 >= (SELECT MAX(last_quarter) FROM firm_names WHERE firm_id = ?1);"},
+        // Originals: same period of report, else same quarter among rows
+        // without one. A stored amendment of the period is taken over; so is
+        // one in the quarter when the original's period is unknown, as that
+        // is the quarter an amendment is stored in for the original to find
+        {&selectFiling_,
+         "SELECT id, quarter, form_type IS '13F-HR/A' AND amendment_type IS 'RESTATEMENT' FROM filings "
+         "WHERE firm_id = ?1 AND (period_of_report = ?3 OR (quarter = ?2 AND (?3 IS NULL "
+         "OR (period_of_report IS NULL AND form_type IS NOT '13F-HR/A')))) "
+         "ORDER BY period_of_report IS ?3 DESC, form_type IS '13F-HR/A', id LIMIT 1;"},
+        // Amendments: the original for the period, else an earlier amendment's
+        // own row; ?3 is the quarter an original without a period was filed in
+        {&selectAmended_,
+         "SELECT id, quarter FROM filings WHERE firm_id = ?1 AND (period_of_report = ?2 "
+         "OR (period_of_report IS NULL AND quarter = ?3 AND form_type IS NOT '13F-HR/A')) "
+         "ORDER BY form_type IS '13F-HR/A', period_of_report IS NULL, id LIMIT 1;"},
+        {&selectFilingByAccession_,
+         "SELECT id, quarter FROM filings WHERE accession = ? ORDER BY id LIMIT 1;"},
+        {&insertFiling_,
+         "INSERT INTO filings (firm_id, filing_date, quarter, accession, cik, form_type, period_of_report, "
+         "amendment_type) VALUES (?, ?, ?, ?, ?, ?, ?, ?) RETURNING id;"},
+        // An amendment keeps the original's accession but records its type;
+        // an original (?7) taking over an amendment's row puts in its own
+        {&updateFiling_,
+         "UPDATE filings SET accession = CASE WHEN ?7 THEN COALESCE(?1, accession) ELSE COALESCE(accession, ?1) END, "
+         "cik = COALESCE(cik, ?2), "
+         "form_type = CASE WHEN ?7 THEN COALESCE(?3, form_type) ELSE COALESCE(form_type, ?3) END, "
+         "period_of_report = COALESCE(period_of_report, ?4), amendment_type = COALESCE(?5, amendment_type) "
+         "WHERE id = ?6;"},
+        {&insertHolding_,
+         "INSERT OR IGNORE INTO holdings (filing_id, security_id, shares, value, put_call) "
+         "VALUES (?, ?, ?, ?, ?);"},
+        {&selectHolding_,
+         "SELECT shares, value FROM holdings WHERE filing_id = ? AND security_id = ? AND put_call = ?;"},
+        {&upsertHolding_,
+         "INSERT INTO holdings (filing_id, security_id, shares, value, put_call) "
+         "VALUES (?, ?, ?, ?, ?) "
+         "ON CONFLICT(filing_id, security_id, put_call) DO UPDATE SET "
+         "shares = excluded.shares, value = excluded.value;"},
+        {&selectFilingHoldings_,
+         "SELECT security_id, put_call, shares, value FROM holdings WHERE filing_id = ?;"},
+        {&deleteHolding_,
+         "DELETE FROM holdings WHERE filing_id = ? AND security_id = ? AND put_call = ?;"},
+        {&insertLine_,
+         "INSERT OR IGNORE INTO holdings_detail (filing_id, line, security_id, title_of_class, shares, shares_type, "
+         "value, put_call, investment_discretion, other_manager, voting_sole, voting_shared, voting_none) "
+         "VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?);"},
+        {&selectLastLine_,
+         "SELECT COALESCE(MAX(line), 0) FROM holdings_detail WHERE filing_id = ?;"},
+        {&deleteFilingLines_,
+         "DELETE FROM holdings_detail WHERE filing_id = ?;"},
+        {&deletePositionLines_,
+         "DELETE FROM holdings_detail WHERE filing_id = ? AND security_id = ? AND put_call = ?;"},
+        {&upsertFirmStats_,
+         "INSERT INTO quarter_firm_stats (quarter, firm_id, firm_name, total_value, total_shares, num_holdings) "
+         "VALUES (?, ?, ?, ?, ?, ?) "
+         "ON CONFLICT(quarter, firm_id) DO UPDATE SET firm_name = excluded.firm_name, "
+         "total_value = total_value + excluded.total_value, total_shares = total_shares + excluded.total_shares, "
+         "num_holdings = num_holdings + excluded.num_holdings;"},
+        {&upsertIssuerStats_,
+         "INSERT INTO issuer_quarter_stats (quarter, security_id, total_value, total_shares, num_holders) "
+         "VALUES (?, ?, ?, ?, ?) "
+         "ON CONFLICT(quarter, security_id) DO UPDATE SET total_value = total_value + excluded.total_value, total_shares = total_shares + excluded.total_shares, "
+         "num_holders = num_holders + excluded.num_holders;"},
+        {&upsertQuarterStats_,
+         "INSERT INTO quarter_stats (quarter, num_filings, total_value, total_shares, num_holdings) "
+         "VALUES (?, ?, ?, ?, ?) "
+         "ON CONFLICT(quarter) DO UPDATE SET num_filings = num_filings + excluded.num_filings, "
+         "total_value = total_value + excluded.total_value, total_shares = total_shares + excluded.total_shares, "
+         "num_holdings = num_holdings + excluded.num_holdings;"},
+        {&bumpVersion_,
+         "UPDATE meta SET value = value + 1 WHERE key = 'holdings_version' RETURNING value;"},
+    };
+    for (auto& s : statements) {
+        if (sqlite3_prepare_v3(db_, s.sql, -1, SQLITE_PREPARE_PERSISTENT, s.stmt, nullptr) != SQLITE_OK) {
+            cerr << "SQL error: " << sqlite3_errmsg(db_) << endl;
+            return false;
+        }
+    }
+    prepared_ = true;
+    return true;
+}
+
+bool HoldingsWriter::begin() {
+    if (inTransaction_) return true;
+    if (sqlite3_exec(db_, "BEGIN TRANSACTION;", nullptr, nullptr, nullptr) != SQLITE_OK) {
+        cerr << "SQL error: " << sqlite3_errmsg(db_) << endl;
+        return false;
+    }
+    inTransaction_ = true;
+    return true;
+}
+
+void HoldingsWriter::clearStats() {
+    firmStats_.clear();
+    issuerStats_.clear();
+    quarterStats_.clear();
+}
+
+bool HoldingsWriter::applyStats() {
+    bool ok = true;
+    auto step = [&](sqlite3_stmt* stmt) {
+        if (sqlite3_step(stmt) != SQLITE_DONE) {
+            cerr << "SQL error: " << sqlite3_errmsg(db_) << endl;
+            ok = false;
+        }
+        sqlite3_reset(stmt);
+    };
+
+    for (const auto& [key, d] : firmStats_) {
+        sqlite3_bind_text(upsertFirmStats_, 1, key.first.c_str(), -1, SQLITE_STATIC);
+        sqlite3_bind_int64(upsertFirmStats_, 2, key.second);
+        sqlite3_bind_text(upsertFirmStats_, 3, d.name.c_str(), -1, SQLITE_STATIC);
+        sqlite3_bind_int64(upsertFirmStats_, 4, d.value);
+        sqlite3_bind_int64(upsertFirmStats_, 5, d.shares);
+        sqlite3_bind_int64(upsertFirmStats_, 6, d.rows);
+        step(upsertFirmStats_);
+    }
+    for (const auto& [key, d] : issuerStats_) {
+        sqlite3_bind_text(upsertIssuerStats_, 1, key.first.c_str(), -1, SQLITE_STATIC);
+        sqlite3_bind_int64(upsertIssuerStats_, 2, key.second);
+        sqlite3_bind_int64(upsertIssuerStats_, 3, d.value);
+        sqlite3_bind_int64(upsertIssuerStats_, 4, d.shares);
+        sqlite3_bind_int64(upsertIssuerStats_, 5, d.rows);
+        step(upsertIssuerStats_);
+    }
+    for (const auto& [quarter, d] : quarterStats_) {
+        sqlite3_bind_text(upsertQuarterStats_, 1, quarter.c_str(), -1, SQLITE_STATIC);
+        sqlite3_bind_int64(upsertQuarterStats_, 2, d.filings);
+        sqlite3_bind_int64(upsertQuarterStats_, 3, d.value);
+        sqlite3_bind_int64(upsertQuarterStats_, 4, d.shares);
+        sqlite3_bind_int64(upsertQuarterStats_, 5, d.rows);
+        step(upsertQuarterStats_);
+    }
+    clearStats();
+    return ok;
+}
+
+bool HoldingsWriter::bumpVersion() {
+    if (!holdingsChanged_) return true;
+    bool ok = sqlite3_step(bumpVersion_) == SQLITE_ROW;
+    if (ok) version_ = sqlite3_column_int64(bumpVersion_, 0);
+    else cerr << "SQL error: " << sqlite3_errmsg(db_) << endl;
+    sqlite3_reset(bumpVersion_);
+    return ok;
+}
+
+void HoldingsWriter::finishBatch(bool committed) {
+    if (committed) {
+        if (hook_) {
+            for (const auto& [filingId, filing] : pendingHooks_) hook_(filingId, filing);
+        }
+        if (holdingsChanged_ && commitHook_) commitHook_(version_ - 1, version_);
+    }
+    else {
+        failures_ += filingsWritten_ - committedFilings_;
+        filingsWritten_ = committedFilings_;
+        rowsWritten_ = committedRows_;
+    }
+    committedFilings_ = filingsWritten_;
+    committedRows_ = rowsWritten_;
+    pendingHooks_.clear();
+    holdingsChanged_ = false;
+}
+
+void HoldingsWriter::rollback(const string& error) {
+    sqlite3_exec(db_, "ROLLBACK;", nullptr, nullptr, nullptr);
+    // Ids handed out inside the failed transaction no longer exist
+    firmsByCik_.clear();
+    firmsByName_.clear();
+    securities_.clear();
+    clearStats();
+    finishBatch(false);
+
+    // The batch's committed marks went with it; record the failures on their own
+    if (!batchAccessions_.empty() && sqlite3_exec(db_, "BEGIN TRANSACTION;", nullptr, nullptr, nullptr) == SQLITE_OK) {
+        for (const string& accession : batchAccessions_) {
+            ledger_.update(LedgerUpdate{accession, IngestState::Failed, error});
+        }
+        if (sqlite3_exec(db_, "END TRANSACTION;", nullptr, nullptr, nullptr) != SQLITE_OK) {
+            cerr << "SQL error: " << sqlite3_errmsg(db_) << endl;
+            sqlite3_exec(db_, "ROLLBACK;", nullptr, nullptr, nullptr);
+        }
+    }
+    batchAccessions_.clear();
+}
+
+bool HoldingsWriter::flush() {
+    if (!inTransaction_) return true;
+    StageTimer timer(Stage::Commit);
+    inTransaction_ = false;
+    pendingFilings_ = 0;
+    // Stats land in the same transaction as the rows they describe
+    if (!applyStats() || !bumpVersion()) {
+        rollback("stats update failed");
+        return false;
+    }
+    // A failed COMMIT (SQLITE_BUSY, I/O error) may leave the transaction open
+    if (sqlite3_exec(db_, "END TRANSACTION;", nullptr, nullptr, nullptr) != SQLITE_OK) {
+        string error = sqlite3_errmsg(db_);
+        cerr << "SQL error: " << error << endl;
+        rollback("commit failed: " + error);
+        return false;
+    }
+    batchAccessions_.clear();
+    finishBatch(true);
+    return true;
+}
+
+int64_t HoldingsWriter::firmId(const FilingRecord& filing) {
+    if (!filing.cik) return firmIdByName(filing);
+
+    auto it = firmsByCik_.find(filing.cik);
+    if (it == firmsByCik_.end()) {
+        int64_t id = -1;
+        sqlite3_bind_int64(upsertFirm_, 1, filing.cik);
+        sqlite3_bind_text(upsertFirm_, 2, filing.firmName.c_str(), -1, SQLITE_STATIC);
+        if (sqlite3_step(upsertFirm_) == SQLITE_ROW) {
+            id = sqlite3_column_int64(upsertFirm_, 0);
+        }
+        sqlite3_reset(upsertFirm_);
+        if (id == -1) return -1;
+        it = firmsByCik_.emplace(filing.cik, CachedFirm{id, "", "", ""}).first;
+    }
+
+    CachedFirm& firm = it->second;
+    if (filing.firmName.empty()) return firm.id;
+    if (filing.firmName != firm.name) {
+        noteFirmName(firm.id, filing.firmName, filing.quarter);
+        firm.name = filing.firmName;
+        firm.firstQuarter = firm.lastQuarter = filing.quarter;
+    } else if (filing.quarter < firm.firstQuarter || filing.quarter > firm.lastQuarter) {
+        noteFirmName(firm.id, filing.firmName, filing.quarter);
+        firm.firstQuarter = min(firm.firstQuarter, filing.quarter);
+        firm.lastQuarter = max(firm.lastQuarter, filing.quarter);
+    }
+    return firm.id;
+}
+
+int64_t HoldingsWriter::firmIdByName(const FilingRecord& filing) {
+    auto it = firmsByName_.find(filing.firmName);
+    if (it != firmsByName_.end()) return it->second;
+
+    int64_t id = -1;
+    sqlite3_bind_text(selectFirmByName_, 1, filing.firmName.c_str(), -1, SQLITE_STATIC);
+    if (sqlite3_step(selectFirmByName_) == SQLITE_ROW) {
+        id = sqlite3_column_int64(selectFirmByName_, 0);
+    }
+    sqlite3_reset(selectFirmByName_);
+
+    if (id == -1) {
+        sqlite3_bind_text(insertFirm_, 1, filing.firmName.c_str(), -1, SQLITE_STATIC);
+        if (sqlite3_step(insertFirm_) == SQLITE_ROW) {
+            id = sqlite3_column_int64(insertFirm_, 0);
+        }
+        sqlite3_reset(insertFirm_);
+        if (id != -1 && !filing.firmName.empty()) noteFirmName(id, filing.firmName, filing.quarter);
+    }
+    if (id != -1) firmsByName_.emplace(filing.firmName, id);
+    return id;
+}
+
+void HoldingsWriter::noteFirmName(int64_t firm, const string& name, const string& quarter) {
+    for (sqlite3_stmt* stmt : {upsertFirmName_, renameFirm_}) {
+        sqlite3_bind_int64(stmt, 1, firm);
+        sqlite3_bind_text(stmt, 2, name.c_str(), -1, SQLITE_STATIC);
+        sqlite3_bind_text(stmt, 3, quarter.c_str(), -1, SQLITE_STATIC);
+        if (sqlite3_step(stmt) != SQLITE_DONE) {
+            cerr << "SQL error: " << sqlite3_errmsg(db_) << endl;
+        }
+        sqlite3_reset(stmt);
+    }
+}
+
+HoldingsWriter::FilingTarget HoldingsWriter::filingFor(int64_t firm, const FilingRecord& filing) {
+    FilingTarget target;
+    auto found = [&](sqlite3_stmt* stmt) {
+        if (sqlite3_step(stmt) == SQLITE_ROW) {
+            target.id = sqlite3_column_int64(stmt, 0);
+            target.quarter = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 1));
+            if (sqlite3_column_count(stmt) > 2) target.superseded = sqlite3_column_int(stmt, 2) != 0;
+        }
+        sqlite3_reset(stmt);
+        return target.id != -1;
+    };
+
+    if (!filing.amendment) {
+        sqlite3_bind_int64(selectFiling_, 1, firm);
+        sqlite3_bind_text(selectFiling_, 2, filing.quarter.c_str(), -1, SQLITE_STATIC);
+        bindOptional(selectFiling_, 3, filing.periodOfReport);
+        if (found(selectFiling_)) return target;
+        return insertFiling(firm, filing, filing.quarter);
+    }
+
+    // Without a period of report the original cannot be told apart, so the
+    // amendment keeps its own row (found again by accession on a rerun)
+    string quarter = filingQuarterFor(filing.periodOfReport);
+    if (quarter.empty()) {
+        if (!filing.accession.empty()) {
+            sqlite3_bind_text(selectFilingByAccession_, 1, filing.accession.c_str(), -1, SQLITE_STATIC);
+            if (found(selectFilingByAccession_)) return target;
+        }
+        return insertFiling(firm, filing, filing.quarter);
+    }
+    sqlite3_bind_int64(selectAmended_, 1, firm);
+    sqlite3_bind_text(selectAmended_, 2, filing.periodOfReport.c_str(), -1, SQLITE_STATIC);
+    sqlite3_bind_text(selectAmended_, 3, quarter.c_str(), -1, SQLITE_STATIC);
+    if (found(selectAmended_)) return target;
+    return insertFiling(firm, filing, quarter);
+}
+
+HoldingsWriter::FilingTarget HoldingsWriter::insertFiling(int64_t firm, const FilingRecord& filing,
+                                                          const string& quarter) {
+    FilingTarget target;
+    sqlite3_bind_int64(insertFiling_, 1, firm);
+    sqlite3_bind_text(insertFiling_, 2, filing.filingDate.c_str(), -1, SQLITE_STATIC);
+    sqlite3_bind_text(insertFiling_, 3, quarter.c_str(), -1, SQLITE_STATIC);
+    bindOptional(insertFiling_, 4, filing.accession);
+    bindCik(insertFiling_, 5, filing.cik);
+    bindOptional(insertFiling_, 6, filing.formType);
+    bindOptional(insertFiling_, 7, filing.periodOfReport);
+    bindOptional(insertFiling_, 8, filing.amendmentType);
+    if (sqlite3_step(insertFiling_) == SQLITE_ROW) {
+        target.id = sqlite3_column_int64(insertFiling_, 0);
+        target.quarter = quarter;
+        target.created = true;
+    }
+    sqlite3_reset(insertFiling_);
+    return target;
+}
+
+bool HoldingsWriter::writeHolding(int64_t filing_id, int64_t security, const Holding& h, bool amendment,
+                                  int64_t& oldShares, int64_t& oldValue, bool& existed) {
+    oldShares = oldValue = 0;
+    existed = false;
+    if (amendment) {
+        sqlite3_bind_int64(selectHolding_, 1, filing_id);
+        sqlite3_bind_int64(selectHolding_, 2, security);
+        bindText(selectHolding_, 3, h.putCall);
+        if (sqlite3_step(selectHolding_) == SQLITE_ROW) {
+            oldShares = sqlite3_column_int64(selectHolding_, 0);
+            oldValue = sqlite3_column_int64(selectHolding_, 1);
+            existed = true;
+        }
+        sqlite3_reset(selectHolding_);
+    }
+
+    sqlite3_stmt* stmt = amendment ? upsertHolding_ : insertHolding_;
+    sqlite3_bind_int64(stmt, 1, filing_id);
+    sqlite3_bind_int64(stmt, 2, security);
+    sqlite3_bind_int64(stmt, 3, h.shares);
+    sqlite3_bind_int64(stmt, 4, h.value);
+    bindText(stmt, 5, h.putCall);
+    bool stored = false;
+    if (sqlite3_step(stmt) != SQLITE_DONE) {
+        cerr << "SQL error: " << sqlite3_errmsg(db_) << endl;
+    } else {
+        stored = sqlite3_changes(db_) > 0;
+        holdingsChanged_ = holdingsChanged_ || stored;
+    }
+    sqlite3_reset(stmt);
+    return stored;
+}
+
+void HoldingsWriter::dropUnlisted(int64_t filing_id, const FilingRecord& filing, const string& quarter, int64_t firm,
+                                  const vector<int64_t>& securities) {
+    set<pair<int64_t, string>> listed;
+    for (size_t i = 0; i < securities.size(); ++i) listed.emplace(securities[i], filing.holdings[i].putCall);
+
+    struct Row { int64_t security; string putCall; int64_t shares, value; };
+    vector<Row> dropped;
+    sqlite3_bind_int64(selectFilingHoldings_, 1, filing_id);
+    while (sqlite3_step(selectFilingHoldings_) == SQLITE_ROW) {
+        int64_t security = sqlite3_column_int64(selectFilingHoldings_, 0);
+        auto putCall = reinterpret_cast<const char*>(sqlite3_column_text(selectFilingHoldings_, 1));
+        pair<int64_t, string> position(security, putCall ? putCall : "");
+        if (listed.count(position)) continue;
+        dropped.push_back(Row{security, std::move(position.second), sqlite3_column_int64(selectFilingHoldings_, 2),
+                              sqlite3_column_int64(selectFilingHoldings_, 3)});
+    }
+    sqlite3_reset(selectFilingHoldings_);
+
+    StatsDelta& firmDelta = firmStats_[make_pair(quarter, firm)];
+    StatsDelta& quarterDelta = quarterStats_[quarter];
+    for (const Row& r : dropped) {
+        sqlite3_bind_int64(deleteHolding_, 1, filing_id);
+        sqlite3_bind_int64(deleteHolding_, 2, r.security);
+        bindText(deleteHolding_, 3, r.putCall);
+        bool ok = sqlite3_step(deleteHolding_) == SQLITE_DONE;
+        if (!ok) cerr << "SQL error: " << sqlite3_errmsg(db_) << endl;
+        sqlite3_reset(deleteHolding_);
+        if (!ok) continue;
+        holdingsChanged_ = true;
+
+        for (StatsDelta* d : {&firmDelta, &quarterDelta}) {
+            d->value -= r.value;
+            d->shares -= r.shares;
+            d->rows -= 1;
+        }
+        if (!r.putCall.empty()) continue;
+        StatsDelta& issuer = issuerStats_[make_pair(quarter, r.security)];
+        issuer.value -= r.value;
+        issuer.shares -= r.shares;
+        issuer.rows -= 1;
+    }
+}
+
+void HoldingsWriter::writeLines(int64_t filing_id, const FilingRecord& filing) {
+    auto step = [&](sqlite3_stmt* stmt) {
+        if (sqlite3_step(stmt) != SQLITE_DONE) cerr << "SQL error: " << sqlite3_errmsg(db_) << endl;
+        sqlite3_reset(stmt);
+    };
+
+    // Amended positions lose their old lines even when this run keeps none,
+    // so the detail never contradicts the positions
+    int64_t lastLine = 0;
+    if (filing.isRestatement()) {
+        sqlite3_bind_int64(deleteFilingLines_, 1, filing_id);
+        step(deleteFilingLines_);
+    } else if (filing.amendment) {
+        for (size_t i = 0; i < filing.holdings.size(); ++i) {
+            if (!securityIds_[i]) continue;
+            sqlite3_bind_int64(deletePositionLines_, 1, filing_id);
+            sqlite3_bind_int64(deletePositionLines_, 2, securityIds_[i]);
+            bindText(deletePositionLines_, 3, filing.holdings[i].putCall);
+            step(deletePositionLines_);
+        }
+        if (!filing.lines.empty()) {
+            sqlite3_bind_int64(selectLastLine_, 1, filing_id);
+            if (sqlite3_step(selectLastLine_) == SQLITE_ROW) lastLine = sqlite3_column_int64(selectLastLine_, 0);
+            sqlite3_reset(selectLastLine_);
+        }
+    }
+
+    // Lines are numbered in filing order, after those of earlier amendments
+    for (size_t i = 0; i < filing.lines.size(); ++i) {
+        const Holding& h = filing.lines[i];
+        int64_t security = securities_.intern(h);
+        if (!security) continue;
+        sqlite3_bind_int64(insertLine_, 1, filing_id);
+        sqlite3_bind_int64(insertLine_, 2, lastLine + static_cast<int64_t>(i) + 1);
+        sqlite3_bind_int64(insertLine_, 3, security);
+        bindOptional(insertLine_, 4, h.titleOfClass);
+        sqlite3_bind_int64(insertLine_, 5, h.shares);
+        bindOptional(insertLine_, 6, h.sharesType);
+        sqlite3_bind_int64(insertLine_, 7, h.value);
+        bindText(insertLine_, 8, h.putCall);
+        bindOptional(insertLine_, 9, h.investmentDiscretion);
+        bindOptional(insertLine_, 10, h.otherManager);
+        sqlite3_bind_int64(insertLine_, 11, h.votingSole);
+        sqlite3_bind_int64(insertLine_, 12, h.votingShared);
+        sqlite3_bind_int64(insertLine_, 13, h.votingNone);
+        step(insertLine_);
+    }
+}
+
+bool HoldingsWriter::write(const FilingRecord& filing) {
+    StageTimer timer(Stage::WriteFiling);
+    if (!prepare() || !begin()) {
+        ++failures_;
+        return false;
+    }
+
+    int64_t firm = firmId(filing);
+    FilingTarget target = firm == -1 ? FilingTarget() : filingFor(firm, filing);
+    int64_t filing_id = target.id;
+    const string& quarter = target.quarter;
+    if (filing_id == -1) {
+        std::cerr << "Error: filing_id not found for firm " << filing.firmName
+                  << " and quarter " << filing.quarter << std::endl;
+        ++failures_;
+        if (!filing.accession.empty()) {
+            ledger_.update(LedgerUpdate{filing.accession, IngestState::Failed, "filing_id not found"});
+        }
+        return false;
+    }
+
+    if (!target.created && !filing.accession.empty()) {
+        sqlite3_bind_text(updateFiling_, 1, filing.accession.c_str(), -1, SQLITE_STATIC);
+        bindCik(updateFiling_, 2, filing.cik);
+        // An original without a form type must not take the amendment's
+        bindOptional(updateFiling_, 3, filing.amendment ? string() : filing.formType);
+        bindOptional(updateFiling_, 4, filing.periodOfReport);
+        bindOptional(updateFiling_, 5, filing.amendmentType);
+        sqlite3_bind_int64(updateFiling_, 6, filing_id);
+        sqlite3_bind_int(updateFiling_, 7, filing.amendment ? 0 : 1);
+        if (sqlite3_step(updateFiling_) != SQLITE_DONE) {
+            cerr << "SQL error: " << sqlite3_errmsg(db_) << endl;
+        }
+        sqlite3_reset(updateFiling_);
+    }
+
+    securityIds_.clear();
+    for (const Holding& h : filing.holdings) securityIds_.push_back(securities_.intern(h));
+    if (filing.isRestatement()) dropUnlisted(filing_id, filing, quarter, firm, securityIds_);
+
+    // A restatement on record already replaced everything this original lists
+    size_t rows = target.superseded ? 0 : filing.holdings.size();
+    StatsDelta total;
+    for (size_t i = 0; i < rows; ++i) {
+        const Holding& h = filing.holdings[i];
+        int64_t oldShares, oldValue;
+        bool existed;
+        if (!securityIds_[i] ||
+            !writeHolding(filing_id, securityIds_[i], h, filing.amendment, oldShares, oldValue, existed)) {
+            continue;
+        }
+        ++rowsWritten_;
+
+        // Issuers count holders of the shares; options are not holdings of the issuer
+        if (h.putCall.empty()) {
+            StatsDelta& issuer = issuerStats_[make_pair(quarter, securityIds_[i])];
+            issuer.value += h.value - oldValue;
+            issuer.shares += h.shares - oldShares;
+            issuer.rows += existed ? 0 : 1;
+        }
+        total.value += h.value - oldValue;
+        total.shares += h.shares - oldShares;
+        total.rows += existed ? 0 : 1;
+    }
+
+    if (filing.amendment || (!filing.lines.empty() && !target.superseded)) writeLines(filing_id, filing);
+
+    StatsDelta& firmDelta = firmStats_[make_pair(quarter, firm)];
+    firmDelta.name = filing.firmName;
+    firmDelta.value += total.value;
+    firmDelta.shares += total.shares;
+    firmDelta.rows += total.rows;
+    StatsDelta& quarterDelta = quarterStats_[quarter];
+    quarterDelta.value += total.value;
+    quarterDelta.shares += total.shares;
+    quarterDelta.rows += total.rows;
+    quarterDelta.filings += target.created ? 1 : 0;
+
+    if (!filing.accession.empty()) {
+        ledger_.update(LedgerUpdate{filing.accession, IngestState::Committed, ""});
+        batchAccessions_.push_back(filing.accession);
+    }
+    ++filingsWritten_;
+    countMetric(Counter::FilingsWritten);
+    countMetric(Counter::RowsInserted, total.rows);
+    if (hook_ && !target.superseded) {
+        pendingHooks_.emplace_back(filing_id, filing);
+        // The quarter the rows went to, which an amendment's own may differ from
+        pendingHooks_.back().second.quarter = quarter;
+    }
+
+    if (++pendingFilings_ >= filingsPerTransaction_) {
+        return flush();
+    }
+    return true;
+}
+
+bool HoldingsWriter::record(const LedgerUpdate& update) {
+    // Rides along with the open transaction, if any
+    if (!begin()) return false;
+    return ledger_.update(update);
+}
+
+void HoldingsWriter::start(size_t queueCapacity) {
+    if (queue_) return;
+    queue_ = make_unique<BoundedQueue<variant<FilingRecord, LedgerUpdate>>>(queueCapacity);
+    thread_ = thread([this] {
+        while (auto item = queue_->pop()) {
+            if (auto* filing = get_if<FilingRecord>(&*item)) write(*filing);
+            else record(get<LedgerUpdate>(*item));
+        }
+        flush();
+    });
+}
+
+bool HoldingsWriter::submit(FilingRecord filing) {
+    if (!queue_) return write(filing);
+    return queue_->push(std::move(filing));
+}
+
+bool HoldingsWriter::submit(LedgerUpdate update) {
+    if (!queue_) return record(update);
+    return queue_->push(std::move(update));
+}
+
+void HoldingsWriter::finish() {
+    if (!queue_) return;
+    queue_->close();
+    if (thread_.joinable()) thread_.join();
+    queue_.reset();
+}
@@ -0,0 +1,215 @@
+// holdings_writer.h
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <variant>
+#include <vector>
+#include <sqlite3.h>
+#include "bounded_queue.h"
+#include "ingest_ledger.h"
+#include "sec_parser.h"
+#include "securities.h"
+
+// One parsed filing ready to be stored
+struct FilingRecord {
+    std::string firmName;
+    std::string quarter;
+    std::string filingDate;
+    // One row per position (CUSIP and put/call) once consolidate() has run
+    std::vector<Holding> holdings;
+    // The rows as filed, for holdings_detail; empty unless kept by consolidate()
+    std::vector<Holding> lines;
+    // 13F-HR/A: rows replace the filing's existing rows for the same position
+    bool amendment = false;
+    // ingest_ledger key, marked committed with the rows; empty outside the pipeline
+    std::string accession;
+    // Firm key when known (0 otherwise: the firm is found by name); also
+    // stored on the filings row
+    int64_t cik = 0;
+    std::string formType;
+    std::string periodOfReport;
+    // RESTATEMENT amendments also drop the rows they no longer list
+    std::string amendmentType;
+
+    bool isRestatement() const { return amendment && amendmentType == "RESTATEMENT"; }
+    // Sums rows of the same position (consolidateHoldings), copying them to
+    // lines first if keepLines
+    void consolidate(bool keepLines);
+};
+
+// Owns every write to holdings.db during ingestion.
+//
+// Statements are prepared once and reused for the writer's lifetime, many
+// filings share one transaction, and firm ids are cached in memory so that
+// only the first filing of a firm pays for a lookup. Firms are keyed by CIK
+// and upserted with RETURNING; names go to firm_names only when a run sees a
+// new name or quarter for the firm. Filings without a CIK fall back to a
+// lookup by name. New filings take their id from RETURNING as well. Rows
+// reference their CUSIP through SecurityTable, by integer id. A filing's
+// lines, when kept, go to holdings_detail next to its positions.
+//
+// An original is found by (firm, period of report), or (firm, quarter) when
+// the period is unknown. An amendment joins the original for its period of
+// report, not the quarter it was filed in; with no original on record it is
+// stored as its own filing in the quarter the original would have been
+// filed, which the original then joins if it arrives later.
+//
+// The writer also keeps quarter_firm_stats, issuer_quarter_stats and
+// quarter_stats current: each filing's effect (rows actually inserted, or
+// new minus old for amended rows) is folded into in-memory deltas, which are
+// applied as one upsert per touched key just before the transaction commits.
+// Issuer stats take share positions only; firm and quarter stats take every row.
+//
+// write() may be called directly, or start() spawns a thread that drains a
+// bounded queue filled by submit() until finish() is called. Ingest ledger
+// transitions go through the same queue, so the writer thread stays the only
+// user of the connection. A batch that fails to commit is rolled back and
+// its accessions are marked failed, so a later run retries them.
+class HoldingsWriter {
+public:
+    explicit HoldingsWriter(sqlite3* db, size_t filingsPerTransaction = 64);
+    ~HoldingsWriter();
+
+    HoldingsWriter(const HoldingsWriter&) = delete;
+    HoldingsWriter& operator=(const HoldingsWriter&) = delete;
+
+    // Called on the writing thread for each filing of a batch once the batch
+    // has committed, e.g. to keep an in-memory index in step with the table;
+    // filings of a batch that rolled back are never reported
+    using FilingHook = std::function<void(int64_t filingId, const FilingRecord& filing)>;
+    void onFilingWritten(FilingHook hook) { hook_ = std::move(hook); }
+    // Called after the filing hooks of a batch that changed holdings, with
+    // meta.holdings_version before and after the batch
+    using CommitHook = std::function<void(int64_t before, int64_t after)>;
+    void onCommit(CommitHook hook) { commitHook_ = std::move(hook); }
+
+    bool write(const FilingRecord& filing);
+    // Commits the open transaction, if any
+    bool flush();
+
+    void start(size_t queueCapacity = 64);
+    bool submit(FilingRecord filing);
+    bool submit(LedgerUpdate update);
+    // Drains the queue, commits and joins the writer thread
+    void finish();
+
+    size_t filingsWritten() const { return filingsWritten_; }
+    size_t rowsWritten() const { return rowsWritten_; }
+    size_t failures() const { return failures_; }
+
+private:
+    bool prepare();
+    bool begin();
+    int64_t firmId(const FilingRecord& filing);
+    int64_t firmIdByName(const FilingRecord& filing);
+    // Records the name in firm_names and makes it current if the quarter is the latest
+    void noteFirmName(int64_t firmId, const std::string& name, const std::string& quarter);
+    // The filings row a record's rows go to
+    struct FilingTarget {
+        int64_t id = -1;
+        std::string quarter;       // the row's, which an amendment's own may differ from
+        bool created = false;
+        bool superseded = false;   // an original written after its restatement
+    };
+    FilingTarget filingFor(int64_t firmId, const FilingRecord& filing);
+    FilingTarget insertFiling(int64_t firmId, const FilingRecord& filing, const std::string& quarter);
+    // Stores one row; false if it was ignored as a duplicate
+    bool writeHolding(int64_t filingId, int64_t securityId, const Holding& h, bool amendment, int64_t& oldShares,
+                      int64_t& oldValue, bool& existed);
+    bool record(const LedgerUpdate& update);
+    // Deletes the filing's rows missing from a restatement, given the
+    // security ids of its holdings
+    void dropUnlisted(int64_t filingId, const FilingRecord& filing, const std::string& quarter, int64_t firm,
+                      const std::vector<int64_t>& listed);
+    // Replaces the amended positions' lines in holdings_detail and adds the filing's own
+    void writeLines(int64_t filingId, const FilingRecord& filing);
+    bool applyStats();
+    void clearStats();
+    // Bumps meta.holdings_version if the open transaction changed holdings
+    bool bumpVersion();
+    // Runs the hooks of a committed batch, or drops them after a rollback
+    void finishBatch(bool committed);
+    // Rolls back the open transaction and marks its filings failed in the ledger
+    void rollback(const std::string& error);
+
+    sqlite3* db_;
+    size_t filingsPerTransaction_;
+    bool prepared_ = false;
+    bool inTransaction_ = false;
+    size_t pendingFilings_ = 0;
+
+    sqlite3_stmt* upsertFirm_ = nullptr;
+    sqlite3_stmt* selectFirmByName_ = nullptr;
+    sqlite3_stmt* insertFirm_ = nullptr;
+    sqlite3_stmt* upsertFirmName_ = nullptr;
+    sqlite3_stmt* renameFirm_ = nullptr;
+    sqlite3_stmt* selectFiling_ = nullptr;
+    sqlite3_stmt* selectAmended_ = nullptr;
+    sqlite3_stmt* selectFilingByAccession_ = nullptr;
+    sqlite3_stmt* insertFiling_ = nullptr;
+    sqlite3_stmt* updateFiling_ = nullptr;
+    sqlite3_stmt* insertHolding_ = nullptr;
+    sqlite3_stmt* selectHolding_ = nullptr;
+    sqlite3_stmt* upsertHolding_ = nullptr;
+    sqlite3_stmt* selectFilingHoldings_ = nullptr;
+    sqlite3_stmt* deleteHolding_ = nullptr;
+    sqlite3_stmt* insertLine_ = nullptr;
+    sqlite3_stmt* selectLastLine_ = nullptr;
+    sqlite3_stmt* deleteFilingLines_ = nullptr;
+    sqlite3_stmt* deletePositionLines_ = nullptr;
+    sqlite3_stmt* upsertFirmStats_ = nullptr;
+    sqlite3_stmt* upsertIssuerStats_ = nullptr;
+    sqlite3_stmt* upsertQuarterStats_ = nullptr;
+    sqlite3_stmt* bumpVersion_ = nullptr;
+
+    // Per CIK: firm id, and the name and quarters already noted in firm_names
+    struct CachedFirm {
+        int64_t id = -1;
+        std::string name;
+        std::string firstQuarter;
+        std::string lastQuarter;
+    };
+    std::unordered_map<int64_t, CachedFirm> firmsByCik_;
+    std::unordered_map<std::string, int64_t> firmsByName_;
+
+    // Stats deltas of the open transaction
+    struct StatsDelta {
+        std::string name;       // firms only
+        int64_t value = 0;
+        int64_t shares = 0;
+        int64_t rows = 0;       // holdings for firms/quarters, holders for issuers
+        int64_t filings = 0;    // quarters only
+    };
+    std::map<std::pair<std::string, int64_t>, StatsDelta> firmStats_;         // (quarter, firm id)
+    std::map<std::pair<std::string, int64_t>, StatsDelta> issuerStats_;       // (quarter, security id)
+    std::map<std::string, StatsDelta> quarterStats_;
+
+    IngestLedger ledger_;
+    SecurityTable securities_;
+    std::vector<int64_t> securityIds_;      // per holding of the filing being written
+
+    FilingHook hook_;
+    CommitHook commitHook_;
+    std::vector<std::pair<int64_t, FilingRecord>> pendingHooks_;   // filings of the open transaction
+    std::vector<std::string> batchAccessions_;   // marked committed in the open transaction
+    bool holdingsChanged_ = false;
+    int64_t version_ = 0;   // holdings_version after the open transaction's bump
+    std::unique_ptr<BoundedQueue<std::variant<FilingRecord, LedgerUpdate>>> queue_;
+    std::thread thread_;
+
+    size_t filingsWritten_ = 0;
+    size_t rowsWritten_ = 0;
+    size_t failures_ = 0;
+    // The counts as of the last commit, restored by a rollback
+    size_t committedFilings_ = 0;
+    size_t committedRows_ = 0;
+};
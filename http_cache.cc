@@ -0,0 +1,179 @@
+#include "http_cache.h"
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <thread>
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+using namespace std;
+namespace fs = std::filesystem;
+
+namespace {
+
+// First byte of every object file
+const char kRaw = 'R';
+const char kZstd = 'Z';
+
+string hex64(uint64_t v) {
+    char buf[17];
+    snprintf(buf, sizeof(buf), "%016llx", static_cast<unsigned long long>(v));
+    return buf;
+}
+
+fs::path shardPath(const string& dir, const char* kind, const string& key) {
+    return fs::path(dir) / kind / key.substr(0, 2) / key;
+}
+
+bool readFile(const fs::path& path, string& out) {
+    ifstream in(path, ios::binary);
+    if (!in) return false;
+    ostringstream ss;
+    ss << in.rdbuf();
+    out = ss.str();
+    return true;
+}
+
+bool writeFileAtomic(const fs::path& path, const string& data) {
+    static atomic<uint64_t> counter{0};
+    error_code ec;
+    fs::create_directories(path.parent_path(), ec);
+
+    ostringstream tmpName;
+    tmpName << path.filename().string() << ".tmp" << this_thread::get_id() << "-" << counter++;
+    fs::path tmp = path.parent_path() / tmpName.str();
+    {
+        ofstream out(tmp, ios::binary | ios::trunc);
+        if (!out) return false;
+        out.write(data.data(), static_cast<streamsize>(data.size()));
+        if (!out) return false;
+    }
+    fs::rename(tmp, path, ec);
+    if (ec) {
+        fs::remove(tmp, ec);
+        return false;
+    }
+    return true;
+}
+
+// Undoes the one-byte format tag and any compression of a stored object
+bool decodeObject(const string& stored, string& body) {
+    if (stored.empty()) return false;
+    if (stored[0] == kRaw) {
+        body.assign(stored, 1, string::npos);
+        return true;
+    }
+#ifdef HAVE_ZSTD
+    if (stored[0] == kZstd) {
+        unsigned long long size = ZSTD_getFrameContentSize(stored.data() + 1, stored.size() - 1);
+        if (size == ZSTD_CONTENTSIZE_ERROR || size == ZSTD_CONTENTSIZE_UNKNOWN) return false;
+        body.resize(size);
+        size_t n = ZSTD_decompress(&body[0], body.size(), stored.data() + 1, stored.size() - 1);
+        if (ZSTD_isError(n)) return false;
+        body.resize(n);
+        return true;
+    }
+#endif
+    return false;
+}
+
+} // namespace
+
+uint64_t fnv1a64(const char* data, size_t len) {
+    uint64_t h = 1469598103934665603ULL;
+    for (size_t i = 0; i < len; ++i) {
+        h ^= static_cast<unsigned char>(data[i]);
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+bool HttpCache::open(const string& dir, bool compress) {
+    error_code ec;
+    fs::create_directories(fs::path(dir) / "urls", ec);
+    fs::create_directories(fs::path(dir) / "objects", ec);
+    if (ec) {
+        cerr << "Could not create cache directory: " << dir << " (" << ec.message() << ")" << endl;
+        return false;
+    }
+    dir_ = dir;
+    compress_ = compress;
+    return true;
+}
+
+bool HttpCache::lookup(const string& url, string& body) {
+    if (!enabled()) return false;
+
+    // URL entries hold "<contentKey>\n<url>"; the URL guards against hash collisions
+    string entry;
+    size_t nl = string::npos;
+    if (readFile(shardPath(dir_, "urls", hex64(fnv1a64(url.data(), url.size()))), entry)) {
+        nl = entry.find('\n');
+    }
+    if (nl == string::npos || nl < 2 || entry.compare(nl + 1, string::npos, url) != 0) {
+        ++misses_;
+        return false;
+    }
+    string contentKey = entry.substr(0, nl);
+
+    string stored;
+    if (!readFile(shardPath(dir_, "objects", contentKey), stored) || !decodeObject(stored, body)) {
+        ++misses_;
+        return false;
+    }
+    ++hits_;
+    return true;
+}
+
+void HttpCache::store(const string& url, const string& body) {
+    if (!enabled()) return;
+
+    // Key on content hash plus length so equal hashes of different sizes never
+    // collide. An object already under the key is only shared if its content
+    // matches; a true collision moves on to "<key>-1", "<key>-2" and so on.
+    string baseKey = hex64(fnv1a64(body.data(), body.size())) + "-" + to_string(body.size());
+    string contentKey = baseKey;
+    fs::path objectPath = shardPath(dir_, "objects", contentKey);
+    string existing, existingBody;
+    for (int n = 1; readFile(objectPath, existing); ++n) {
+        if (decodeObject(existing, existingBody) && existingBody == body) break;
+        contentKey = baseKey + "-" + to_string(n);
+        objectPath = shardPath(dir_, "objects", contentKey);
+        existing.clear();
+    }
+
+    if (existing.empty()) {
+        string stored;
+#ifdef HAVE_ZSTD
+        if (compress_) {
+            stored.resize(1 + ZSTD_compressBound(body.size()));
+            stored[0] = kZstd;
+            size_t n = ZSTD_compress(&stored[1], stored.size() - 1, body.data(), body.size(), 3);
+            if (ZSTD_isError(n)) {
+                stored.clear();
+            } else {
+                stored.resize(1 + n);
+            }
+        }
+#endif
+        if (stored.empty()) {
+            stored.reserve(body.size() + 1);
+            stored.push_back(kRaw);
+            stored.append(body);
+        }
+        if (!writeFileAtomic(objectPath, stored)) {
+            cerr << "Could not write cache object: " << objectPath.string() << endl;
+            return;
+        }
+    }
+
+    writeFileAtomic(shardPath(dir_, "urls", hex64(fnv1a64(url.data(), url.size()))), contentKey + "\n" + url);
+}
+
+HttpCache& httpCache() {
+    static HttpCache cache;
+    return cache;
+}
@@ -0,0 +1,49 @@
+// http_cache.h
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+// Persistent cache of EDGAR responses. EDGAR archive documents never change
+// once an accession is published, so a cached body is valid forever.
+//
+// Layout under the cache directory:
+//   urls/<aa>/<urlhash>       -> content key of the body fetched from that URL, then the URL
+//   objects/<aa>/<contentkey> -> the body, zstd-compressed when available
+//
+// Bodies are stored once per distinct content, so identical documents under
+// different URLs share an object. Neither 64-bit hash is trusted alone: a
+// hit compares the URL saved in the entry, and an object is only shared
+// after its content compares equal. Writes go to a temp file and are renamed
+// into place, so concurrent workers never see partial entries.
+class HttpCache {
+public:
+    // Enables the cache in `dir`, creating it if needed
+    bool open(const std::string& dir, bool compress = true);
+    bool enabled() const { return !dir_.empty(); }
+
+    // In offline mode callers must not go to the network on a miss
+    void setOffline(bool offline) { offline_ = offline; }
+    bool offline() const { return offline_; }
+
+    bool lookup(const std::string& url, std::string& body);
+    void store(const std::string& url, const std::string& body);
+
+    uint64_t hits() const { return hits_; }
+    uint64_t misses() const { return misses_; }
+
+private:
+    std::string dir_;
+    bool compress_ = true;
+    bool offline_ = false;
+    std::atomic<uint64_t> hits_{0};
+    std::atomic<uint64_t> misses_{0};
+};
+
+// Process-wide cache used by fetchURL; disabled until open() is called
+HttpCache& httpCache();
+
+// 64-bit FNV-1a, used for cache keys
+uint64_t fnv1a64(const char* data, size_t len);
@@ -0,0 +1,295 @@
+#include "http_client.h"
+#include "metrics.h"
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <unordered_map>
+
+using namespace std;
+
+namespace {
+
+const char* kUserAgent = "FinanceApp/1.0 (Contact: vilhelm.helsing@gmail.com)";
+const int kMaxAttempts = 4;
+
+size_t appendBody(void* contents, size_t size, size_t nmemb, string* output) {
+    countMetric(Counter::BytesFetched, size * nmemb);
+    output->append((char*)contents, size * nmemb);
+    return size * nmemb;
+}
+
+struct StreamState {
+    CURL* handle;
+    const HttpClient::ChunkHandler* onChunk;
+};
+
+size_t streamBody(void* contents, size_t size, size_t nmemb, StreamState* state) {
+    size_t len = size * nmemb;
+    countMetric(Counter::BytesFetched, len);
+    long status = 0;
+    curl_easy_getinfo(state->handle, CURLINFO_RESPONSE_CODE, &status);
+    // Error pages are drained but never reach the handler
+    if (status != 200) return len;
+    return (*state->onChunk)(static_cast<const char*>(contents), len) ? len : 0;
+}
+
+void lockShare(CURL*, curl_lock_data data, curl_lock_access, void* userptr) {
+    static_cast<mutex*>(userptr)[data].lock();
+}
+
+void unlockShare(CURL*, curl_lock_data data, void* userptr) {
+    static_cast<mutex*>(userptr)[data].unlock();
+}
+
+} // namespace
+
+struct HttpClient::Transfer {
+    Request request;
+    string body;
+};
+
+HttpClient::HttpClient() {
+    share_ = curl_share_init();
+    curl_share_setopt(share_, CURLSHOPT_LOCKFUNC, lockShare);
+    curl_share_setopt(share_, CURLSHOPT_UNLOCKFUNC, unlockShare);
+    curl_share_setopt(share_, CURLSHOPT_USERDATA, shareLocks_);
+    curl_share_setopt(share_, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+    curl_share_setopt(share_, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+
+    headers_ = curl_slist_append(headers_, "Accept: application/xml, text/xml, */*;q=0.9");
+    headers_ = curl_slist_append(headers_, "Connection: keep-alive");
+}
+
+HttpClient::~HttpClient() {
+    shutdown();
+}
+
+void HttpClient::shutdown() {
+    {
+        lock_guard<mutex> lock(loopMutex_);
+        stopping_ = true;
+        if (multi_) curl_multi_wakeup(multi_);
+    }
+    if (loopThread_.joinable()) loopThread_.join();
+
+    {
+        lock_guard<mutex> lock(poolMutex_);
+        for (CURL* handle : pool_) curl_easy_cleanup(handle);
+        pool_.clear();
+    }
+    if (share_) {
+        curl_share_cleanup(share_);
+        share_ = nullptr;
+    }
+    if (headers_) {
+        curl_slist_free_all(headers_);
+        headers_ = nullptr;
+    }
+}
+
+CURL* HttpClient::acquireHandle() {
+    {
+        lock_guard<mutex> lock(poolMutex_);
+        if (!pool_.empty()) {
+            CURL* handle = pool_.back();
+            pool_.pop_back();
+            return handle;
+        }
+    }
+    CURL* handle = curl_easy_init();
+    if (!handle) return nullptr;
+    curl_easy_setopt(handle, CURLOPT_SHARE, share_);
+    curl_easy_setopt(handle, CURLOPT_HTTPHEADER, headers_);
+    curl_easy_setopt(handle, CURLOPT_USERAGENT, kUserAgent);
+    curl_easy_setopt(handle, CURLOPT_REFERER, "https://www.sec.gov/");
+    curl_easy_setopt(handle, CURLOPT_FOLLOWLOCATION, 1L);
+    curl_easy_setopt(handle, CURLOPT_ACCEPT_ENCODING, "");
+    curl_easy_setopt(handle, CURLOPT_TCP_KEEPALIVE, 1L);
+    curl_easy_setopt(handle, CURLOPT_WRITEFUNCTION, appendBody);
+    return handle;
+}
+
+void HttpClient::releaseHandle(CURL* handle) {
+    // Drop the pointer to the finished transfer's buffer before pooling
+    curl_easy_setopt(handle, CURLOPT_WRITEDATA, nullptr);
+    lock_guard<mutex> lock(poolMutex_);
+    pool_.push_back(handle);
+}
+
+void HttpClient::configureHandle(CURL* handle, const string& url, string* body) {
+    curl_easy_setopt(handle, CURLOPT_URL, url.c_str());
+    curl_easy_setopt(handle, CURLOPT_WRITEDATA, body);
+}
+
+FetchResult HttpClient::get(const string& url) {
+    StageTimer timer(Stage::Fetch);
+    FetchResult result;
+    CURL* handle = acquireHandle();
+    if (!handle) {
+        cerr << "curl_easy_init() failed" << endl;
+        result.code = CURLE_FAILED_INIT;
+        return result;
+    }
+
+    for (int attempt = 1;; ++attempt) {
+        {
+            StageTimer wait(Stage::RateLimitWait);
+            limiter_.acquire();
+        }
+        result.body.clear();
+        result.status = 0;
+        configureHandle(handle, url, &result.body);
+        result.code = curl_easy_perform(handle);
+        curl_easy_getinfo(handle, CURLINFO_RESPONSE_CODE, &result.status);
+        if (!handleThrottle(handle, result.status, attempt)) break;
+    }
+    releaseHandle(handle);
+    return result;
+}
+
+FetchResult HttpClient::stream(const string& url, const ChunkHandler& onChunk) {
+    StageTimer timer(Stage::Fetch);
+    FetchResult result;
+    CURL* handle = acquireHandle();
+    if (!handle) {
+        cerr << "curl_easy_init() failed" << endl;
+        result.code = CURLE_FAILED_INIT;
+        return result;
+    }
+
+    StreamState state{handle, &onChunk};
+    curl_easy_setopt(handle, CURLOPT_URL, url.c_str());
+    curl_easy_setopt(handle, CURLOPT_WRITEFUNCTION, streamBody);
+    curl_easy_setopt(handle, CURLOPT_WRITEDATA, &state);
+    for (int attempt = 1;; ++attempt) {
+        {
+            StageTimer wait(Stage::RateLimitWait);
+            limiter_.acquire();
+        }
+        result.status = 0;
+        result.code = curl_easy_perform(handle);
+        curl_easy_getinfo(handle, CURLINFO_RESPONSE_CODE, &result.status);
+        if (!handleThrottle(handle, result.status, attempt)) break;
+    }
+    curl_easy_setopt(handle, CURLOPT_WRITEFUNCTION, appendBody);
+    releaseHandle(handle);
+    return result;
+}
+
+bool HttpClient::handleThrottle(CURL* handle, long status, int attempts) {
+    countHttpStatus(status);
+    if (status != 429 && status != 503) {
+        if (status == 200) limiter_.onSuccess();
+        return false;
+    }
+    curl_off_t retryAfter = 0;
+    curl_easy_getinfo(handle, CURLINFO_RETRY_AFTER, &retryAfter);
+    limiter_.onThrottled(std::chrono::seconds(retryAfter));
+    if (attempts >= kMaxAttempts) return false;
+    countMetric(Counter::HttpRetries);
+    return true;
+}
+
+void HttpClient::fetchMany(const vector<string>& urls, Callback cb) {
+    for (const auto& url : urls) enqueue(Request{url, cb});
+}
+
+void HttpClient::enqueue(Request request) {
+    lock_guard<mutex> lock(loopMutex_);
+    if (stopping_) {
+        FetchResult aborted;
+        aborted.code = CURLE_ABORTED_BY_CALLBACK;
+        request.callback(request.url, std::move(aborted));
+        return;
+    }
+    if (!multi_) {
+        multi_ = curl_multi_init();
+        curl_multi_setopt(multi_, CURLMOPT_MAX_HOST_CONNECTIONS, 8L);
+        loopThread_ = thread(&HttpClient::runLoop, this);
+    }
+    pending_.push_back(std::move(request));
+    curl_multi_wakeup(multi_);
+}
+
+void HttpClient::runLoop() {
+    unordered_map<CURL*, unique_ptr<Transfer>> active;
+    deque<Request> waiting;   // requests held back by the rate limiter
+
+    for (;;) {
+        bool stop;
+        {
+            lock_guard<mutex> lock(loopMutex_);
+            for (auto& request : pending_) waiting.push_back(std::move(request));
+            pending_.clear();
+            stop = stopping_;
+        }
+        if (stop && active.empty() && waiting.empty()) break;
+
+        int pollMs = 1000;
+        while (!waiting.empty()) {
+            TokenBucket::Clock::duration wait;
+            if (!limiter_.tryAcquire(wait)) {
+                auto ms = chrono::duration_cast<chrono::milliseconds>(wait).count() + 1;
+                pollMs = static_cast<int>(min<long long>(pollMs, ms));
+                break;
+            }
+            Request request = std::move(waiting.front());
+            waiting.pop_front();
+            ++request.attempts;
+
+            auto transfer = make_unique<Transfer>();
+            transfer->request = std::move(request);
+            CURL* handle = acquireHandle();
+            if (!handle) {
+                FetchResult failed;
+                failed.code = CURLE_FAILED_INIT;
+                transfer->request.callback(transfer->request.url, std::move(failed));
+                continue;
+            }
+            configureHandle(handle, transfer->request.url, &transfer->body);
+            curl_multi_add_handle(multi_, handle);
+            active.emplace(handle, std::move(transfer));
+        }
+
+        int running = 0;
+        curl_multi_perform(multi_, &running);
+
+        int queued = 0;
+        while (CURLMsg* msg = curl_multi_info_read(multi_, &queued)) {
+            if (msg->msg != CURLMSG_DONE) continue;
+            CURL* handle = msg->easy_handle;
+            auto it = active.find(handle);
+
+            FetchResult result;
+            result.code = msg->data.result;
+            curl_easy_getinfo(handle, CURLINFO_RESPONSE_CODE, &result.status);
+            bool retry = it != active.end() && handleThrottle(handle, result.status, it->second->request.attempts);
+            curl_multi_remove_handle(multi_, handle);
+            releaseHandle(handle);
+
+            if (it != active.end()) {
+                unique_ptr<Transfer> transfer = std::move(it->second);
+                active.erase(it);
+                if (retry) {
+                    waiting.push_back(std::move(transfer->request));
+                    pollMs = 0;
+                    continue;
+                }
+                result.body = std::move(transfer->body);
+                transfer->request.callback(transfer->request.url, std::move(result));
+            }
+        }
+
+        curl_multi_poll(multi_, nullptr, 0, pollMs, nullptr);
+    }
+
+    lock_guard<mutex> lock(loopMutex_);
+    curl_multi_cleanup(multi_);
+    multi_ = nullptr;
+}
+
+HttpClient& httpClient() {
+    static HttpClient client;
+    return client;
+}
@@ -0,0 +1,92 @@
+// http_client.h
+
+#pragma once
+
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <curl/curl.h>
+#include "rate_limiter.h"
+
+struct FetchResult {
+    std::string body;
+    long status = 0;           // HTTP status, 0 if the transfer failed
+    CURLcode code = CURLE_OK;
+
+    bool ok() const { return code == CURLE_OK && status == 200; }
+};
+
+// HTTP client for www.sec.gov that keeps connections alive between requests.
+// Easy handles are pooled instead of created per request, and each keeps its
+// own live connection, so a reused handle skips the TCP+TLS handshake. The
+// DNS and TLS session caches are shared through a CURLSH; the connection
+// cache is not, as libcurl does not support sharing it between threads.
+//
+// Every request, sync or async, first takes a token from the shared
+// TokenBucket and is retried with backoff on 429/503.
+//
+// get() is a blocking call that can be made from any thread. fetchMany()
+// hands requests to a curl_multi event loop running on its own thread, which
+// drives many transfers at once over the multi handle's connection cache;
+// master indexes are downloaded this way.
+class HttpClient {
+public:
+    using Callback = std::function<void(const std::string& url, FetchResult result)>;
+    // Receives body bytes as they arrive; return false to abort the transfer
+    using ChunkHandler = std::function<bool(const char* data, size_t len)>;
+
+    HttpClient();
+    ~HttpClient();
+
+    HttpClient(const HttpClient&) = delete;
+    HttpClient& operator=(const HttpClient&) = delete;
+
+    FetchResult get(const std::string& url);
+    // Like get() but hands 200-response bytes to onChunk instead of buffering
+    // them; result.body stays empty. Aborted transfers report CURLE_WRITE_ERROR.
+    FetchResult stream(const std::string& url, const ChunkHandler& onChunk);
+    // Calls cb once per URL, on the event loop thread, as transfers finish
+    void fetchMany(const std::vector<std::string>& urls, Callback cb);
+
+    TokenBucket& rateLimiter() { return limiter_; }
+
+    // Releases all handles. Must be called before curl_global_cleanup().
+    void shutdown();
+
+private:
+    struct Request {
+        std::string url;
+        Callback callback;
+        int attempts = 0;
+    };
+    struct Transfer;
+
+    CURL* acquireHandle();
+    void releaseHandle(CURL* handle);
+    void configureHandle(CURL* handle, const std::string& url, std::string* body);
+    void enqueue(Request request);
+    void runLoop();
+    // Feeds the response status to the limiter; true if the request should be retried
+    bool handleThrottle(CURL* handle, long status, int attempts);
+
+    TokenBucket limiter_{10.0, 10.0};
+
+    CURLSH* share_ = nullptr;
+    curl_slist* headers_ = nullptr;
+    std::mutex shareLocks_[CURL_LOCK_DATA_LAST];
+
+    std::mutex poolMutex_;
+    std::vector<CURL*> pool_;
+
+    std::mutex loopMutex_;
+    std::deque<Request> pending_;
+    CURLM* multi_ = nullptr;
+    std::thread loopThread_;
+    bool stopping_ = false;
+};
+
+// Process-wide client used by fetchURL
+HttpClient& httpClient();
@@ -0,0 +1,48 @@
+// Reports master.idx scan throughput for every .idx file in a directory.
+// Usage: idx_bench [dir=master_idx] [iterations=20]
+
+#include "idx_scanner.h"
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+
+using namespace std;
+namespace fs = std::filesystem;
+
+int main(int argc, char* argv[]) {
+    string dir = argc > 1 ? argv[1] : "master_idx";
+    int iterations = argc > 2 ? atoi(argv[2]) : 20;
+    if (iterations < 1) iterations = 1;
+
+    error_code ec;
+    if (!fs::is_directory(dir, ec)) {
+        cerr << "Not a directory: " << dir << endl;
+        return 1;
+    }
+
+    for (const auto& entry : fs::directory_iterator(dir)) {
+        if (entry.path().extension() != ".idx") continue;
+
+        MappedFile file;
+        if (!file.open(entry.path().string())) {
+            cerr << "Could not open file: " << entry.path() << endl;
+            continue;
+        }
+
+        size_t lines = scanMasterIndex(file.data(), file.size(), [](const IdxRecord&) {});
+        size_t filings = 0;
+        auto start = chrono::steady_clock::now();
+        for (int i = 0; i < iterations; ++i) {
+            filings = scan13FHRFilings(file.data(), file.size()).size();
+        }
+        chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+        double perPass = elapsed.count() / iterations;
+
+        cout << entry.path().filename().string() << ": "
+             << lines << " lines, " << filings << " 13F-HR, "
+             << static_cast<long long>(lines / perPass) << " lines/s, "
+             << static_cast<long long>(file.size() / perPass / (1024 * 1024)) << " MB/s" << endl;
+    }
+    return 0;
+}
@@ -0,0 +1,232 @@
+#include "idx_scanner.h"
+#include <cstring>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+MappedFile::~MappedFile() {
+    close();
+}
+
+#ifdef _WIN32
+
+bool MappedFile::open(const string& path) {
+    close();
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                              FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE) return false;
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size)) {
+        CloseHandle(file);
+        return false;
+    }
+    file_ = file;
+    size_ = static_cast<size_t>(size.QuadPart);
+    if (size_ == 0) return true;
+
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!mapping) {
+        close();
+        return false;
+    }
+    mapping_ = mapping;
+    data_ = static_cast<const char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+    if (!data_) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+void MappedFile::close() {
+    if (data_) UnmapViewOfFile(data_);
+    if (mapping_) CloseHandle(static_cast<HANDLE>(mapping_));
+    if (file_) CloseHandle(static_cast<HANDLE>(file_));
+    data_ = nullptr;
+    mapping_ = nullptr;
+    file_ = nullptr;
+    size_ = 0;
+}
+
+#else
+
+bool MappedFile::open(const string& path) {
+    close();
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        ::close(fd);
+        return false;
+    }
+    size_ = static_cast<size_t>(st.st_size);
+    if (size_ > 0) {
+        void* p = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (p == MAP_FAILED) {
+            ::close(fd);
+            size_ = 0;
+            return false;
+        }
+        madvise(p, size_, MADV_SEQUENTIAL);
+        data_ = static_cast<const char*>(p);
+    }
+    ::close(fd);
+    return true;
+}
+
+void MappedFile::close() {
+    if (data_) munmap(const_cast<char*>(data_), size_);
+    data_ = nullptr;
+    size_ = 0;
+}
+
+#endif
+
+size_t scanMasterIndex(const char* data, size_t size, const function<void(const IdxRecord&)>& onRecord) {
+    static const char kHeader[] = "CIK|Company Name|Form Type|Date Filed|Filename";
+    const char* p = data;
+    const char* end = data + size;
+
+    // Skip the preamble up to and including the column header line
+    string_view all(data, size);
+    size_t header = all.find(kHeader);
+    if (header == string_view::npos) return 0;
+    p = data + header;
+    const char* nl = static_cast<const char*>(memchr(p, '\n', end - p));
+    p = nl ? nl + 1 : end;
+
+    size_t lines = 0;
+    while (p < end) {
+        const char* eol = static_cast<const char*>(memchr(p, '\n', end - p));
+        const char* lineEnd = eol ? eol : end;
+        if (lineEnd > p && lineEnd[-1] == '\r') --lineEnd;
+        ++lines;
+
+        string_view fields[5];
+        size_t n = 0;
+        const char* f = p;
+        while (n < 5) {
+            const char* bar = static_cast<const char*>(memchr(f, '|', lineEnd - f));
+            if (!bar) {
+                fields[n++] = string_view(f, lineEnd - f);
+                break;
+            }
+            if (n == 4) {
+                n = 6;   // too many fields
+                break;
+            }
+            fields[n++] = string_view(f, bar - f);
+            f = bar + 1;
+        }
+
+        if (n == 5) {
+            onRecord(IdxRecord{fields[0], fields[1], fields[2], fields[3], fields[4]});
+        }
+        p = eol ? eol + 1 : end;
+    }
+    return lines;
+}
+
+string quarterFromDateView(string_view date) {
+    auto digit = [&](size_t i) { return date[i] >= '0' && date[i] <= '9'; };
+    if (date.size() < 7 || !digit(0) || !digit(1) || !digit(2) || !digit(3) || !digit(5) || !digit(6)) {
+        return "Unknown";
+    }
+    int month = (date[5] - '0') * 10 + (date[6] - '0');
+    if (month < 1 || month > 12) return "Unknown";
+    string quarter(date.substr(0, 4));
+    quarter += 'Q';
+    quarter += static_cast<char>('1' + (month - 1) / 3);
+    return quarter;
+}
+
+namespace {
+
+string& baseUrl() {
+    static string url = "https://www.sec.gov";
+    return url;
+}
+
+} // namespace
+
+void setEdgarBaseUrl(string url) {
+    while (!url.empty() && url.back() == '/') url.pop_back();
+    baseUrl() = std::move(url);
+}
+
+const string& edgarBaseUrl() {
+    return baseUrl();
+}
+
+int64_t parseCik(string_view text) {
+    // EDGAR CIKs have at most 10 digits
+    if (text.empty() || text.size() > 10) return 0;
+    int64_t cik = 0;
+    for (char c : text) {
+        if (c < '0' || c > '9') return 0;
+        cik = cik * 10 + (c - '0');
+    }
+    return cik;
+}
+
+string folderUrlFromFilename(string_view filename) {
+    static const char kData[] = "/Archives/edgar/data/";
+    static const string_view kDataDir = "data/";
+    static const string_view kTxt = ".txt";
+
+    size_t dataPos = filename.find(kDataDir);
+    if (dataPos == string_view::npos) return "";
+    string_view rest = filename.substr(dataPos + kDataDir.size());
+    size_t slash = rest.find('/');
+    if (slash == string_view::npos || slash == 0) return "";
+    string_view cik = rest.substr(0, slash);
+    string_view accession = rest.substr(slash + 1);
+    if (accession.size() <= kTxt.size() || accession.substr(accession.size() - kTxt.size()) != kTxt) return "";
+    accession.remove_suffix(kTxt.size());
+    if (accession.find('/') != string_view::npos) return "";
+
+    const string& base = baseUrl();
+    string url;
+    url.reserve(base.size() + sizeof(kData) + cik.size() + accession.size() + 2);
+    url += base;
+    url += kData;
+    url += cik;
+    url += '/';
+    for (char c : accession) {
+        if (c != '-') url += c;
+    }
+    url += '/';
+    return url;
+}
+
+string_view accessionFromFilename(string_view filename) {
+    static const string_view kTxt = ".txt";
+    size_t slash = filename.rfind('/');
+    string_view name = slash == string_view::npos ? filename : filename.substr(slash + 1);
+    if (name.size() <= kTxt.size() || name.substr(name.size() - kTxt.size()) != kTxt) return {};
+    name.remove_suffix(kTxt.size());
+    return name;
+}
+
+vector<FilingRef> scan13FHRFilings(const char* data, size_t size) {
+    vector<FilingRef> filings;
+    scanMasterIndex(data, size, [&](const IdxRecord& r) {
+        if (r.formType != "13F-HR" && r.formType != "13F-HR/A") return;
+        string folderUrl = folderUrlFromFilename(r.filename);
+        if (folderUrl.empty()) return;
+        filings.push_back(FilingRef{string(r.companyName), std::move(folderUrl), quarterFromDateView(r.dateFiled),
+                                    string(r.dateFiled), string(r.formType), parseCik(r.cik),
+                                    string(accessionFromFilename(r.filename))});
+    });
+    return filings;
+}
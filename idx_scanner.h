@@ -0,0 +1,83 @@
+// idx_scanner.h
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Read-only memory mapping of a whole file
+class MappedFile {
+public:
+    MappedFile() = default;
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool open(const std::string& path);
+    void close();
+
+    const char* data() const { return data_; }
+    size_t size() const { return size_; }
+
+private:
+    const char* data_ = nullptr;
+    size_t size_ = 0;
+#ifdef _WIN32
+    void* file_ = nullptr;
+    void* mapping_ = nullptr;
+#endif
+};
+
+// One data line of an EDGAR master.idx, split without copying
+struct IdxRecord {
+    std::string_view cik;
+    std::string_view companyName;
+    std::string_view formType;
+    std::string_view dateFiled;   // YYYY-MM-DD
+    std::string_view filename;    // edgar/data/<cik>/<accession>.txt
+};
+
+// Calls onRecord for every well-formed line after the column header and
+// returns the number of lines scanned. Fields are located with memchr.
+size_t scanMasterIndex(const char* data, size_t size, const std::function<void(const IdxRecord&)>& onRecord);
+
+// "2025-07-14" -> "2025Q3", "Unknown" if the date is malformed
+std::string quarterFromDateView(std::string_view date);
+
+// Origin every EDGAR URL is built on: https://www.sec.gov, or a local
+// stand-in such as mock_edgar_server. Set it before any worker starts.
+void setEdgarBaseUrl(std::string url);
+const std::string& edgarBaseUrl();
+
+// "0001100001" -> 1100001; 0 if empty, not all digits or out of range
+int64_t parseCik(std::string_view text);
+
+// EDGAR folder URL for a master.idx filename, empty if it does not parse.
+// edgar/data/1000045/0001903601-25-000056.txt
+//   -> https://www.sec.gov/Archives/edgar/data/1000045/000190360125000056/
+std::string folderUrlFromFilename(std::string_view filename);
+
+// "edgar/data/1000045/0001903601-25-000056.txt" -> "0001903601-25-000056",
+// empty if it does not parse
+std::string_view accessionFromFilename(std::string_view filename);
+
+// One 13F filing listed in a master.idx
+struct FilingRef {
+    std::string name;
+    std::string folderUrl;
+    std::string quarter;      // derived from the filing date
+    std::string filingDate;
+    std::string formType;     // 13F-HR or 13F-HR/A
+    int64_t cik = 0;          // 0 if the line had none
+    std::string accession;    // 0001903601-25-000056
+
+    bool isAmendment() const { return formType == "13F-HR/A"; }
+};
+
+// Every 13F-HR and 13F-HR/A line
+std::vector<FilingRef> scan13FHRFilings(const char* data, size_t size);
@@ -0,0 +1,95 @@
+// Imports the checked-in bulk archives with `FinanceApp import` into a
+// scratch holdings.db and checks what was stored:
+//
+//  - fixtures/13f_dataset_sample.zip, a Form 13F data set with an amendment
+//    (0001100004-25-000020) that replaces its original's rows;
+//  - fixtures/edgar_feed_sample.tar.gz, feed .nc submissions plus a mirrored
+//    folder of the original the data set already amended, which is skipped.
+//
+// Importing again must not change anything.
+// Usage: import_test <FinanceApp> <fixtures dir>
+
+#include "test_util.h"
+#include <filesystem>
+#include <iostream>
+#include <sqlite3.h>
+
+using namespace std;
+namespace fs = std::filesystem;
+
+namespace {
+
+void expectTotals(sqlite3* db, long long filings, long long rows, long long shares, long long value,
+                  const string& when) {
+    expectEqual(queryInt(db, "SELECT COUNT(*) FROM filings"), filings, "filings " + when);
+    expectEqual(queryInt(db, "SELECT COUNT(*) FROM holdings"), rows, "holdings rows " + when);
+    expectEqual(queryInt(db, "SELECT SUM(shares) FROM holdings"), shares, "sum(shares) " + when);
+    expectEqual(queryInt(db, "SELECT SUM(value) FROM holdings"), value, "sum(value) " + when);
+}
+
+void expectFiling(sqlite3* db, const string& accession, long long rows, long long value) {
+    string filing = "(SELECT id FROM filings WHERE accession = '" + accession + "')";
+    expectEqual(queryInt(db, "SELECT COUNT(*) FROM holdings WHERE filing_id = " + filing), rows,
+                accession + " rows");
+    expectEqual(queryInt(db, "SELECT SUM(value) FROM holdings WHERE filing_id = " + filing), value,
+                accession + " sum(value)");
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    if (argc < 3) {
+        cerr << "Usage: import_test <FinanceApp> <fixtures dir>" << endl;
+        return 2;
+    }
+    string app = fs::absolute(argv[1]).string();
+    fs::path fixtures = fs::absolute(argv[2]);
+    string dataSet = quoted((fixtures / "13f_dataset_sample.zip").string());
+    string feed = quoted((fixtures / "edgar_feed_sample.tar.gz").string());
+
+    ScratchDir dir("import_test");
+    if (!runIn(dir.path, app, "import " + dataSet)) {
+        cerr << "FAILED: import of the data set" << endl;
+        return 1;
+    }
+
+    sqlite3* db;
+    if (sqlite3_open_v2((dir.path / "holdings.db").string().c_str(), &db, SQLITE_OPEN_READONLY, nullptr) !=
+        SQLITE_OK) {
+        cerr << "Can't open database: " << sqlite3_errmsg(db) << endl;
+        sqlite3_close(db);
+        return 1;
+    }
+
+    expectTotals(db, 2, 5, 46400, 12920000, "after the data set");
+    expectFiling(db, "0001100004-25-000012", 2, 2920000);
+    expectFiling(db, "0001100006-25-000044", 3, 10000000);
+    expectEqual(queryInt(db, "SELECT COUNT(*) FROM ingest_ledger WHERE state = 'committed'"), 3,
+                "committed accessions after the data set");
+
+    if (!runIn(dir.path, app, "import " + feed)) {
+        cerr << "FAILED: import of the feed archive" << endl;
+        sqlite3_close(db);
+        return 1;
+    }
+    expectTotals(db, 4, 11, 112500, 28120000, "after the feed archive");
+    expectFiling(db, "0001100001-25-000101", 4, 13200000);
+    expectFiling(db, "0001100003-25-000033", 2, 2000000);
+    expectFiling(db, "0001100004-25-000012", 2, 2920000);
+
+    // Everything is in the ledger now, so a rerun is a no-op
+    if (!runIn(dir.path, app, "import " + dataSet) || !runIn(dir.path, app, "import " + feed)) {
+        cerr << "FAILED: repeated import" << endl;
+        sqlite3_close(db);
+        return 1;
+    }
+    expectTotals(db, 4, 11, 112500, 28120000, "after importing again");
+
+    sqlite3_close(db);
+    if (testFailures) {
+        cerr << testFailures << " check(s) failed" << endl;
+        return 1;
+    }
+    cout << "import_test passed" << endl;
+    return 0;
+}
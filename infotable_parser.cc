@@ -0,0 +1,330 @@
+#include "infotable_parser.h"
+#include "metrics.h"
+#include <cstring>
+#include <iostream>
+
+using namespace std;
+
+namespace {
+
+// Guards against unterminated tags in corrupt input
+const size_t kMaxTagLength = 64 * 1024;
+
+bool isSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+// Decodes the predefined XML entities and numeric character references in place
+void decodeEntities(string& s) {
+    size_t amp = s.find('&');
+    if (amp == string::npos) return;
+
+    size_t out = amp;
+    for (size_t in = amp; in < s.size();) {
+        if (s[in] != '&') {
+            s[out++] = s[in++];
+            continue;
+        }
+        size_t semi = s.find(';', in);
+        if (semi == string::npos || semi - in > 10) {
+            s[out++] = s[in++];
+            continue;
+        }
+        string_view ent(s.data() + in + 1, semi - in - 1);
+        unsigned long cp = 0;
+        bool known = true;
+        if (ent == "amp") cp = '&';
+        else if (ent == "lt") cp = '<';
+        else if (ent == "gt") cp = '>';
+        else if (ent == "quot") cp = '"';
+        else if (ent == "apos") cp = '\'';
+        else if (ent.size() > 1 && ent[0] == '#') {
+            bool hex = ent[1] == 'x' || ent[1] == 'X';
+            for (size_t i = hex ? 2 : 1; i < ent.size() && known; ++i) {
+                char c = ent[i];
+                int d = (c >= '0' && c <= '9') ? c - '0'
+                      : (hex && c >= 'a' && c <= 'f') ? c - 'a' + 10
+                      : (hex && c >= 'A' && c <= 'F') ? c - 'A' + 10 : -1;
+                if (d < 0) known = false;
+                else cp = cp * (hex ? 16 : 10) + d;
+            }
+            if (cp > 0x10FFFF) known = false;
+        } else {
+            known = false;
+        }
+        if (!known) {
+            s[out++] = s[in++];
+            continue;
+        }
+        // Encoded output is never longer than the reference it replaces
+        if (cp < 0x80) {
+            s[out++] = static_cast<char>(cp);
+        } else if (cp < 0x800) {
+            s[out++] = static_cast<char>(0xC0 | (cp >> 6));
+            s[out++] = static_cast<char>(0x80 | (cp & 0x3F));
+        } else if (cp < 0x10000) {
+            s[out++] = static_cast<char>(0xE0 | (cp >> 12));
+            s[out++] = static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+            s[out++] = static_cast<char>(0x80 | (cp & 0x3F));
+        } else {
+            s[out++] = static_cast<char>(0xF0 | (cp >> 18));
+            s[out++] = static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+            s[out++] = static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+            s[out++] = static_cast<char>(0x80 | (cp & 0x3F));
+        }
+        in = semi + 1;
+    }
+    s.resize(out);
+}
+
+void trimInPlace(string& s) {
+    size_t end = s.size();
+    while (end > 0 && isSpace(s[end - 1])) --end;
+    size_t start = 0;
+    while (start < end && isSpace(s[start])) ++start;
+    if (start > 0 || end < s.size()) {
+        s.erase(end);
+        s.erase(0, start);
+    }
+}
+
+// Like atoll: optional sign, digits, stops at the first other character
+long long parseInteger(const string& s) {
+    size_t i = 0;
+    bool negative = false;
+    if (i < s.size() && (s[i] == '-' || s[i] == '+')) negative = s[i++] == '-';
+    long long v = 0;
+    for (; i < s.size() && s[i] >= '0' && s[i] <= '9'; ++i) {
+        v = v * 10 + (s[i] - '0');
+    }
+    return negative ? -v : v;
+}
+
+} // namespace
+
+InfoTableParser::InfoTableParser(Sink sink) : sink_(std::move(sink)) {
+    tag_.reserve(256);
+    text_.reserve(256);
+}
+
+void InfoTableParser::reset() {
+    state_ = State::Text;
+    ok_ = true;
+    tag_.clear();
+    quote_ = 0;
+    closeRun_ = 0;
+    inRow_ = false;
+    field_ = Field::None;
+    text_.clear();
+    sawInfoTable_ = false;
+    rows_ = 0;
+    skipped_ = 0;
+}
+
+bool InfoTableParser::feed(const char* data, size_t len) {
+    countMetric(Counter::XmlBytesParsed, len);
+    const char* p = data;
+    const char* end = data + len;
+
+    while (ok_ && p < end) {
+        switch (state_) {
+        case State::Text: {
+            const char* lt = static_cast<const char*>(memchr(p, '<', end - p));
+            const char* stop = lt ? lt : end;
+            if (field_ != Field::None) text_.append(p, stop - p);
+            if (!lt) return ok_;
+            p = lt + 1;
+            tag_.clear();
+            quote_ = 0;
+            state_ = State::Tag;
+            break;
+        }
+        case State::Tag: {
+            // Fast path: ordinary tag without quoted attributes
+            if (!quote_ && (tag_.empty() ? *p != '!' : tag_[0] != '!')) {
+                const char* gt = static_cast<const char*>(memchr(p, '>', end - p));
+                const char* stop = gt ? gt : end;
+                if (!memchr(p, '"', stop - p) && !memchr(p, '\'', stop - p)) {
+                    tag_.append(p, stop - p);
+                    p = stop;
+                    if (gt) {
+                        ++p;
+                        handleTag();
+                        state_ = State::Text;
+                    } else if (tag_.size() > kMaxTagLength) {
+                        ok_ = false;
+                    }
+                    break;
+                }
+            }
+            for (; p < end; ++p) {
+                char c = *p;
+                if (quote_) {
+                    if (c == quote_) quote_ = 0;
+                } else if (c == '"' || c == '\'') {
+                    if (tag_.empty() || (tag_[0] != '!' && tag_[0] != '?')) quote_ = c;
+                } else if (c == '>') {
+                    ++p;
+                    handleTag();
+                    state_ = State::Text;
+                    break;
+                }
+                tag_.push_back(c);
+                if (tag_[0] == '!') {
+                    if (tag_ == "!--") {
+                        state_ = State::Comment;
+                        closeRun_ = 0;
+                        ++p;
+                        break;
+                    }
+                    if (tag_ == "![CDATA[") {
+                        state_ = State::CData;
+                        closeRun_ = 0;
+                        ++p;
+                        break;
+                    }
+                }
+                if (tag_.size() > kMaxTagLength) {
+                    ok_ = false;
+                    break;
+                }
+            }
+            break;
+        }
+        case State::Comment: {
+            for (; p < end; ++p) {
+                if (*p == '-') {
+                    ++closeRun_;
+                } else if (*p == '>' && closeRun_ >= 2) {
+                    ++p;
+                    state_ = State::Text;
+                    break;
+                } else {
+                    closeRun_ = 0;
+                }
+            }
+            break;
+        }
+        case State::CData: {
+            for (; p < end; ++p) {
+                char c = *p;
+                if (c == '>' && closeRun_ >= 2) {
+                    // Drop the "]]" that was captured before we knew it closed the section
+                    if (field_ != Field::None) text_.resize(text_.size() - 2);
+                    ++p;
+                    state_ = State::Text;
+                    break;
+                }
+                closeRun_ = (c == ']') ? closeRun_ + 1 : 0;
+                if (field_ != Field::None) text_.push_back(c);
+            }
+            break;
+        }
+        }
+    }
+    return ok_;
+}
+
+bool InfoTableParser::finish() {
+    if (state_ != State::Text) ok_ = false;
+    return ok_;
+}
+
+void InfoTableParser::handleTag() {
+    if (tag_.empty()) return;
+    char first = tag_[0];
+    if (first == '?' || first == '!') return;   // processing instruction or declaration
+
+    string_view tag(tag_);
+    bool closing = first == '/';
+    if (closing) tag.remove_prefix(1);
+
+    bool selfClosing = !closing && !tag.empty() && tag.back() == '/';
+    size_t nameEnd = 0;
+    while (nameEnd < tag.size() && !isSpace(tag[nameEnd]) && tag[nameEnd] != '/') ++nameEnd;
+    string_view local = localName(tag.substr(0, nameEnd));
+
+    if (closing) {
+        endElement(local);
+    } else {
+        startElement(local);
+        if (selfClosing) endElement(local);
+    }
+}
+
+void InfoTableParser::startElement(string_view local) {
+    if (local == "infoTable") {
+        inRow_ = true;
+        sawInfoTable_ = true;
+        hasName_ = hasCusip_ = hasShares_ = false;
+        row_.cusip.clear();
+        row_.nameOfIssuer.clear();
+        row_.titleOfClass.clear();
+        row_.putCall.clear();
+        row_.sharesType.clear();
+        row_.investmentDiscretion.clear();
+        row_.otherManager.clear();
+        row_.shares = 0;
+        row_.value = 0;
+        row_.votingSole = row_.votingShared = row_.votingNone = 0;
+        return;
+    }
+    if (!inRow_) return;
+
+    if (local == "nameOfIssuer") field_ = Field::NameOfIssuer;
+    else if (local == "titleOfClass") field_ = Field::TitleOfClass;
+    else if (local == "cusip") field_ = Field::Cusip;
+    else if (local == "value") field_ = Field::Value;
+    else if (local == "sshPrnamt") field_ = Field::SshPrnamt;
+    else if (local == "putCall") field_ = Field::PutCall;
+    else if (local == "sshPrnamtType") field_ = Field::SshPrnamtType;
+    else if (local == "investmentDiscretion") field_ = Field::InvestmentDiscretion;
+    else if (local == "otherManager") field_ = Field::OtherManager;
+    else if (local == "Sole") field_ = Field::VotingSole;
+    else if (local == "Shared") field_ = Field::VotingShared;
+    else if (local == "None") field_ = Field::VotingNone;
+    else field_ = Field::None;
+    text_.clear();
+}
+
+void InfoTableParser::endElement(string_view local) {
+    if (field_ != Field::None) {
+        decodeEntities(text_);
+        trimInPlace(text_);
+        switch (field_) {
+        case Field::NameOfIssuer: row_.nameOfIssuer.assign(text_); hasName_ = true; break;
+        case Field::TitleOfClass: row_.titleOfClass.assign(text_); break;
+        case Field::Cusip:        row_.cusip.assign(text_); hasCusip_ = true; break;
+        case Field::Value:        row_.value = parseInteger(text_); break;
+        case Field::SshPrnamt:    row_.shares = parseInteger(text_); hasShares_ = true; break;
+        case Field::PutCall:      row_.putCall.assign(text_); break;
+        case Field::SshPrnamtType: row_.sharesType.assign(text_); break;
+        case Field::InvestmentDiscretion: row_.investmentDiscretion.assign(text_); break;
+        case Field::OtherManager: row_.otherManager.assign(text_); break;
+        case Field::VotingSole:   row_.votingSole = parseInteger(text_); break;
+        case Field::VotingShared: row_.votingShared = parseInteger(text_); break;
+        case Field::VotingNone:   row_.votingNone = parseInteger(text_); break;
+        case Field::None:         break;
+        }
+        field_ = Field::None;
+    }
+    if (local == "infoTable" && inRow_) {
+        inRow_ = false;
+        finishRow();
+    }
+}
+
+void InfoTableParser::finishRow() {
+    if (!hasName_ || !hasCusip_ || !hasShares_) {
+        ++skipped_;
+        std::cerr << "Skipping entry — missing fields: "
+                  << (hasName_ ? "" : "name ")
+                  << (hasCusip_ ? "" : "cusip ")
+                  << (hasShares_ ? "" : "shares ")
+                  << std::endl;
+        return;
+    }
+    ++rows_;
+    countMetric(Counter::RowsParsed);
+    sink_(row_);
+}
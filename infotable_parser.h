@@ -0,0 +1,71 @@
+// infotable_parser.h
+
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <string_view>
+#include "sec_parser.h"
+
+// Streaming parser for 13F information table XML.
+//
+// Bytes can be fed in chunks of any size, e.g. straight from a curl write
+// callback; each <infoTable> row is handed to the sink as soon as its closing
+// tag is seen. Only the current row and the current tag are buffered, so
+// memory use does not grow with the size of the document. Element names are
+// compared as string_views with any namespace prefix skipped, and the row
+// buffers are reused, so steady-state parsing does not allocate.
+class InfoTableParser {
+public:
+    using Sink = std::function<void(const Holding&)>;
+
+    explicit InfoTableParser(Sink sink);
+
+    // Returns false once the input is found to be malformed
+    bool feed(const char* data, size_t len);
+    // Call after the last chunk; false if the document ended mid-tag
+    bool finish();
+    void reset();
+
+    bool sawInfoTable() const { return sawInfoTable_; }
+    size_t rows() const { return rows_; }
+    size_t skipped() const { return skipped_; }
+
+private:
+    enum class State { Text, Tag, Comment, CData };
+    enum class Field {
+        None, NameOfIssuer, TitleOfClass, Cusip, Value, SshPrnamt, PutCall,
+        SshPrnamtType, InvestmentDiscretion, OtherManager, VotingSole, VotingShared, VotingNone
+    };
+
+    void handleTag();
+    void startElement(std::string_view local);
+    void endElement(std::string_view local);
+    void finishRow();
+
+    Sink sink_;
+    State state_ = State::Text;
+    bool ok_ = true;
+
+    std::string tag_;      // bytes between '<' and '>'
+    char quote_ = 0;       // open attribute quote inside tag_
+    int closeRun_ = 0;     // trailing '-' or ']' seen while looking for --> or ]]>
+
+    bool inRow_ = false;
+    Field field_ = Field::None;
+    std::string text_;     // raw text of the field being captured
+
+    Holding row_;
+    bool hasName_ = false, hasCusip_ = false, hasShares_ = false;
+
+    bool sawInfoTable_ = false;
+    size_t rows_ = 0;
+    size_t skipped_ = 0;
+};
+
+// Element name without its namespace prefix ("ns1:infoTable" -> "infoTable")
+inline std::string_view localName(std::string_view qname) {
+    size_t pos = qname.find(':');
+    return pos == std::string_view::npos ? qname : qname.substr(pos + 1);
+}
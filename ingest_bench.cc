@@ -0,0 +1,248 @@
+// Ingestion throughput on the checked-in fixture corpus, without network
+// access: master.idx scanning, folder listing and filing index link
+// extraction, infoTable parsing, full-submission splitting and the DB insert
+// path. Reports rows/s, MB/s and heap allocations per pass; allocations are
+// counted by replacing the global operator new.
+// fixtures/bench holds folder listings, a filing index page and information
+// tables in EDGAR's markup; a 20000-row table is generated on top of them.
+// Usage: ingest_bench [corpus=fixtures/bench] [idx dir=master_idx] [iterations=20]
+
+#include "sec_parser.h"
+#include "filing_index.h"
+#include "holdings_writer.h"
+#include "infotable_parser.h"
+#include "schema.h"
+#include "storage.h"
+#include "submission_parser.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <new>
+#include <sstream>
+#include <sqlite3.h>
+
+using namespace std;
+namespace fs = std::filesystem;
+
+namespace {
+
+atomic<size_t> allocations{0};
+atomic<size_t> allocatedBytes{0};
+
+} // namespace
+
+void* operator new(size_t size) {
+    allocations.fetch_add(1, memory_order_relaxed);
+    allocatedBytes.fetch_add(size, memory_order_relaxed);
+    if (void* p = malloc(size ? size : 1)) return p;
+    throw bad_alloc();
+}
+
+void operator delete(void* p) noexcept {
+    free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+    free(p);
+}
+
+namespace {
+
+int iterations = 20;
+
+string readFile(const fs::path& path) {
+    ifstream in(path, ios::binary);
+    ostringstream ss;
+    ss << in.rdbuf();
+    return ss.str();
+}
+
+// Runs fn (which returns the rows it produced) once to warm up, then
+// `iterations` times, and prints per-pass figures
+template <typename Fn>
+void bench(const string& name, size_t bytes, Fn fn) {
+    size_t rows = fn();
+    size_t allocs0 = allocations.load();
+    size_t allocBytes0 = allocatedBytes.load();
+    auto start = chrono::steady_clock::now();
+    for (int i = 0; i < iterations; ++i) rows = fn();
+    chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+    double perPass = elapsed.count() / iterations;
+    double allocs = static_cast<double>(allocations.load() - allocs0) / iterations;
+    double allocBytes = static_cast<double>(allocatedBytes.load() - allocBytes0) / iterations;
+
+    char line[256];
+    snprintf(line, sizeof(line), "%-56s %9zu B %7zu rows %11.0f rows/s %8.1f MB/s %10.0f allocs %8.2f allocs/row %9.0f KB alloc",
+             name.c_str(), bytes, rows, rows / perPass, bytes / perPass / (1024 * 1024), allocs,
+             rows ? allocs / rows : 0.0, allocBytes / 1024);
+    cout << line << endl;
+}
+
+// Information table of `rows` distinct positions, shaped like EDGAR's
+string synthesizeInfoTable(size_t rows) {
+    string xml = "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+                 "<ns1:informationTable xmlns:ns1=\"http://www.sec.gov/edgar/document/thirteenf/informationtable\">\n";
+    char row[1024];
+    for (size_t i = 0; i < rows; ++i) {
+        long long shares = 100 + static_cast<long long>(i * 7919 % 5000000);
+        snprintf(row, sizeof(row),
+                 "  <ns1:infoTable>\n"
+                 "    <ns1:nameOfIssuer>ISSUER %zu HOLDINGS INC</ns1:nameOfIssuer>\n"
+                 "    <ns1:titleOfClass>COM</ns1:titleOfClass>\n"
+                 "    <ns1:cusip>%06zuAB%zu</ns1:cusip>\n"
+                 "    <ns1:value>%lld</ns1:value>\n"
+                 "    <ns1:shrsOrPrnAmt>\n"
+                 "      <ns1:sshPrnamt>%lld</ns1:sshPrnamt>\n"
+                 "      <ns1:sshPrnamtType>SH</ns1:sshPrnamtType>\n"
+                 "    </ns1:shrsOrPrnAmt>\n"
+                 "    <ns1:investmentDiscretion>SOLE</ns1:investmentDiscretion>\n"
+                 "    <ns1:votingAuthority>\n"
+                 "      <ns1:Sole>%lld</ns1:Sole>\n"
+                 "      <ns1:Shared>0</ns1:Shared>\n"
+                 "      <ns1:None>0</ns1:None>\n"
+                 "    </ns1:votingAuthority>\n"
+                 "  </ns1:infoTable>\n",
+                 i % 5000, i, i % 10, shares * 37, shares, shares);
+        xml += row;
+    }
+    xml += "</ns1:informationTable>\n";
+    return xml;
+}
+
+// Full submission text around one information table
+string wrapSubmission(const string& infoTable) {
+    return "<SEC-DOCUMENT>0001100001-25-000101.txt : 20250814\n"
+           "<SEC-HEADER>0001100001-25-000101.hdr.sgml : 20250814\n"
+           "ACCESSION NUMBER:\t\t0001100001-25-000101\n"
+           "CONFORMED SUBMISSION TYPE:\t13F-HR\n"
+           "PUBLIC DOCUMENT COUNT:\t\t2\n"
+           "CONFORMED PERIOD OF REPORT:\t20250630\n"
+           "FILED AS OF DATE:\t\t20250814\n\n"
+           "FILER:\n\n\tCOMPANY DATA:\t\n"
+           "\t\tCOMPANY CONFORMED NAME:\t\t\tBENCH CAPITAL LLC\n"
+           "\t\tCENTRAL INDEX KEY:\t\t\t0001100001\n"
+           "</SEC-HEADER>\n"
+           "<DOCUMENT>\n<TYPE>13F-HR\n<SEQUENCE>1\n<FILENAME>primary_doc.xml\n<TEXT>\n<XML>\n"
+           "<edgarSubmission><formData><coverPage><isAmendment>false</isAmendment></coverPage></formData></edgarSubmission>\n"
+           "</XML>\n</TEXT>\n</DOCUMENT>\n"
+           "<DOCUMENT>\n<TYPE>INFORMATION TABLE\n<SEQUENCE>2\n<FILENAME>infotable.xml\n<TEXT>\n<XML>\n" +
+           infoTable +
+           "</XML>\n</TEXT>\n</DOCUMENT>\n</SEC-DOCUMENT>\n";
+}
+
+void benchInfoTable(const string& name, const string& xml) {
+    bench("parse13FHoldings " + name, xml.size(), [&] { return parse13FHoldings(xml).size(); });
+
+    // The streaming path as it runs under a download, rows discarded
+    bench("InfoTableParser 16 KB chunks " + name, xml.size(), [&] {
+        InfoTableParser parser([](const Holding&) {});
+        for (size_t pos = 0; pos < xml.size(); pos += 16384) {
+            parser.feed(xml.data() + pos, min<size_t>(16384, xml.size() - pos));
+        }
+        parser.finish();
+        return parser.rows();
+    });
+
+    string submission = wrapSubmission(xml);
+    bench("parseSubmission " + name, submission.size(), [&] {
+        SubmissionHeader header;
+        vector<Holding> holdings;
+        parseSubmission(submission.data(), submission.size(), name, header, holdings);
+        return holdings.size();
+    });
+}
+
+// Every pass stores the table once more under a new firm, so no row is
+// ignored as a duplicate
+void benchInsert(const string& name, const string& xml, sqlite3* db) {
+    static int firm = 0;
+    vector<Holding> holdings = parse13FHoldings(xml);
+    {
+        HoldingsWriter writer(db);
+        bench("HoldingsWriter::write " + name, xml.size(), [&] {
+            FilingRecord record;
+            record.firmName = "BENCH FIRM " + to_string(firm++);
+            record.quarter = "2025Q3";
+            record.filingDate = "2025-08-14";
+            record.holdings = holdings;
+            writer.write(record);
+            writer.flush();
+            return holdings.size();
+        });
+    }
+    bench("parse13F (parse + own transaction) " + name, xml.size(), [&] {
+        parse13F(xml, "BENCH FIRM " + to_string(firm++), "2025Q3", "2025-08-14", db);
+        return holdings.size();
+    });
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    fs::path corpus = argc > 1 ? argv[1] : "fixtures/bench";
+    fs::path idxDir = argc > 2 ? argv[2] : "master_idx";
+    iterations = argc > 3 ? atoi(argv[3]) : 20;
+    if (iterations < 1) iterations = 1;
+
+    error_code ec;
+    if (!fs::is_directory(corpus, ec)) {
+        cerr << "Not a directory: " << corpus << endl;
+        return 1;
+    }
+
+    if (fs::is_directory(idxDir, ec)) {
+        for (const auto& entry : fs::directory_iterator(idxDir)) {
+            if (entry.path().extension() != ".idx") continue;
+            string path = entry.path().string();
+            bench("extract13FHRUrls " + entry.path().filename().string(), fs::file_size(entry.path()),
+                  [&] { return extract13FHRUrls(path).size(); });
+        }
+    }
+
+    vector<fs::path> files;
+    for (const auto& entry : fs::directory_iterator(corpus)) files.push_back(entry.path());
+    sort(files.begin(), files.end());
+
+    const string base = "https://www.sec.gov/Archives/edgar/data/1100001/000110000125000101/";
+    vector<pair<string, string>> infoTables;
+    for (const auto& path : files) {
+        string name = path.filename().string();
+        string content = readFile(path);
+        if (name.rfind("folder_", 0) == 0) {
+            bench("extractXmlLinks " + name, content.size(), [&] { return extractXmlLinks(content, base).size(); });
+        } else if (name.rfind("filing_index", 0) == 0) {
+            bench("parseFilingIndex " + name, content.size(), [&] {
+                auto documents = parseFilingIndex(content, base);
+                return infoTableUrl(documents).empty() ? 0 : documents.size();
+            });
+        } else if (name.rfind("infotable_", 0) == 0) {
+            infoTables.emplace_back(name, std::move(content));
+        }
+    }
+    infoTables.emplace_back("infotable_large (generated)", synthesizeInfoTable(20000));
+
+    for (const auto& [name, xml] : infoTables) benchInfoTable(name, xml);
+
+    // A scratch database with the production storage profile
+    string dbPath = (fs::temp_directory_path() / "ingest_bench.db").string();
+    auto removeDb = [&] {
+        for (const char* suffix : {"", "-wal", "-shm"}) fs::remove(dbPath + suffix, ec);
+    };
+    removeDb();
+    sqlite3* db;
+    if (sqlite3_open(dbPath.c_str(), &db) != SQLITE_OK || !applyStorageProfile(db, StorageProfile()) ||
+        !migrateSchema(db)) {
+        cerr << "Can't open database: " << sqlite3_errmsg(db) << endl;
+        sqlite3_close(db);
+        return 1;
+    }
+    for (const auto& [name, xml] : infoTables) benchInsert(name, xml, db);
+    sqlite3_close(db);
+    removeDb();
+    return 0;
+}
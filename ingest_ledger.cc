@@ -0,0 +1,134 @@
+#include "ingest_ledger.h"
+#include <ctime>
+#include <iostream>
+
+using namespace std;
+
+namespace {
+
+const int64_t kMaxBackoffSeconds = 24 * 60 * 60;
+
+} // namespace
+
+const char* ingestStateName(IngestState state) {
+    switch (state) {
+    case IngestState::Queued:    return "queued";
+    case IngestState::Fetched:   return "fetched";
+    case IngestState::Parsed:    return "parsed";
+    case IngestState::Committed: return "committed";
+    case IngestState::Failed:    return "failed";
+    }
+    return "";
+}
+
+IngestLedger::IngestLedger(sqlite3* db, int maxAttempts, int64_t backoffSeconds)
+    : db_(db), maxAttempts_(maxAttempts), backoffSeconds_(backoffSeconds) {}
+
+IngestLedger::~IngestLedger() {
+    sqlite3_finalize(select_);
+    sqlite3_finalize(enqueue_);
+    sqlite3_finalize(setState_);
+    sqlite3_finalize(setFailed_);
+}
+
+bool IngestLedger::prepare() {
+    if (select_) return true;
+
+    struct { sqlite3_stmt** stmt; const char* sql; } statements[] = {
+        {&select_,
+         "SELECT state, attempts, next_attempt_at FROM ingest_ledger WHERE accession = ?;"},
+        {&enqueue_,
+         "INSERT INTO ingest_ledger (accession, cik, form_type, firm_name, quarter, state) "
+         "VALUES (?, ?, ?, ?, ?, 'queued') "
+         "ON CONFLICT(accession) DO UPDATE SET state = 'queued', updated_at = CURRENT_TIMESTAMP;"},
+        // Upsert: archive imports never plan() their accessions
+        {&setState_,
+         "INSERT INTO ingest_ledger (accession, state) VALUES (?2, ?1) "
+         "ON CONFLICT(accession) DO UPDATE SET state = excluded.state, error = NULL, "
+         "updated_at = CURRENT_TIMESTAMP;"},
+        // Backoff doubles per attempt: base * 2^(attempts - 1), capped
+        {&setFailed_,
+         "UPDATE ingest_ledger SET state = 'failed', error = ?, attempts = attempts + 1, "
+         "next_attempt_at = ? + MIN(? << MIN(attempts, 20), ?), updated_at = CURRENT_TIMESTAMP "
+         "WHERE accession = ?;"},
+    };
+    for (auto& s : statements) {
+        if (sqlite3_prepare_v3(db_, s.sql, -1, SQLITE_PREPARE_PERSISTENT, s.stmt, nullptr) != SQLITE_OK) {
+            cerr << "SQL error: " << sqlite3_errmsg(db_) << endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+ResumePlan IngestLedger::plan(const vector<FilingRef>& filings, bool ignoreBackoff) {
+    ResumePlan plan;
+    if (!prepare()) {
+        plan.todo = filings;
+        return plan;
+    }
+    int64_t now = static_cast<int64_t>(time(nullptr));
+
+    sqlite3_exec(db_, "BEGIN TRANSACTION;", nullptr, nullptr, nullptr);
+    for (const FilingRef& f : filings) {
+        sqlite3_bind_text(select_, 1, f.accession.c_str(), -1, SQLITE_STATIC);
+        bool known = sqlite3_step(select_) == SQLITE_ROW;
+        string state = known ? reinterpret_cast<const char*>(sqlite3_column_text(select_, 0)) : "";
+        int attempts = known ? sqlite3_column_int(select_, 1) : 0;
+        int64_t nextAttempt = known ? sqlite3_column_int64(select_, 2) : 0;
+        sqlite3_reset(select_);
+
+        if (state == "committed") {
+            ++plan.committed;
+            continue;
+        }
+        if (state == "failed" && !ignoreBackoff) {
+            if (attempts >= maxAttempts_) {
+                ++plan.givenUp;
+                continue;
+            }
+            if (nextAttempt > now) {
+                ++plan.backingOff;
+                continue;
+            }
+        }
+
+        sqlite3_bind_text(enqueue_, 1, f.accession.c_str(), -1, SQLITE_STATIC);
+        if (f.cik) sqlite3_bind_int64(enqueue_, 2, f.cik);
+        else sqlite3_bind_null(enqueue_, 2);
+        sqlite3_bind_text(enqueue_, 3, f.formType.c_str(), -1, SQLITE_STATIC);
+        sqlite3_bind_text(enqueue_, 4, f.name.c_str(), -1, SQLITE_STATIC);
+        sqlite3_bind_text(enqueue_, 5, f.quarter.c_str(), -1, SQLITE_STATIC);
+        if (sqlite3_step(enqueue_) != SQLITE_DONE) {
+            cerr << "SQL error: " << sqlite3_errmsg(db_) << endl;
+        }
+        sqlite3_reset(enqueue_);
+        plan.todo.push_back(f);
+    }
+    if (sqlite3_exec(db_, "END TRANSACTION;", nullptr, nullptr, nullptr) != SQLITE_OK) {
+        cerr << "SQL error: " << sqlite3_errmsg(db_) << endl;
+    }
+    return plan;
+}
+
+bool IngestLedger::update(const LedgerUpdate& u) {
+    if (u.accession.empty() || !prepare()) return false;
+
+    sqlite3_stmt* stmt;
+    if (u.state == IngestState::Failed) {
+        stmt = setFailed_;
+        sqlite3_bind_text(stmt, 1, u.error.c_str(), -1, SQLITE_STATIC);
+        sqlite3_bind_int64(stmt, 2, static_cast<int64_t>(time(nullptr)));
+        sqlite3_bind_int64(stmt, 3, backoffSeconds_);
+        sqlite3_bind_int64(stmt, 4, kMaxBackoffSeconds);
+        sqlite3_bind_text(stmt, 5, u.accession.c_str(), -1, SQLITE_STATIC);
+    } else {
+        stmt = setState_;
+        sqlite3_bind_text(stmt, 1, ingestStateName(u.state), -1, SQLITE_STATIC);
+        sqlite3_bind_text(stmt, 2, u.accession.c_str(), -1, SQLITE_STATIC);
+    }
+    bool ok = sqlite3_step(stmt) == SQLITE_DONE;
+    if (!ok) cerr << "SQL error: " << sqlite3_errmsg(db_) << endl;
+    sqlite3_reset(stmt);
+    return ok;
+}
@@ -0,0 +1,62 @@
+// ingest_ledger.h
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <sqlite3.h>
+#include "idx_scanner.h"
+
+enum class IngestState { Queued, Fetched, Parsed, Committed, Failed };
+
+const char* ingestStateName(IngestState state);
+
+// One state transition for an accession
+struct LedgerUpdate {
+    std::string accession;
+    IngestState state;
+    std::string error;   // Failed only
+};
+
+// What plan() decided for a run
+struct ResumePlan {
+    std::vector<FilingRef> todo;
+    size_t committed = 0;   // already stored by an earlier run
+    size_t backingOff = 0;  // failed, next attempt not due yet
+    size_t givenUp = 0;     // failed maxAttempts times
+};
+
+// Per-accession ingestion state in the ingest_ledger table.
+//
+// A run first plan()s its filing list: committed accessions are skipped with
+// one primary-key lookup each, failures wait out an exponential backoff, and
+// everything else is marked queued. Transitions are recorded with update()
+// on the connection's writing thread; HoldingsWriter marks an accession
+// committed in the same transaction as its holdings, so a killed run never
+// leaves a filing half-recorded. Accessions that were never planned, such as
+// an archive import's, are added by their first update() other than a failure.
+class IngestLedger {
+public:
+    explicit IngestLedger(sqlite3* db, int maxAttempts = 5, int64_t backoffSeconds = 300);
+    ~IngestLedger();
+
+    IngestLedger(const IngestLedger&) = delete;
+    IngestLedger& operator=(const IngestLedger&) = delete;
+
+    // ignoreBackoff retries failed accessions now, however often they failed
+    ResumePlan plan(const std::vector<FilingRef>& filings, bool ignoreBackoff = false);
+    bool update(const LedgerUpdate& u);
+
+private:
+    bool prepare();
+
+    sqlite3* db_;
+    int maxAttempts_;
+    int64_t backoffSeconds_;
+    sqlite3_stmt* select_ = nullptr;
+    sqlite3_stmt* enqueue_ = nullptr;
+    sqlite3_stmt* setState_ = nullptr;
+    sqlite3_stmt* setFailed_ = nullptr;
+};
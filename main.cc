@@ -1,69 +1,277 @@
 #include "sec_parser.h"
+#include "pipeline.h"
+#include "http_client.h"
+#include "http_cache.h"
+#include "storage.h"
+#include "schema.h"
+#include "query_cli.h"
+#include "holder_index.h"
+#include "ingest_ledger.h"
+#include "master_index.h"
+#include "archive_importer.h"
+#include "metrics.h"
 #include <iostream>
-#include <thread>
-#include <chrono>
+#include <cstdlib>
+#include <cstring>
 #include <sqlite3.h>
 #include <curl/curl.h>
 
 using namespace std;
 
-int main() {
-    
+static void usage() {
+    cerr << "Usage: FinanceApp [--quarters SPEC] [--idx-dir DIR] [--folder-workers N] [--xml-workers N]\n"
+            "                  [--queue-size N] [--rps N] [--burst N] [--batch N]\n"
+            "                  [--cache-dir DIR] [--no-cache] [--offline]\n"
+            "                  [--no-wal] [--sync MODE] [--page-size N] [--cache-mb N] [--mmap-mb N]\n"
+            "                  [--bulk-load] [--no-holder-index] [--retry-failed] [--full-text] [--line-detail]\n"
+            "                  [--metrics-file PATH] [--metrics-interval SECONDS] [--base-url URL]\n"
+            "       FinanceApp query <command> ...   (run 'FinanceApp query' for commands)\n"
+            "       FinanceApp import [--workers N] [--batch N] [--no-holder-index] [--line-detail]\n"
+            "                         [--metrics-file PATH] [--metrics-interval SECONDS] ARCHIVE...\n"
+            "SPEC is a quarter, year or range, e.g. 2025Q2, 2024, 2020Q1-2025Q2 or 2021,2023.\n"
+            "Missing master indexes are downloaded, and those fetched before their quarter\n"
+            "closed are fetched again; without --quarters every master*.idx in the index\n"
+            "directory (default master_idx) is ingested.\n"
+            "import loads local archives: Form 13F data set zips, or zip/tar(.gz) files of\n"
+            "full submissions or filing folders.\n"
+            "Ingest metrics are printed every --metrics-interval seconds (default 60, 0 only\n"
+            "at the end) and written in Prometheus text format to --metrics-file.\n"
+            "--base-url replaces https://www.sec.gov, e.g. http://127.0.0.1:8080 for mock_edgar_server.\n"
+            "Rows of one position are summed into one holdings row; --line-detail also keeps\n"
+            "each row as filed in holdings_detail." << endl;
+}
+
+// Queries only read, so they never migrate: that is left to ingest and import
+static int runQuery(int argc, char* argv[]) {
+    sqlite3* db;
+    if (sqlite3_open_v2("holdings.db", &db, SQLITE_OPEN_READONLY, nullptr) != SQLITE_OK) {
+        cerr << "Can't open database: " << sqlite3_errmsg(db) << endl;
+        sqlite3_close(db);
+        return 1;
+    }
+    sqlite3_busy_timeout(db, StorageProfile().busyTimeoutMs);
+    int version = schemaVersion(db);
+    if (version != kSchemaVersion) {
+        cerr << "holdings.db is at schema version " << version << ", this build expects " << kSchemaVersion;
+        if (version < kSchemaVersion) cerr << "; run FinanceApp or FinanceApp import once to upgrade it";
+        cerr << endl;
+        sqlite3_close(db);
+        return 1;
+    }
+    int rc = runQueryCommand(db, argc, argv);
+    sqlite3_close(db);
+    return rc;
+}
+
+// Offline backfill from bulk archives; no HTTP involved
+static int runImport(int argc, char* argv[]) {
+    ImportConfig config;
+    bool useHolderIndex = true;
+    vector<string> archives;
+    string metricsFile;
+    int metricsInterval = 60;
+    for (int i = 0; i < argc; ++i) {
+        const char* arg = argv[i];
+        if (strcmp(arg, "--no-holder-index") == 0) { useHolderIndex = false; continue; }
+        if (strcmp(arg, "--line-detail") == 0) { config.keepLineDetail = true; continue; }
+        if (strncmp(arg, "--", 2) != 0) { archives.push_back(arg); continue; }
+        const char* val = (i + 1 < argc) ? argv[i + 1] : nullptr;
+        if (!val) { usage(); return 1; }
+        if (strcmp(arg, "--workers") == 0) config.workers = strtoul(val, nullptr, 10);
+        else if (strcmp(arg, "--batch") == 0) config.filingsPerTransaction = strtoul(val, nullptr, 10);
+        else if (strcmp(arg, "--metrics-file") == 0) metricsFile = val;
+        else if (strcmp(arg, "--metrics-interval") == 0) metricsInterval = atoi(val);
+        else { usage(); return 1; }
+        ++i;
+    }
+    if (archives.empty()) { usage(); return 1; }
+
+    sqlite3* db;
+    if (sqlite3_open("holdings.db", &db) != SQLITE_OK) {
+        cerr << "Can't open database: " << sqlite3_errmsg(db) << endl;
+        sqlite3_close(db);
+        return 1;
+    }
+    if (!applyStorageProfile(db, StorageProfile()) || !migrateSchema(db) || !resumeBulkLoad(db)) {
+        sqlite3_close(db);
+        return 1;
+    }
+
+    HolderIndex holderIndex;
+    string holderIndexFile = holderIndexPath(db);
+    if (useHolderIndex && !openHolderIndex(holderIndex, db, holderIndexFile)) {
+        useHolderIndex = false;
+    }
+
+    startMetricsReporter(metricsInterval, metricsFile);
+    int rc = 0;
+    for (const auto& archive : archives) {
+        ImportStats stats = importArchive(archive, db, config, useHolderIndex ? &holderIndex : nullptr);
+        cout << archive << ": entries: " << stats.entries << ", filings: " << stats.filings
+             << ", written: " << stats.written << ", skipped: " << stats.skipped
+             << ", failed: " << stats.failed << endl;
+        if (stats.failed) rc = 1;
+    }
+    if (useHolderIndex) {
+        saveHolderIndex(holderIndex, holderIndexFile);
+    }
+    stopMetricsReporter();
+    sqlite3_close(db);
+    return rc;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc > 1 && strcmp(argv[1], "query") == 0) {
+        return runQuery(argc - 2, argv + 2);
+    }
+    if (argc > 1 && strcmp(argv[1], "import") == 0) {
+        return runImport(argc - 2, argv + 2);
+    }
+
+    PipelineConfig config;
+    string cacheDir = "edgar_cache";
+    string idxDir = "master_idx";
+    string quarterSpec;
+    bool offline = false;
+    StorageProfile storage;
+    bool bulkLoad = false;
+    bool useHolderIndex = true;
+    bool retryFailed = false;
+    string metricsFile;
+    int metricsInterval = 60;
+    for (int i = 1; i < argc; ++i) {
+        const char* arg = argv[i];
+        if (strcmp(arg, "--no-cache") == 0) { cacheDir.clear(); continue; }
+        if (strcmp(arg, "--offline") == 0) { offline = true; continue; }
+        if (strcmp(arg, "--no-wal") == 0) { storage.wal = false; continue; }
+        if (strcmp(arg, "--bulk-load") == 0) { bulkLoad = true; continue; }
+        if (strcmp(arg, "--no-holder-index") == 0) { useHolderIndex = false; continue; }
+        if (strcmp(arg, "--retry-failed") == 0) { retryFailed = true; continue; }
+        if (strcmp(arg, "--full-text") == 0) { config.fullSubmission = true; continue; }
+        if (strcmp(arg, "--line-detail") == 0) { config.keepLineDetail = true; continue; }
+        const char* val = (i + 1 < argc) ? argv[i + 1] : nullptr;
+        if (!val) { usage(); return 1; }
+        if (strcmp(arg, "--folder-workers") == 0) config.folderWorkers = strtoul(val, nullptr, 10);
+        else if (strcmp(arg, "--xml-workers") == 0) config.xmlWorkers = strtoul(val, nullptr, 10);
+        else if (strcmp(arg, "--queue-size") == 0) config.queueCapacity = strtoul(val, nullptr, 10);
+        else if (strcmp(arg, "--rps") == 0) config.requestsPerSecond = atof(val);
+        else if (strcmp(arg, "--burst") == 0) config.burst = atof(val);
+        else if (strcmp(arg, "--batch") == 0) config.filingsPerTransaction = strtoul(val, nullptr, 10);
+        else if (strcmp(arg, "--cache-dir") == 0) cacheDir = val;
+        else if (strcmp(arg, "--quarters") == 0) quarterSpec = val;
+        else if (strcmp(arg, "--idx-dir") == 0) idxDir = val;
+        else if (strcmp(arg, "--sync") == 0) storage.synchronous = val;
+        else if (strcmp(arg, "--page-size") == 0) storage.pageSize = atoi(val);
+        else if (strcmp(arg, "--cache-mb") == 0) storage.cacheSizeMb = atoi(val);
+        else if (strcmp(arg, "--mmap-mb") == 0) storage.mmapSizeMb = atoll(val);
+        else if (strcmp(arg, "--metrics-file") == 0) metricsFile = val;
+        else if (strcmp(arg, "--metrics-interval") == 0) metricsInterval = atoi(val);
+        else if (strcmp(arg, "--base-url") == 0) setEdgarBaseUrl(val);
+        else { usage(); return 1; }
+        ++i;
+    }
+
+    vector<string> quarters;
+    if (!quarterSpec.empty() && !parseQuarterSpec(quarterSpec, quarters)) {
+        usage();
+        return 1;
+    }
+
+    if (offline && cacheDir.empty()) {
+        cerr << "--offline needs the cache" << endl;
+        return 1;
+    }
+
     sqlite3* db;
     int rc = sqlite3_open("holdings.db", &db);
     if (rc) {
         cerr << "Can't open database: " << sqlite3_errmsg(db) << endl;
+        sqlite3_close(db);
         return 1;
     }
 
-    // Create database schema
-    char* errMsg = nullptr;
-    rc = sqlite3_exec(db, schema, nullptr, nullptr, &errMsg);
-    if (rc != SQLITE_OK) {
-        cerr << "SQL error: " << errMsg << endl;
-        sqlite3_free(errMsg);
+    if (!applyStorageProfile(db, storage)) {
         sqlite3_close(db);
         return 1;
     }
 
-    curl_global_init(CURL_GLOBAL_DEFAULT);
+    // Create or upgrade the database schema
+    if (!migrateSchema(db)) {
+        sqlite3_close(db);
+        return 1;
+    }
+    // Indexes an interrupted bulk load dropped; a --bulk-load run rebuilds them at its end
+    if (!bulkLoad && !resumeBulkLoad(db)) {
+        sqlite3_close(db);
+        return 1;
+    }
 
-    //vector<tuple<string, string, string, string>> filings = extract13FHRUrls("master2025Q1.idx");
-    vector<tuple<string, string,string,string>> filings = extract13FHRUrls("master_idx/master2025Q2.idx");
-    //vector<tuple<string, string,string,string>> filings = extract13FHRUrls("master2025Q3.idx");
+    if (!cacheDir.empty() && !httpCache().open(cacheDir)) {
+        sqlite3_close(db);
+        return 1;
+    }
+    httpCache().setOffline(offline);
 
-    for (const auto& [name, folderUrl, quarter, filing_date] : filings) {
-        cout << endl << name << endl;
+    curl_global_init(CURL_GLOBAL_DEFAULT);
+    // Every exit from here on releases the database and curl alike
+    auto finish = [&](int status) {
+        sqlite3_close(db);
+        httpClient().shutdown();
+        curl_global_cleanup();
+        return status;
+    };
 
-        string html = fetchURL(folderUrl);
-        if (html.empty()) {
-            cerr << "Failed to fetch folder HTML: " << folderUrl << endl;
-            continue;
-        }
+    httpClient().rateLimiter().configure(config.requestsPerSecond, config.burst);
 
-        auto xmlLinks = extractXmlLinks(html, folderUrl);
+    // Every selected quarter goes through one pipeline and one rate limit
+    vector<string> indexFiles;
+    if (quarterSpec.empty()) {
+        indexFiles = listIndexFiles(idxDir);
+    } else {
+        indexFiles = ensureIndexFiles(idxDir, quarters);
+    }
+    if (indexFiles.empty()) {
+        cerr << "No master indexes to ingest in " << idxDir << endl;
+        return finish(1);
+    }
+    IndexLoadStats indexStats;
+    vector<FilingRef> filings = loadFilings(indexFiles, &indexStats);
+    cout << "Indexes: " << indexStats.files << ", 13F filings: " << indexStats.filings
+         << ", duplicate accessions dropped: " << indexStats.duplicates << endl;
+
+    // Skip what earlier runs already stored; failures wait out their backoff
+    ResumePlan plan = IngestLedger(db).plan(filings, retryFailed);
+    cout << "To ingest: " << plan.todo.size() << " (already committed: " << plan.committed
+         << ", backing off: " << plan.backingOff << ", given up: " << plan.givenUp << ")" << endl;
 
-        bool foundValidXml = false;
-        for (const auto& url : xmlLinks) {
-            string content = fetchURL(url);
+    // Kept in step with the holdings table by the writer, saved after the run
+    HolderIndex holderIndex;
+    string holderIndexFile = holderIndexPath(db);
+    if (useHolderIndex && !openHolderIndex(holderIndex, db, holderIndexFile)) {
+        useHolderIndex = false;
+    }
 
-            if (content.find("infoTable") != string::npos || content.find("<nameOfIssuer") != string::npos) {
-                cout << "Valid XML found: " << url << endl;
+    if (bulkLoad && !beginBulkLoad(db)) {
+        return finish(1);
+    }
 
-                parse13F(content, name, quarter, filing_date, db);
-                foundValidXml = true;
-                break;
-            }
-        }
+    startMetricsReporter(metricsInterval, metricsFile);
+    PipelineStats stats = runPipeline(plan.todo, db, config, useHolderIndex ? &holderIndex : nullptr);
 
-        if (!foundValidXml) {
-            cerr << "No valid XML found for: " << folderUrl << endl;
-            return 1;
-        }
-        std::this_thread::sleep_for(std::chrono::seconds(1));
+    if (bulkLoad) {
+        cout << "Rebuilding indexes..." << endl;
+        endBulkLoad(db);
     }
+    if (useHolderIndex) {
+        saveHolderIndex(holderIndex, holderIndexFile);
+    }
+    cout << "Filings: " << stats.filings << ", written: " << stats.written
+         << ", failed: " << stats.failed << endl;
+    if (httpCache().enabled()) {
+        cout << "Cache hits: " << httpCache().hits() << ", misses: " << httpCache().misses() << endl;
+    }
+    stopMetricsReporter();
 
-    sqlite3_close(db);
-    curl_global_cleanup();
-    return 0;
+    // Failed filings fail the run, as in runImport, so scripts can tell
+    return finish(stats.failed ? 1 : 0);
 }
@@ -0,0 +1,222 @@
+#include "master_index.h"
+#include "sec_parser.h"
+#include "http_cache.h"
+#include "http_client.h"
+#include <algorithm>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdlib>
+#include <ctime>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <unordered_map>
+#include <unordered_set>
+#include <sys/stat.h>
+
+using namespace std;
+namespace fs = std::filesystem;
+
+namespace {
+
+// "2025Q2" -> 2025 * 4 + 1, "2025" -> first or last quarter of the year
+bool parseQuarter(const string& s, bool endOfYear, int& index) {
+    if (s.size() != 4 && s.size() != 6) return false;
+    for (size_t i = 0; i < 4; ++i) {
+        if (s[i] < '0' || s[i] > '9') return false;
+    }
+    int year = atoi(s.substr(0, 4).c_str());
+    int q = endOfYear ? 3 : 0;
+    if (s.size() == 6) {
+        if ((s[4] != 'Q' && s[4] != 'q') || s[5] < '1' || s[5] > '4') return false;
+        q = s[5] - '1';
+    }
+    index = year * 4 + q;
+    return true;
+}
+
+string quarterName(int index) {
+    return to_string(index / 4) + "Q" + to_string(index % 4 + 1);
+}
+
+// Filings of a quarter's last day are disseminated overnight, so an index
+// is only complete a little after the quarter ends
+const time_t kIndexSettleSeconds = 2 * 24 * 3600;
+
+// Days from 1970-01-01 to year-month-day in the proleptic Gregorian
+// calendar (Howard Hinnant's days_from_civil); timegm is not portable
+int64_t daysFromCivil(int64_t y, unsigned m, unsigned d) {
+    y -= m <= 2;
+    int64_t era = (y >= 0 ? y : y - 399) / 400;
+    unsigned yoe = static_cast<unsigned>(y - era * 400);
+    unsigned doy = (153 * (m > 2 ? m - 3 : m + 9) + 2) / 5 + d - 1;
+    unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + static_cast<int64_t>(doe) - 719468;
+}
+
+// True if the file at `path` was written after `quarter` closed
+bool indexIsFinal(const string& path, const string& quarter) {
+    int index;
+    struct stat st;
+    if (!parseQuarter(quarter, false, index) || stat(path.c_str(), &st) != 0) return false;
+    // UTC midnight on the first day of the next quarter
+    int next = index + 1;
+    time_t end = static_cast<time_t>(daysFromCivil(next / 4, (next % 4) * 3 + 1, 1) * 24 * 3600);
+    return st.st_mtime >= end + kIndexSettleSeconds;
+}
+
+// Every index at once over HttpClient's event loop, which shares the rate
+// limit with the rest of the run; bodies in URL order, "" on failure.
+// master.idx bypasses the response cache, which would hand back the copy
+// being refreshed; offline, the cache is all there is.
+vector<string> fetchIndexes(const vector<string>& urls) {
+    vector<string> bodies(urls.size());
+    if (urls.empty()) return bodies;
+    if (httpCache().offline()) {
+        for (size_t i = 0; i < urls.size(); ++i) bodies[i] = fetchURL(urls[i]);
+        return bodies;
+    }
+
+    unordered_map<string, size_t> slots;
+    for (size_t i = 0; i < urls.size(); ++i) slots.emplace(urls[i], i);
+    mutex m;
+    condition_variable finished;
+    size_t remaining = urls.size();
+    httpClient().fetchMany(urls, [&](const string& url, FetchResult result) {
+        if (result.code != CURLE_OK) {
+            cerr << "Fetching " << url << " failed: " << curl_easy_strerror(result.code) << endl;
+        }
+        lock_guard<mutex> lock(m);
+        if (result.ok()) bodies[slots.at(url)] = std::move(result.body);
+        if (--remaining == 0) finished.notify_one();
+    });
+    unique_lock<mutex> lock(m);
+    finished.wait(lock, [&] { return remaining == 0; });
+    return bodies;
+}
+
+// Replaces path with body through a temporary file, so a reader never sees
+// half an index
+bool writeIndexFile(const string& dir, const string& path, const string& body) {
+    error_code ec;
+    fs::create_directories(dir, ec);
+    string tmp = path + ".tmp";
+    {
+        ofstream out(tmp, ios::binary | ios::trunc);
+        out.write(body.data(), static_cast<streamsize>(body.size()));
+        if (!out) {
+            cerr << "Could not write " << tmp << endl;
+            return false;
+        }
+    }
+    fs::rename(tmp, path, ec);
+    if (ec) {
+        fs::remove(tmp, ec);
+        cerr << "Could not write " << path << endl;
+        return false;
+    }
+    return true;
+}
+
+} // namespace
+
+bool parseQuarterSpec(const string& spec, vector<string>& quarters) {
+    stringstream ss(spec);
+    string part;
+    while (getline(ss, part, ',')) {
+        size_t dash = part.find('-');
+        string first = part.substr(0, dash);
+        string last = dash == string::npos ? first : part.substr(dash + 1);
+        int from, to;
+        if (!parseQuarter(first, false, from) || !parseQuarter(last, true, to) || from > to) {
+            cerr << "Bad quarter range: " << part << endl;
+            return false;
+        }
+        for (int i = from; i <= to; ++i) quarters.push_back(quarterName(i));
+    }
+    return !quarters.empty();
+}
+
+string indexPathForQuarter(const string& dir, const string& quarter) {
+    return (fs::path(dir) / ("master" + quarter + ".idx")).string();
+}
+
+vector<string> ensureIndexFiles(const string& dir, const vector<string>& quarters) {
+    vector<string> paths, stale, urls;
+    error_code ec;
+    unordered_set<string> seen;
+    for (const auto& quarter : quarters) {
+        if (!seen.insert(quarter).second) continue;
+        string path = indexPathForQuarter(dir, quarter);
+        bool exists = fs::exists(path, ec);
+        if (exists && (indexIsFinal(path, quarter) || httpCache().offline())) continue;
+        string url = edgarBaseUrl() + "/Archives/edgar/full-index/" + quarter.substr(0, 4) + "/QTR" +
+                     quarter.substr(5, 1) + "/master.idx";
+        cout << (exists ? "Refreshing " : "Downloading ") << url << endl;
+        stale.push_back(quarter);
+        urls.push_back(url);
+    }
+    vector<string> bodies = fetchIndexes(urls);
+
+    seen.clear();
+    for (size_t i = 0, next = 0; i < quarters.size(); ++i) {
+        if (!seen.insert(quarters[i]).second) continue;
+        string path = indexPathForQuarter(dir, quarters[i]);
+        if (next == stale.size() || stale[next] != quarters[i]) {
+            paths.push_back(path);
+            continue;
+        }
+        const string& body = bodies[next++];
+        bool exists = fs::exists(path, ec);
+        if (body.find("CIK|Company Name|Form Type|Date Filed|Filename") == string::npos) {
+            // An older copy still lists every filing it did before
+            if (exists) {
+                cerr << "Could not refresh master index for " << quarters[i] << ", using " << path << endl;
+                paths.push_back(path);
+            } else {
+                cerr << "Could not download master index for " << quarters[i] << endl;
+            }
+            continue;
+        }
+        if (writeIndexFile(dir, path, body)) paths.push_back(path);
+    }
+    return paths;
+}
+
+vector<string> listIndexFiles(const string& dir) {
+    vector<string> paths;
+    error_code ec;
+    for (const auto& entry : fs::directory_iterator(dir, ec)) {
+        string name = entry.path().filename().string();
+        if (entry.is_regular_file(ec) && name.rfind("master", 0) == 0 && entry.path().extension() == ".idx") {
+            paths.push_back(entry.path().string());
+        }
+    }
+    if (ec) cerr << "Could not list " << dir << ": " << ec.message() << endl;
+    sort(paths.begin(), paths.end());
+    return paths;
+}
+
+vector<FilingRef> loadFilings(const vector<string>& paths, IndexLoadStats* stats) {
+    vector<FilingRef> filings;
+    unordered_set<string> seen;
+    IndexLoadStats counts;
+    for (const auto& path : paths) {
+        vector<FilingRef> batch = extract13FHRUrls(path);
+        if (batch.empty()) continue;
+        ++counts.files;
+        for (auto& f : batch) {
+            // An accession can show up in more than one index, e.g. after a re-dissemination
+            if (!f.accession.empty() && !seen.insert(f.accession).second) {
+                ++counts.duplicates;
+                continue;
+            }
+            filings.push_back(std::move(f));
+        }
+    }
+    counts.filings = filings.size();
+    if (stats) *stats = counts;
+    return filings;
+}
@@ -0,0 +1,34 @@
+// master_index.h
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+#include "idx_scanner.h"
+
+// Quarters named like "2025Q2". Accepts a single quarter, a year ("2024" is
+// 2024Q1-2024Q4), a range of either ("2021Q3-2025Q2", "2020-2024"), or a
+// comma-separated list of those. False on a malformed spec.
+bool parseQuarterSpec(const std::string& spec, std::vector<std::string>& quarters);
+
+// <dir>/master<quarter>.idx
+std::string indexPathForQuarter(const std::string& dir, const std::string& quarter);
+
+// Downloads EDGAR's full-index master.idx of each quarter into dir, all at
+// once, and returns the paths of those now there, in quarter order. A file
+// already there is kept once it was fetched after the quarter closed;
+// before that EDGAR still appends to it, so it is fetched again.
+std::vector<std::string> ensureIndexFiles(const std::string& dir, const std::vector<std::string>& quarters);
+
+// Every master*.idx in dir, in name order (i.e. chronological)
+std::vector<std::string> listIndexFiles(const std::string& dir);
+
+struct IndexLoadStats {
+    size_t files = 0;
+    size_t filings = 0;
+    size_t duplicates = 0;   // accessions already seen in an earlier file
+};
+
+// 13F filings from every index, first occurrence of each accession kept
+std::vector<FilingRef> loadFilings(const std::vector<std::string>& paths, IndexLoadStats* stats = nullptr);
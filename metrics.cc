@@ -0,0 +1,338 @@
+#include "metrics.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+#ifdef FINANCEAPP_METRICS
+
+namespace {
+
+const size_t kCounters = static_cast<size_t>(Counter::Count);
+const size_t kStages = static_cast<size_t>(Stage::Count);
+const size_t kStatuses = 600;            // 0 holds failed transfers
+const int kSubBits = 4;                  // 16 buckets per power of two
+const size_t kSub = size_t(1) << kSubBits;
+const int kMaxExponent = 40;             // 2^40 us is about 12 days
+const size_t kBuckets = (kMaxExponent - kSubBits + 2) * kSub;
+
+const char* kCounterNames[] = {"http_requests", "http_retries", "bytes_fetched", "cache_hits",
+                               "xml_bytes_parsed", "rows_parsed", "rows_inserted", "filings_written"};
+const char* kStageNames[] = {"fetch", "rate_limit_wait", "scan_index", "extract_links",
+                             "parse_info_table", "write_filing", "commit"};
+
+// Written by its own thread only, so a relaxed load and store is enough
+using Cell = atomic<uint64_t>;
+
+void bump(Cell& cell, uint64_t n) {
+    cell.store(cell.load(memory_order_relaxed) + n, memory_order_relaxed);
+}
+
+struct Shard {
+    Cell counters[kCounters] = {};
+    Cell statuses[kStatuses] = {};
+    Cell buckets[kStages][kBuckets] = {};
+    Cell sums[kStages] = {};             // microseconds
+};
+
+// Shards outlive their threads so nothing recorded is lost. Never
+// destroyed: threads may still record during static destruction.
+struct Registry {
+    mutex lock;
+    vector<unique_ptr<Shard>> shards;
+    chrono::steady_clock::time_point started = chrono::steady_clock::now();
+};
+
+Registry& registry() {
+    static Registry* r = new Registry;
+    return *r;
+}
+
+Shard& localShard() {
+    thread_local Shard* shard = [] {
+        Registry& r = registry();
+        lock_guard<mutex> lock(r.lock);
+        r.shards.push_back(make_unique<Shard>());
+        return r.shards.back().get();
+    }();
+    return *shard;
+}
+
+size_t bucketFor(uint64_t us) {
+    if (us < kSub) return static_cast<size_t>(us);
+    int exponent = kSubBits;
+    while (exponent <= kMaxExponent && (us >> (exponent + 1))) ++exponent;
+    if (exponent > kMaxExponent) return kBuckets - 1;
+    size_t sub = static_cast<size_t>(us >> (exponent - kSubBits)) & (kSub - 1);
+    return (exponent - kSubBits + 1) * kSub + sub;
+}
+
+// Largest value that falls into the bucket
+uint64_t bucketUpper(size_t bucket) {
+    if (bucket < kSub) return bucket;
+    int exponent = static_cast<int>(bucket / kSub) + kSubBits - 1;
+    uint64_t lower = (kSub + bucket % kSub) << (exponent - kSubBits);
+    return lower + (uint64_t(1) << (exponent - kSubBits)) - 1;
+}
+
+struct StageStats {
+    uint64_t count = 0;
+    uint64_t sumUs = 0;
+    vector<uint64_t> buckets = vector<uint64_t>(kBuckets, 0);
+
+    // In microseconds; the upper bound of the bucket holding the q-quantile
+    uint64_t quantile(double q) const {
+        if (count == 0) return 0;
+        uint64_t rank = static_cast<uint64_t>(q * (count - 1)) + 1;
+        uint64_t seen = 0;
+        for (size_t b = 0; b < kBuckets; ++b) {
+            seen += buckets[b];
+            if (seen >= rank) return bucketUpper(b);
+        }
+        return bucketUpper(kBuckets - 1);
+    }
+};
+
+struct Snapshot {
+    double elapsed = 0;
+    uint64_t counters[kCounters] = {};
+    uint64_t statuses[kStatuses] = {};
+    StageStats stages[kStages];
+};
+
+Snapshot takeSnapshot() {
+    Snapshot s;
+    Registry& r = registry();
+    lock_guard<mutex> lock(r.lock);
+    s.elapsed = chrono::duration<double>(chrono::steady_clock::now() - r.started).count();
+    for (const auto& shard : r.shards) {
+        for (size_t i = 0; i < kCounters; ++i) s.counters[i] += shard->counters[i].load(memory_order_relaxed);
+        for (size_t i = 0; i < kStatuses; ++i) s.statuses[i] += shard->statuses[i].load(memory_order_relaxed);
+        for (size_t st = 0; st < kStages; ++st) {
+            StageStats& stats = s.stages[st];
+            stats.sumUs += shard->sums[st].load(memory_order_relaxed);
+            for (size_t b = 0; b < kBuckets; ++b) {
+                uint64_t n = shard->buckets[st][b].load(memory_order_relaxed);
+                stats.buckets[b] += n;
+                stats.count += n;
+            }
+        }
+    }
+    return s;
+}
+
+uint64_t counter(const Snapshot& s, Counter c) {
+    return s.counters[static_cast<size_t>(c)];
+}
+
+string formatUs(uint64_t us) {
+    char buf[32];
+    if (us < 1000) snprintf(buf, sizeof(buf), "%lluus", static_cast<unsigned long long>(us));
+    else if (us < 1000000) snprintf(buf, sizeof(buf), "%.1fms", us / 1e3);
+    else snprintf(buf, sizeof(buf), "%.2fs", us / 1e6);
+    return buf;
+}
+
+double megabytes(uint64_t bytes) {
+    return bytes / (1024.0 * 1024.0);
+}
+
+} // namespace
+
+void countMetric(Counter c, uint64_t n) {
+    bump(localShard().counters[static_cast<size_t>(c)], n);
+}
+
+void countHttpStatus(long status) {
+    size_t slot = status > 0 && status < static_cast<long>(kStatuses) ? static_cast<size_t>(status) : 0;
+    Shard& shard = localShard();
+    bump(shard.statuses[slot], 1);
+    bump(shard.counters[static_cast<size_t>(Counter::HttpRequests)], 1);
+}
+
+void recordLatency(Stage stage, chrono::nanoseconds latency) {
+    uint64_t us = static_cast<uint64_t>(max<int64_t>(0, chrono::duration_cast<chrono::microseconds>(latency).count()));
+    Shard& shard = localShard();
+    size_t st = static_cast<size_t>(stage);
+    bump(shard.buckets[st][bucketFor(us)], 1);
+    bump(shard.sums[st], us);
+}
+
+bool metricsEnabled() {
+    return true;
+}
+
+string metricsSummary() {
+    Snapshot s = takeSnapshot();
+    double secs = s.elapsed > 0 ? s.elapsed : 1;
+    char line[512];
+    string out;
+
+    snprintf(line, sizeof(line), "metrics after %.0fs\n", s.elapsed);
+    out += line;
+    snprintf(line, sizeof(line), "  http: %llu requests, %llu retries, %.1f MB (%.2f MB/s), cache hits %llu",
+             static_cast<unsigned long long>(counter(s, Counter::HttpRequests)),
+             static_cast<unsigned long long>(counter(s, Counter::HttpRetries)),
+             megabytes(counter(s, Counter::BytesFetched)), megabytes(counter(s, Counter::BytesFetched)) / secs,
+             static_cast<unsigned long long>(counter(s, Counter::CacheHits)));
+    out += line;
+    for (size_t code = 0; code < kStatuses; ++code) {
+        if (!s.statuses[code]) continue;
+        snprintf(line, sizeof(line), ", %s: %llu", code ? to_string(code).c_str() : "failed",
+                 static_cast<unsigned long long>(s.statuses[code]));
+        out += line;
+    }
+    snprintf(line, sizeof(line), "\n  parse: %.1f MB xml, %llu rows; db: %llu rows (%.0f rows/s), %llu filings\n",
+             megabytes(counter(s, Counter::XmlBytesParsed)),
+             static_cast<unsigned long long>(counter(s, Counter::RowsParsed)),
+             static_cast<unsigned long long>(counter(s, Counter::RowsInserted)),
+             counter(s, Counter::RowsInserted) / secs,
+             static_cast<unsigned long long>(counter(s, Counter::FilingsWritten)));
+    out += line;
+    for (size_t st = 0; st < kStages; ++st) {
+        const StageStats& stats = s.stages[st];
+        if (!stats.count) continue;
+        snprintf(line, sizeof(line), "  %-17s n=%-9llu p50=%-9s p99=%-9s max=%-9s total=%s\n", kStageNames[st],
+                 static_cast<unsigned long long>(stats.count), formatUs(stats.quantile(0.5)).c_str(),
+                 formatUs(stats.quantile(0.99)).c_str(), formatUs(stats.quantile(1.0)).c_str(),
+                 formatUs(stats.sumUs).c_str());
+        out += line;
+    }
+    return out;
+}
+
+string metricsPrometheus() {
+    Snapshot s = takeSnapshot();
+    string out;
+    char line[256];
+
+    for (size_t i = 0; i < kCounters; ++i) {
+        snprintf(line, sizeof(line), "# TYPE financeapp_%s_total counter\nfinanceapp_%s_total %llu\n",
+                 kCounterNames[i], kCounterNames[i], static_cast<unsigned long long>(s.counters[i]));
+        out += line;
+    }
+
+    out += "# TYPE financeapp_http_responses_total counter\n";
+    for (size_t code = 0; code < kStatuses; ++code) {
+        if (!s.statuses[code]) continue;
+        snprintf(line, sizeof(line), "financeapp_http_responses_total{code=\"%s\"} %llu\n",
+                 code ? to_string(code).c_str() : "error", static_cast<unsigned long long>(s.statuses[code]));
+        out += line;
+    }
+
+    out += "# TYPE financeapp_stage_latency_seconds summary\n";
+    for (size_t st = 0; st < kStages; ++st) {
+        const StageStats& stats = s.stages[st];
+        for (double q : {0.5, 0.9, 0.99}) {
+            snprintf(line, sizeof(line), "financeapp_stage_latency_seconds{stage=\"%s\",quantile=\"%g\"} %.6f\n",
+                     kStageNames[st], q, stats.quantile(q) / 1e6);
+            out += line;
+        }
+        snprintf(line, sizeof(line),
+                 "financeapp_stage_latency_seconds_sum{stage=\"%s\"} %.6f\n"
+                 "financeapp_stage_latency_seconds_count{stage=\"%s\"} %llu\n",
+                 kStageNames[st], stats.sumUs / 1e6, kStageNames[st], static_cast<unsigned long long>(stats.count));
+        out += line;
+    }
+    return out;
+}
+
+bool writeMetricsFile(const string& path) {
+    string tmp = path + ".tmp";
+    {
+        ofstream file(tmp, ios::binary | ios::trunc);
+        if (!file || !(file << metricsPrometheus())) {
+            cerr << "Could not write metrics file " << tmp << endl;
+            return false;
+        }
+    }
+    if (rename(tmp.c_str(), path.c_str()) != 0) {
+        cerr << "Could not replace metrics file " << path << endl;
+        return false;
+    }
+    return true;
+}
+
+namespace {
+
+struct Reporter {
+    mutex lock;
+    condition_variable wake;
+    bool stopping = false;
+    bool active = false;
+    thread worker;
+    int interval = 0;
+    string path;
+};
+
+Reporter reporter;
+
+void report() {
+    cerr << metricsSummary();
+    if (!reporter.path.empty()) writeMetricsFile(reporter.path);
+}
+
+} // namespace
+
+void startMetricsReporter(int intervalSeconds, const string& path) {
+    stopMetricsReporter();
+    reporter.interval = intervalSeconds;
+    reporter.path = path;
+    reporter.stopping = false;
+    reporter.active = true;
+    if (intervalSeconds <= 0) return;
+    reporter.worker = thread([] {
+        unique_lock<mutex> lock(reporter.lock);
+        while (!reporter.wake.wait_for(lock, chrono::seconds(reporter.interval), [] { return reporter.stopping; })) {
+            report();
+        }
+    });
+}
+
+void stopMetricsReporter() {
+    if (!reporter.active) return;
+    if (reporter.worker.joinable()) {
+        {
+            lock_guard<mutex> lock(reporter.lock);
+            reporter.stopping = true;
+        }
+        reporter.wake.notify_all();
+        reporter.worker.join();
+    }
+    report();
+    reporter.active = false;
+    reporter.path.clear();
+}
+
+#else
+
+bool metricsEnabled() {
+    return false;
+}
+
+string metricsSummary() {
+    return "metrics: built without FINANCEAPP_METRICS\n";
+}
+
+string metricsPrometheus() {
+    return "";
+}
+
+bool writeMetricsFile(const string&) {
+    return false;
+}
+
+void startMetricsReporter(int, const string& path) {
+    if (!path.empty()) cerr << "Metrics file ignored: built without FINANCEAPP_METRICS" << endl;
+}
+
+void stopMetricsReporter() {}
+
+#endif
@@ -0,0 +1,525 @@
+// Local stand-in for www.sec.gov, for load and fault-injection runs of the
+// fetch path without touching the live site:
+//
+//   mock_edgar_server --synthetic 2000 --latency-ms 40 --error-rate 0.02 &
+//   FinanceApp --base-url http://127.0.0.1:8080 --quarters 2025Q3 --idx-dir /tmp/idx --no-cache --rps 200
+//
+// --root serves recorded pages by URL path (fixtures/edgar is a small
+// example); a directory URL returns its index.html, or a generated listing in
+// the EDGAR folder markup. --synthetic answers every EDGAR path the ingest
+// requests from deterministic generated content: master.idx for any
+// quarter, folder listings, -index.htm pages, cover pages, information
+// tables and full submissions. Root files take precedence.
+//
+// Faults are drawn per request: --error-rate answers 429 or 503 with a
+// Retry-After header, --drop-rate closes the connection halfway through the
+// body. --latency-ms/--jitter-ms delay every response, --bandwidth-kbps caps
+// each connection's send rate.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using namespace std;
+namespace fs = std::filesystem;
+
+namespace {
+
+struct Options {
+    int port = 8080;
+    string bind = "127.0.0.1";
+    string root;
+    size_t synthetic = 0;        // filings per quarter
+    size_t rows = 200;           // mean information table rows
+    int latencyMs = 0;
+    int jitterMs = 0;
+    double bandwidthKbps = 0;    // per connection, 0 is unlimited
+    double errorRate = 0;
+    int retryAfter = 1;
+    double dropRate = 0;
+    unsigned seed = 1;
+    int statsInterval = 10;
+};
+
+Options options;
+
+struct Stats {
+    atomic<uint64_t> connections{0};
+    atomic<uint64_t> requests{0};
+    atomic<uint64_t> ok{0};
+    atomic<uint64_t> notFound{0};
+    atomic<uint64_t> throttled{0};
+    atomic<uint64_t> dropped{0};
+    atomic<uint64_t> bytes{0};
+};
+
+Stats stats;
+
+const uint32_t kFirstCik = 9000000;
+
+// ---- Fault and delay injection ----
+
+mutex rngLock;
+mt19937_64 rng;
+
+double uniform() {
+    lock_guard<mutex> lock(rngLock);
+    return uniform_real_distribution<double>(0, 1)(rng);
+}
+
+void injectLatency() {
+    int ms = options.latencyMs;
+    if (options.jitterMs > 0) ms += static_cast<int>(uniform() * options.jitterMs);
+    if (ms > 0) this_thread::sleep_for(chrono::milliseconds(ms));
+}
+
+bool sendAll(int fd, const char* data, size_t len) {
+    while (len) {
+        ssize_t n = send(fd, data, len, MSG_NOSIGNAL);
+        if (n <= 0) return false;
+        data += n;
+        len -= static_cast<size_t>(n);
+        stats.bytes += static_cast<uint64_t>(n);
+    }
+    return true;
+}
+
+// Paces the body to the configured bandwidth in ~20 ms slices
+bool sendBody(int fd, const string& body, size_t len) {
+    if (options.bandwidthKbps <= 0) return sendAll(fd, body.data(), len);
+    double bytesPerSec = options.bandwidthKbps * 1024;
+    size_t slice = max<size_t>(1024, static_cast<size_t>(bytesPerSec / 50));
+    auto start = chrono::steady_clock::now();
+    for (size_t sent = 0; sent < len;) {
+        size_t n = min(slice, len - sent);
+        if (!sendAll(fd, body.data() + sent, n)) return false;
+        sent += n;
+        this_thread::sleep_until(start + chrono::duration_cast<chrono::steady_clock::duration>(
+                                             chrono::duration<double>(sent / bytesPerSec)));
+    }
+    return true;
+}
+
+// ---- Synthetic EDGAR ----
+
+uint64_t mix(uint64_t x) {
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ULL;
+    return x ^ (x >> 33);
+}
+
+// Filing i of a quarter: CIK 9000000+i, accession <cik>-<yy>-<q><i>
+struct SyntheticFiling {
+    uint32_t cik = 0;
+    int year = 0;
+    int quarter = 0;
+    size_t index = 0;
+
+    string accession() const {
+        char buf[32];
+        snprintf(buf, sizeof(buf), "%010u-%02d-%d%05zu", cik, year % 100, quarter, index % 100000);
+        return buf;
+    }
+    string folder() const {
+        string acc = accession();
+        acc.erase(remove(acc.begin(), acc.end(), '-'), acc.end());
+        return "/Archives/edgar/data/" + to_string(cik) + "/" + acc + "/";
+    }
+    string name() const { return "SYNTHETIC CAPITAL " + to_string(index) + " LLC"; }
+    string filed() const {
+        char buf[32];
+        snprintf(buf, sizeof(buf), "%04d-%02d-%02zu", year, quarter * 3 - 1, 1 + index % 28);
+        return buf;
+    }
+    string period() const {
+        static const char* kEnds[] = {"12-31", "03-31", "06-30", "09-30"};
+        return to_string(quarter == 1 ? year - 1 : year) + "-" + kEnds[quarter - 1];
+    }
+    size_t rows() const {
+        size_t mean = max<size_t>(options.rows, 1);
+        return 1 + mix(cik * 31 + year * 4 + quarter) % (2 * mean);
+    }
+};
+
+// Parses /Archives/edgar/data/<cik>/<accession without dashes>/ back into
+// the filing it names; `rest` is what follows the folder
+bool parseFolderPath(string_view path, SyntheticFiling& filing, string_view& rest) {
+    static const string_view kPrefix = "/Archives/edgar/data/";
+    if (path.substr(0, kPrefix.size()) != kPrefix) return false;
+    path.remove_prefix(kPrefix.size());
+    size_t slash = path.find('/');
+    if (slash == string_view::npos) return false;
+    uint32_t cik = static_cast<uint32_t>(strtoul(string(path.substr(0, slash)).c_str(), nullptr, 10));
+    path.remove_prefix(slash + 1);
+    slash = path.find('/');
+    if (slash != 18 || cik < kFirstCik || cik - kFirstCik >= options.synthetic) return false;
+    string acc(path.substr(0, slash));
+    char cikDigits[16];
+    snprintf(cikDigits, sizeof(cikDigits), "%010u", cik);
+    if (acc.compare(0, 10, cikDigits) != 0) return false;
+    filing.cik = cik;
+    filing.index = cik - kFirstCik;
+    filing.year = 2000 + atoi(acc.substr(10, 2).c_str());
+    filing.quarter = acc[12] - '0';
+    if (filing.quarter < 1 || filing.quarter > 4 || atoi(acc.substr(13).c_str()) != static_cast<int>(filing.index % 100000)) {
+        return false;
+    }
+    rest = path.substr(slash + 1);
+    return true;
+}
+
+string masterIndex(int year, int quarter) {
+    string out = "Description:           Master Index of EDGAR Dissemination Feed\n"
+                 "Comments:              mock_edgar_server synthetic data\n\n\n\n"
+                 "CIK|Company Name|Form Type|Date Filed|Filename\n"
+                 "--------------------------------------------------------------------------------\n";
+    for (size_t i = 0; i < options.synthetic; ++i) {
+        SyntheticFiling f{kFirstCik + static_cast<uint32_t>(i), year, quarter, i};
+        string prefix = to_string(f.cik) + "|" + f.name() + "|";
+        // Other forms around each filing, as in the real index
+        out += prefix + "4|" + f.filed() + "|edgar/data/" + to_string(f.cik) + "/0000000000-00-000000.txt\n";
+        out += prefix + "13F-HR|" + f.filed() + "|edgar/data/" + to_string(f.cik) + "/" + f.accession() + ".txt\n";
+    }
+    return out;
+}
+
+string folderListing(const string& dir, const vector<string>& files) {
+    string out = "<html><head><title>Index of " + dir + "</title></head><body>\n"
+                 "<table summary=\"heding\" id=\"main\">\n<tr><th>Name</th><th>Size</th></tr>\n";
+    for (const auto& f : files) out += "<tr><td><a href=\"" + dir + f + "\">" + f + "</a></td><td></td></tr>\n";
+    out += "</table></body></html>\n";
+    return out;
+}
+
+string filingIndexPage(const SyntheticFiling& f) {
+    string dir = f.folder();
+    auto row = [&](int seq, const char* description, const string& file, const char* type) {
+        return "<tr><td scope=\"row\">" + to_string(seq) + "</td><td scope=\"row\">" + description +
+               "</td><td scope=\"row\"><a href=\"" + dir + file + "\">" + file + "</a></td><td scope=\"row\">" +
+               type + "</td><td scope=\"row\"></td></tr>\n";
+    };
+    return "<html><body><div id=\"formName\"><strong>Form 13F-HR</strong></div>\n"
+           "<table class=\"tableFile\" summary=\"Document Format Files\">\n"
+           "<tr><th>Seq</th><th>Description</th><th>Document</th><th>Type</th><th>Size</th></tr>\n" +
+           row(1, "", "xslForm13F_X02/primary_doc.xml", "13F-HR") + row(1, "", "primary_doc.xml", "13F-HR") +
+           row(2, "", "xslForm13F_X02/infotable.xml", "INFORMATION TABLE") +
+           row(2, "", "infotable.xml", "INFORMATION TABLE") +
+           row(0, "Complete submission text file", f.accession() + ".txt", "&nbsp;") + "</table></body></html>\n";
+}
+
+string coverPage(const SyntheticFiling& f) {
+    string period = f.period();
+    string filed = f.filed();
+    return "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+           "<edgarSubmission xmlns=\"http://www.sec.gov/edgar/thirteenffiler\">\n"
+           "  <headerData><submissionType>13F-HR</submissionType><filerInfo><filer><credentials><cik>" +
+           to_string(f.cik) + "</cik></credentials></filer><periodOfReport>" + period.substr(5, 2) + "-" +
+           period.substr(8, 2) + "-" + period.substr(0, 4) +
+           "</periodOfReport></filerInfo></headerData>\n"
+           "  <formData><coverPage><reportCalendarOrQuarter>" + period + "</reportCalendarOrQuarter>"
+           "<isAmendment>false</isAmendment><filingManager><name>" + f.name() +
+           "</name></filingManager><reportType>13F HOLDINGS REPORT</reportType></coverPage>\n"
+           "  <signatureBlock><signatureDate>" + filed.substr(5, 2) + "-" + filed.substr(8, 2) + "-" +
+           filed.substr(0, 4) + "</signatureDate></signatureBlock></formData>\n"
+           "</edgarSubmission>\n";
+}
+
+string infoTable(const SyntheticFiling& f) {
+    string xml = "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+                 "<informationTable xmlns=\"http://www.sec.gov/edgar/document/thirteenf/informationtable\">\n";
+    char row[768];
+    size_t rows = f.rows();
+    for (size_t i = 0; i < rows; ++i) {
+        uint64_t h = mix(f.cik * 1000003ULL + i);
+        // Issuers come from a shared universe so positions overlap across firms
+        unsigned issuer = static_cast<unsigned>(h % 20000);
+        long long shares = 100 + static_cast<long long>(h >> 20) % 5000000;
+        snprintf(row, sizeof(row),
+                 "<infoTable><nameOfIssuer>ISSUER %u CORP</nameOfIssuer><titleOfClass>COM</titleOfClass>"
+                 "<cusip>%06uAB%u</cusip><value>%lld</value><shrsOrPrnAmt><sshPrnamt>%lld</sshPrnamt>"
+                 "<sshPrnamtType>SH</sshPrnamtType></shrsOrPrnAmt><investmentDiscretion>SOLE</investmentDiscretion>"
+                 "<votingAuthority><Sole>%lld</Sole><Shared>0</Shared><None>0</None></votingAuthority></infoTable>\n",
+                 issuer, issuer, issuer % 10, shares * 37, shares, shares);
+        xml += row;
+    }
+    xml += "</informationTable>\n";
+    return xml;
+}
+
+string fullSubmission(const SyntheticFiling& f) {
+    string acc = f.accession();
+    string filed = f.filed();
+    filed.erase(remove(filed.begin(), filed.end(), '-'), filed.end());
+    string period = f.period();
+    period.erase(remove(period.begin(), period.end(), '-'), period.end());
+    return "<SEC-DOCUMENT>" + acc + ".txt : " + filed + "\n<SEC-HEADER>" + acc + ".hdr.sgml : " + filed +
+           "\nACCESSION NUMBER:\t\t" + acc + "\nCONFORMED SUBMISSION TYPE:\t13F-HR\nPUBLIC DOCUMENT COUNT:\t\t2\n"
+           "CONFORMED PERIOD OF REPORT:\t" + period + "\nFILED AS OF DATE:\t\t" + filed +
+           "\n\nFILER:\n\n\tCOMPANY DATA:\t\n\t\tCOMPANY CONFORMED NAME:\t\t\t" + f.name() +
+           "\n\t\tCENTRAL INDEX KEY:\t\t\t" + acc.substr(0, 10) + "\n</SEC-HEADER>\n"
+           "<DOCUMENT>\n<TYPE>13F-HR\n<SEQUENCE>1\n<FILENAME>primary_doc.xml\n<TEXT>\n<XML>\n" + coverPage(f) +
+           "</XML>\n</TEXT>\n</DOCUMENT>\n"
+           "<DOCUMENT>\n<TYPE>INFORMATION TABLE\n<SEQUENCE>2\n<FILENAME>infotable.xml\n<TEXT>\n<XML>\n" +
+           infoTable(f) + "</XML>\n</TEXT>\n</DOCUMENT>\n</SEC-DOCUMENT>\n";
+}
+
+bool synthesize(string_view path, string& body, string& contentType) {
+    if (!options.synthetic) return false;
+
+    // /Archives/edgar/full-index/YYYY/QTRn/master.idx
+    int year = 0, quarter = 0;
+    char tail[16] = {};
+    if (sscanf(string(path).c_str(), "/Archives/edgar/full-index/%4d/QTR%1d/%15s", &year, &quarter, tail) == 3) {
+        if (strcmp(tail, "master.idx") != 0 || quarter < 1 || quarter > 4) return false;
+        body = masterIndex(year, quarter);
+        contentType = "text/plain";
+        return true;
+    }
+
+    SyntheticFiling f;
+    string_view rest;
+    if (!parseFolderPath(path, f, rest)) return false;
+    string acc = f.accession();
+    contentType = "text/xml";
+    if (rest.empty() || rest == "index.html") {
+        body = folderListing(f.folder(), {acc + "-index.htm", acc + ".txt", "infotable.xml", "primary_doc.xml"});
+        contentType = "text/html";
+    } else if (rest == acc + "-index.htm") {
+        body = filingIndexPage(f);
+        contentType = "text/html";
+    } else if (rest == "primary_doc.xml") {
+        body = coverPage(f);
+    } else if (rest == "infotable.xml") {
+        body = infoTable(f);
+    } else if (rest == acc + ".txt") {
+        body = fullSubmission(f);
+        contentType = "text/plain";
+    } else {
+        return false;
+    }
+    return true;
+}
+
+// ---- Recorded files ----
+
+string contentTypeFor(const fs::path& path) {
+    string ext = path.extension().string();
+    if (ext == ".xml") return "text/xml";
+    if (ext == ".htm" || ext == ".html") return "text/html";
+    return "text/plain";
+}
+
+bool serveFile(string_view urlPath, string& body, string& contentType) {
+    if (options.root.empty() || urlPath.find("..") != string_view::npos) return false;
+    fs::path path = fs::path(options.root) / fs::path(string(urlPath.substr(1)));
+    error_code ec;
+    if (fs::is_directory(path, ec)) {
+        if (fs::is_regular_file(path / "index.html", ec)) {
+            path /= "index.html";
+        } else {
+            string dir(urlPath);
+            if (dir.back() != '/') dir += '/';
+            vector<string> files;
+            for (const auto& entry : fs::directory_iterator(path, ec)) files.push_back(entry.path().filename().string());
+            sort(files.begin(), files.end());
+            body = folderListing(dir, files);
+            contentType = "text/html";
+            return true;
+        }
+    }
+    ifstream in(path, ios::binary);
+    if (!in) return false;
+    ostringstream ss;
+    ss << in.rdbuf();
+    body = ss.str();
+    contentType = contentTypeFor(path);
+    return true;
+}
+
+// ---- HTTP ----
+
+bool respond(int fd, int status, const char* reason, const string& contentType, const string& body, bool head,
+             bool keepAlive, const string& extraHeaders = "") {
+    string header = "HTTP/1.1 " + to_string(status) + " " + reason + "\r\nContent-Type: " + contentType +
+                    "\r\nContent-Length: " + to_string(body.size()) + "\r\n" + extraHeaders +
+                    (keepAlive ? "Connection: keep-alive\r\n\r\n" : "Connection: close\r\n\r\n");
+    if (!sendAll(fd, header.data(), header.size())) return false;
+    if (head) return true;
+    if (status == 200 && options.dropRate > 0 && uniform() < options.dropRate) {
+        ++stats.dropped;
+        sendBody(fd, body, body.size() / 2);
+        return false;
+    }
+    return sendBody(fd, body, body.size());
+}
+
+bool handleRequest(int fd, const string& request) {
+    ++stats.requests;
+    istringstream in(request);
+    string method, target, version;
+    in >> method >> target >> version;
+    bool keepAlive = version == "HTTP/1.1";
+    for (string line; getline(in, line);) {
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        string lc = line;
+        transform(lc.begin(), lc.end(), lc.begin(), [](unsigned char c) { return tolower(c); });
+        if (lc.rfind("connection:", 0) == 0) {
+            keepAlive = lc.find("close") == string::npos && (keepAlive || lc.find("keep-alive") != string::npos);
+        }
+    }
+
+    bool head = method == "HEAD";
+    if (method != "GET" && !head) {
+        respond(fd, 405, "Method Not Allowed", "text/plain", "", false, false);
+        return false;
+    }
+    string path = target.substr(0, target.find('?'));
+    size_t scheme = path.find("://");
+    if (scheme != string::npos) path = path.substr(min(path.size(), path.find('/', scheme + 3)));
+    if (path.empty()) path = "/";
+
+    injectLatency();
+
+    if (options.errorRate > 0 && uniform() < options.errorRate) {
+        ++stats.throttled;
+        bool tooMany = uniform() < 0.5;
+        return respond(fd, tooMany ? 429 : 503, tooMany ? "Too Many Requests" : "Service Unavailable", "text/html",
+                       "<html><body>Request Rate Threshold Exceeded</body></html>\n", head, keepAlive,
+                       "Retry-After: " + to_string(options.retryAfter) + "\r\n");
+    }
+
+    string body, contentType;
+    if (serveFile(path, body, contentType) || synthesize(path, body, contentType)) {
+        ++stats.ok;
+        return respond(fd, 200, "OK", contentType, body, head, keepAlive) && keepAlive;
+    }
+    ++stats.notFound;
+    return respond(fd, 404, "Not Found", "text/html", "<html><body>Not Found</body></html>\n", head, keepAlive) &&
+           keepAlive;
+}
+
+void serveConnection(int fd) {
+    ++stats.connections;
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    string buffer;
+    char chunk[8192];
+    for (;;) {
+        size_t end = buffer.find("\r\n\r\n");
+        if (end == string::npos) {
+            if (buffer.size() > 64 * 1024) break;
+            ssize_t n = recv(fd, chunk, sizeof(chunk), 0);
+            if (n <= 0) break;
+            buffer.append(chunk, static_cast<size_t>(n));
+            continue;
+        }
+        string request = buffer.substr(0, end);
+        buffer.erase(0, end + 4);
+        if (!handleRequest(fd, request)) break;
+    }
+    close(fd);
+}
+
+void reportStats() {
+    auto start = chrono::steady_clock::now();
+    for (;;) {
+        this_thread::sleep_for(chrono::seconds(options.statsInterval));
+        double secs = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        char line[256];
+        snprintf(line, sizeof(line),
+                 "%.0fs: %llu connections, %llu requests (%.1f/s), %llu ok, %llu 404, %llu throttled, %llu dropped, %.1f MB",
+                 secs, static_cast<unsigned long long>(stats.connections.load()),
+                 static_cast<unsigned long long>(stats.requests.load()), stats.requests.load() / secs,
+                 static_cast<unsigned long long>(stats.ok.load()), static_cast<unsigned long long>(stats.notFound.load()),
+                 static_cast<unsigned long long>(stats.throttled.load()),
+                 static_cast<unsigned long long>(stats.dropped.load()), stats.bytes.load() / (1024.0 * 1024.0));
+        cerr << line << endl;
+    }
+}
+
+void usage() {
+    cerr << "Usage: mock_edgar_server [--port N] [--bind ADDR] [--root DIR] [--synthetic N] [--rows N]\n"
+            "                         [--latency-ms N] [--jitter-ms N] [--bandwidth-kbps N]\n"
+            "                         [--error-rate P] [--retry-after SECONDS] [--drop-rate P]\n"
+            "                         [--seed N] [--stats-interval SECONDS]\n"
+            "--root serves files by URL path; --synthetic generates N 13F-HR filings per quarter\n"
+            "with about --rows holdings each (default 200). Point FinanceApp at it with\n"
+            "--base-url http://ADDR:PORT." << endl;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    for (int i = 1; i < argc; ++i) {
+        const char* arg = argv[i];
+        const char* val = (i + 1 < argc) ? argv[i + 1] : nullptr;
+        if (!val) { usage(); return 1; }
+        if (strcmp(arg, "--port") == 0) options.port = atoi(val);
+        else if (strcmp(arg, "--bind") == 0) options.bind = val;
+        else if (strcmp(arg, "--root") == 0) options.root = val;
+        else if (strcmp(arg, "--synthetic") == 0) options.synthetic = strtoul(val, nullptr, 10);
+        else if (strcmp(arg, "--rows") == 0) options.rows = strtoul(val, nullptr, 10);
+        else if (strcmp(arg, "--latency-ms") == 0) options.latencyMs = atoi(val);
+        else if (strcmp(arg, "--jitter-ms") == 0) options.jitterMs = atoi(val);
+        else if (strcmp(arg, "--bandwidth-kbps") == 0) options.bandwidthKbps = atof(val);
+        else if (strcmp(arg, "--error-rate") == 0) options.errorRate = atof(val);
+        else if (strcmp(arg, "--retry-after") == 0) options.retryAfter = atoi(val);
+        else if (strcmp(arg, "--drop-rate") == 0) options.dropRate = atof(val);
+        else if (strcmp(arg, "--seed") == 0) options.seed = static_cast<unsigned>(strtoul(val, nullptr, 10));
+        else if (strcmp(arg, "--stats-interval") == 0) options.statsInterval = atoi(val);
+        else { usage(); return 1; }
+        ++i;
+    }
+    if (options.root.empty() && !options.synthetic) {
+        usage();
+        return 1;
+    }
+    rng.seed(options.seed);
+    signal(SIGPIPE, SIG_IGN);
+
+    int listener = socket(AF_INET, SOCK_STREAM, 0);
+    int one = 1;
+    setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(static_cast<uint16_t>(options.port));
+    if (listener < 0 || inet_pton(AF_INET, options.bind.c_str(), &addr.sin_addr) != 1 ||
+        ::bind(listener, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 || listen(listener, 128) != 0) {
+        cerr << "Could not listen on " << options.bind << ":" << options.port << ": " << strerror(errno) << endl;
+        return 1;
+    }
+    cerr << "Serving on http://" << options.bind << ":" << options.port << endl;
+
+    if (options.statsInterval > 0) thread(reportStats).detach();
+    for (;;) {
+        int fd = accept(listener, nullptr, nullptr);
+        if (fd < 0) {
+            if (errno == EINTR) continue;
+            cerr << "accept failed: " << strerror(errno) << endl;
+            break;
+        }
+        thread(serveConnection, fd).detach();
+    }
+    close(listener);
+    return 1;
+}
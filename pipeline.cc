@@ -0,0 +1,215 @@
+#include "pipeline.h"
+#include "sec_parser.h"
+#include "http_client.h"
+#include "holdings_writer.h"
+#include "holder_index.h"
+#include "filing_index.h"
+#include "submission_parser.h"
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <iostream>
+#include <thread>
+
+using namespace std;
+
+namespace {
+
+using Filing = FilingRef;
+
+struct XmlJob {
+    Filing filing;
+    vector<string> xmlLinks;
+    bool fromIndex = false;   // xmlLinks came from the filing index page
+    SubmissionHeader cover;   // amendments: period of report and amendment type
+};
+
+// An amendment's cover page says whether it is a RESTATEMENT and which
+// period it amends; originals are written without it to save a request
+SubmissionHeader amendmentCover(const Filing& filing, const string& url) {
+    SubmissionHeader cover;
+    if (!filing.isAmendment()) return cover;
+    string xml = fetchURL(url.empty() ? filing.folderUrl + "primary_doc.xml" : url);
+    parseCoverPage(xml, cover);
+    if (cover.amendmentType.empty()) {
+        cerr << "No amendment type on the cover page of " << filing.accession
+             << "; rows it no longer lists are kept" << endl;
+    }
+    return cover;
+}
+
+// Consolidated here, on the worker, so the writer thread only inserts
+FilingRecord recordFor(const Filing& filing, vector<Holding>&& holdings, bool keepLines,
+                       const SubmissionHeader& cover = SubmissionHeader()) {
+    FilingRecord record;
+    record.firmName = filing.name;
+    record.quarter = filing.quarter;
+    record.filingDate = filing.filingDate;
+    record.holdings = std::move(holdings);
+    record.amendment = filing.isAmendment();
+    record.accession = filing.accession;
+    record.cik = filing.cik;
+    record.formType = filing.formType;
+    record.periodOfReport = cover.periodOfReport;
+    record.amendmentType = cover.amendmentType;
+    record.consolidate(keepLines);
+    return record;
+}
+
+// The old heuristic: every .xml in the folder listing. primary_doc.xml is the
+// cover page, never the table, so it is tried last.
+bool folderCandidates(const Filing& filing, vector<string>& links) {
+    string html = fetchURL(filing.folderUrl);
+    if (html.empty()) return false;
+    links = extractXmlLinks(html, filing.folderUrl);
+    stable_partition(links.begin(), links.end(), [](const string& url) {
+        return url.size() < 15 || url.compare(url.size() - 15, 15, "primary_doc.xml") != 0;
+    });
+    return true;
+}
+
+// Starts `workers` threads that drain `in` through `fn`. The last worker to
+// finish closes `out` so the next stage sees end of input.
+template <typename In, typename Out>
+vector<thread> startStage(size_t workers, BoundedQueue<In>& in, BoundedQueue<Out>& out,
+                          function<void(In&, BoundedQueue<Out>&)> fn) {
+    if (workers == 0) workers = 1;
+    auto remaining = make_shared<atomic<size_t>>(workers);
+    vector<thread> threads;
+    for (size_t i = 0; i < workers; ++i) {
+        threads.emplace_back([&in, &out, fn, remaining] {
+            while (auto item = in.pop()) {
+                fn(*item, out);
+            }
+            if (--*remaining == 0) out.close();
+        });
+    }
+    return threads;
+}
+
+} // namespace
+
+PipelineStats runPipeline(const vector<Filing>& filings, sqlite3* db, const PipelineConfig& config,
+                          HolderIndex* holderIndex) {
+    PipelineStats stats;
+    stats.filings = filings.size();
+    atomic<size_t> failed{0};
+
+    // Every fetchURL call from every worker draws from this one bucket
+    httpClient().rateLimiter().configure(config.requestsPerSecond, config.burst);
+
+    BoundedQueue<Filing> folderQueue(config.queueCapacity);
+    BoundedQueue<XmlJob> xmlQueue(config.queueCapacity);
+
+    // DB write stage runs on the writer's own thread
+    HoldingsWriter writer(db, config.filingsPerTransaction);
+    if (holderIndex) {
+        writer.onFilingWritten([holderIndex](int64_t filingId, const FilingRecord& filing) {
+            holderIndex->addFiling(filingId, filing.cik, filing.firmName, filing.quarter, filing.holdings,
+                                   filing.amendment, filing.isRestatement());
+        });
+        writer.onCommit([holderIndex](int64_t before, int64_t after) { holderIndex->advance(before, after); });
+    }
+    writer.start(config.queueCapacity);
+
+    // Index stage
+    thread indexThread([&] {
+        for (const auto& filing : filings) {
+            if (!folderQueue.push(filing)) break;
+        }
+        folderQueue.close();
+    });
+
+    // Resolve stage: the filing index page names the INFORMATION TABLE
+    // document, so one request finds it; the folder listing is the fallback.
+    // In full-submission mode this stage does all the fetching and parsing.
+    size_t resolveWorkers = config.fullSubmission ? config.xmlWorkers : config.folderWorkers;
+    auto folderThreads = startStage<Filing, XmlJob>(resolveWorkers, folderQueue, xmlQueue,
+        [&](Filing& filing, BoundedQueue<XmlJob>& out) {
+            if (config.fullSubmission) {
+                SubmissionHeader header;
+                vector<Holding> holdings;
+                string url = submissionUrl(filing);
+                if (!fetchSubmission(url, header, holdings)) {
+                    cerr << "No information table in submission: " << url << endl;
+                    ++failed;
+                    writer.submit(LedgerUpdate{filing.accession, IngestState::Failed, "no information table in submission"});
+                    return;
+                }
+                cout << filing.name << ": " << url << endl;
+                writer.submit(LedgerUpdate{filing.accession, IngestState::Parsed, ""});
+                FilingRecord record = recordFor(filing, std::move(holdings), config.keepLineDetail);
+                if (!header.formType.empty()) record.formType = header.formType;
+                record.periodOfReport = header.periodOfReport;
+                record.amendmentType = header.amendmentType;
+                writer.submit(std::move(record));
+                return;
+            }
+
+            string indexUrl = filingIndexUrl(filing);
+            vector<FilingDocument> documents;
+            if (!indexUrl.empty()) documents = parseFilingIndex(fetchURL(indexUrl), filing.folderUrl);
+            string url = infoTableUrl(documents);
+            SubmissionHeader cover = amendmentCover(filing, coverPageUrl(documents));
+            if (!url.empty()) {
+                writer.submit(LedgerUpdate{filing.accession, IngestState::Fetched, ""});
+                out.push(XmlJob{std::move(filing), {std::move(url)}, true, std::move(cover)});
+                return;
+            }
+
+            vector<string> links;
+            if (!folderCandidates(filing, links)) {
+                cerr << "Failed to fetch folder HTML: " << filing.folderUrl << endl;
+                ++failed;
+                writer.submit(LedgerUpdate{filing.accession, IngestState::Failed, "folder fetch failed"});
+                return;
+            }
+            writer.submit(LedgerUpdate{filing.accession, IngestState::Fetched, ""});
+            out.push(XmlJob{std::move(filing), std::move(links), false, std::move(cover)});
+        });
+
+    // XML fetch stage: each candidate is parsed while it downloads
+    vector<thread> xmlThreads;
+    size_t xmlWorkers = config.xmlWorkers ? config.xmlWorkers : 1;
+    for (size_t i = 0; i < xmlWorkers; ++i) {
+        xmlThreads.emplace_back([&] {
+            while (auto job = xmlQueue.pop()) {
+                const Filing& filing = job->filing;
+                vector<Holding> holdings;
+                auto tryLinks = [&](const vector<string>& links, const vector<string>& skip) {
+                    for (const auto& url : links) {
+                        if (find(skip.begin(), skip.end(), url) != skip.end()) continue;
+                        if (fetchInfoTable(url, holdings)) {
+                            cout << filing.name << ": " << url << endl;
+                            writer.submit(LedgerUpdate{filing.accession, IngestState::Parsed, ""});
+                            writer.submit(recordFor(filing, std::move(holdings), config.keepLineDetail, job->cover));
+                            return true;
+                        }
+                    }
+                    return false;
+                };
+                bool found = tryLinks(job->xmlLinks, {});
+                vector<string> links;
+                if (!found && job->fromIndex && folderCandidates(filing, links)) {
+                    found = tryLinks(links, job->xmlLinks);
+                }
+                if (!found) {
+                    cerr << "No valid XML found for: " << filing.folderUrl << endl;
+                    ++failed;
+                    writer.submit(LedgerUpdate{filing.accession, IngestState::Failed, "no information table found"});
+                }
+            }
+        });
+    }
+
+    indexThread.join();
+    for (auto* group : {&folderThreads, &xmlThreads}) {
+        for (auto& t : *group) t.join();
+    }
+    writer.finish();
+
+    stats.written = writer.filingsWritten();
+    stats.failed = failed + writer.failures();
+    return stats;
+}
@@ -0,0 +1,39 @@
+// pipeline.h
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <sqlite3.h>
+#include "bounded_queue.h"
+#include "idx_scanner.h"
+
+class HolderIndex;
+
+struct PipelineConfig {
+    size_t folderWorkers = 2;   // fetch folder HTML and extract XML links
+    size_t xmlWorkers = 4;      // stream XML candidates through the parser until an infoTable is found
+    size_t queueCapacity = 64;  // max items waiting between two stages
+    double requestsPerSecond = 10.0; // SEC fair-access limit, shared by all workers
+    double burst = 10.0;             // requests allowed back to back after an idle spell
+    size_t filingsPerTransaction = 64; // filings committed together by the DB writer
+    bool fullSubmission = false;       // one <accession>.txt request per filing instead of index page + XML
+    bool keepLineDetail = false;       // also store each infoTable row in holdings_detail
+};
+
+struct PipelineStats {
+    size_t filings = 0;
+    size_t written = 0;
+    size_t failed = 0;
+};
+
+// Runs index -> folder fetch -> XML fetch+parse -> DB write with bounded
+// queues between the stages. All DB writes go through one HoldingsWriter
+// thread, which owns the connection until the pipeline returns and also
+// records each accession's progress in the ingest ledger. If
+// `holderIndex` is given, every stored filing is also added to it.
+PipelineStats runPipeline(const std::vector<FilingRef>& filings,
+                          sqlite3* db,
+                          const PipelineConfig& config,
+                          HolderIndex* holderIndex = nullptr);
@@ -0,0 +1,172 @@
+// Runs the whole fetch pipeline against mock_edgar_server serving
+// fixtures/edgar and checks what FinanceApp stored. The 2025Q3 master.idx
+// there lists two 13F-HR filings and an amendment of the first one, which
+// replaces its rows; the Form 4 line is not ingested. The run asks for
+// 2025Q1-2025Q3, so the master indexes are downloaded together over
+// HttpClient::fetchMany: 2025Q2 lists no 13F filings and 2025Q1 is missing,
+// which must not stop the other quarters.
+//
+// A second run must find everything committed in the ingest ledger and
+// change nothing.
+// Usage: pipeline_test <FinanceApp> <mock_edgar_server> <fixtures/edgar>
+
+#include "test_util.h"
+#include <chrono>
+#include <csignal>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sqlite3.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace std;
+namespace fs = std::filesystem;
+
+namespace {
+
+// A loopback port nobody listens on right now
+int freePort() {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) return -1;
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t len = sizeof(addr);
+    int port = -1;
+    if (bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0 &&
+        getsockname(fd, reinterpret_cast<sockaddr*>(&addr), &len) == 0) {
+        port = ntohs(addr.sin_port);
+    }
+    close(fd);
+    return port;
+}
+
+bool accepting(int port) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) return false;
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(static_cast<uint16_t>(port));
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    bool ok = connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0;
+    close(fd);
+    return ok;
+}
+
+// mock_edgar_server as a child process, stopped by the destructor
+class MockServer {
+public:
+    bool start(const string& program, const string& root, int port) {
+        string portArg = to_string(port);
+        pid_ = fork();
+        if (pid_ < 0) return false;
+        if (pid_ == 0) {
+            execl(program.c_str(), program.c_str(), "--port", portArg.c_str(), "--root", root.c_str(),
+                  "--stats-interval", "0", static_cast<char*>(nullptr));
+            cerr << "Could not run " << program << ": " << strerror(errno) << endl;
+            _exit(127);
+        }
+        for (int i = 0; i < 100; ++i) {
+            if (accepting(port)) return true;
+            if (waitpid(pid_, nullptr, WNOHANG) == pid_) {
+                pid_ = -1;
+                return false;
+            }
+            this_thread::sleep_for(chrono::milliseconds(50));
+        }
+        return false;
+    }
+
+    ~MockServer() {
+        if (pid_ <= 0) return;
+        kill(pid_, SIGTERM);
+        waitpid(pid_, nullptr, 0);
+    }
+
+private:
+    pid_t pid_ = -1;
+};
+
+void expectFiling(sqlite3* db, const string& accession, long long rows, long long shares, long long value) {
+    string filing = "(SELECT id FROM filings WHERE accession = '" + accession + "')";
+    expectEqual(queryInt(db, "SELECT COUNT(*) FROM holdings WHERE filing_id = " + filing), rows,
+                accession + " rows");
+    expectEqual(queryInt(db, "SELECT SUM(shares) FROM holdings WHERE filing_id = " + filing), shares,
+                accession + " sum(shares)");
+    expectEqual(queryInt(db, "SELECT SUM(value) FROM holdings WHERE filing_id = " + filing), value,
+                accession + " sum(value)");
+}
+
+void expectStored(sqlite3* db, const string& when) {
+    expectEqual(queryInt(db, "SELECT COUNT(*) FROM filings"), 2, "filings " + when);
+    expectEqual(queryInt(db, "SELECT COUNT(*) FROM holdings"), 7, "holdings rows " + when);
+    expectEqual(queryInt(db, "SELECT SUM(shares) FROM holdings"), 19698906, "sum(shares) " + when);
+    expectEqual(queryInt(db, "SELECT SUM(value) FROM holdings"), 13601179042, "sum(value) " + when);
+    expectEqual(queryInt(db, "SELECT COUNT(*) FROM ingest_ledger WHERE state = 'committed'"), 3,
+                "committed accessions " + when);
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    if (argc < 4) {
+        cerr << "Usage: pipeline_test <FinanceApp> <mock_edgar_server> <fixtures/edgar>" << endl;
+        return 2;
+    }
+    string app = fs::absolute(argv[1]).string();
+    string server = fs::absolute(argv[2]).string();
+    string root = fs::absolute(argv[3]).string();
+
+    int port = freePort();
+    MockServer mock;
+    if (port < 0 || !mock.start(server, root, port)) {
+        cerr << "FAILED: mock_edgar_server did not start" << endl;
+        return 1;
+    }
+
+    ScratchDir dir("pipeline_test");
+    string args = "--base-url http://127.0.0.1:" + to_string(port) +
+                  " --quarters 2025Q1-2025Q3 --idx-dir idx --no-cache";
+    if (!runIn(dir.path, app, args)) {
+        cerr << "FAILED: pipeline run" << endl;
+        return 1;
+    }
+
+    sqlite3* db;
+    if (sqlite3_open_v2((dir.path / "holdings.db").string().c_str(), &db, SQLITE_OPEN_READONLY, nullptr) !=
+        SQLITE_OK) {
+        cerr << "Can't open database: " << sqlite3_errmsg(db) << endl;
+        sqlite3_close(db);
+        return 1;
+    }
+
+    expectEqual(fs::exists(dir.path / "idx" / "master2025Q1.idx"), false, "2025Q1 index written");
+    expectEqual(fs::exists(dir.path / "idx" / "master2025Q2.idx"), true, "2025Q2 index written");
+    expectEqual(fs::exists(dir.path / "idx" / "master2025Q3.idx"), true, "2025Q3 index written");
+    expectStored(db, "after the first run");
+    // The amendment's rows under the original's accession and form type
+    expectFiling(db, "0001100001-25-000101", 3, 5983552, 4652003456);
+    expectFiling(db, "0001100002-25-000007", 4, 13715354, 8949175586);
+    expectEqual(queryInt(db, "SELECT COUNT(*) FROM filings WHERE form_type = '13F-HR'"), 2, "original form types");
+
+    if (!runIn(dir.path, app, args)) {
+        cerr << "FAILED: second pipeline run" << endl;
+        sqlite3_close(db);
+        return 1;
+    }
+    expectStored(db, "after the second run");
+
+    sqlite3_close(db);
+    if (testFailures) {
+        cerr << testFailures << " check(s) failed" << endl;
+        return 1;
+    }
+    cout << "pipeline_test passed" << endl;
+    return 0;
+}
@@ -0,0 +1,104 @@
+#include "portfolio_diff.h"
+#include <algorithm>
+
+using namespace std;
+
+namespace {
+
+// Cursor over the rows of one partition, restricted to [pos, end)
+struct Cursor {
+    const QuarterPartition* p;
+    size_t pos;
+    size_t end;
+
+    bool done() const { return pos >= end; }
+    int32_t firm() const { return p->firm[pos]; }
+    int32_t security() const { return p->security[pos]; }
+
+    // Sums the run of rows sharing the current key and steps past it
+    void take(int64_t& shares, int64_t& value) {
+        int32_t f = firm(), s = security();
+        shares = value = 0;
+        while (pos < end && p->firm[pos] == f && p->security[pos] == s) {
+            shares += p->shares[pos];
+            value += p->value[pos];
+            ++pos;
+        }
+    }
+};
+
+Cursor cursorFor(const QuarterPartition* p, int32_t firm) {
+    if (!p) return Cursor{nullptr, 0, 0};
+    if (firm < 0) return Cursor{p, 0, p->size()};
+    auto lo = lower_bound(p->firm.begin(), p->firm.end(), firm);
+    auto hi = upper_bound(lo, p->firm.end(), firm);
+    return Cursor{p, static_cast<size_t>(lo - p->firm.begin()), static_cast<size_t>(hi - p->firm.begin())};
+}
+
+} // namespace
+
+const char* changeKindName(ChangeKind kind) {
+    switch (kind) {
+    case ChangeKind::New:       return "NEW";
+    case ChangeKind::Exit:      return "EXIT";
+    case ChangeKind::Increase:  return "INCREASE";
+    case ChangeKind::Decrease:  return "DECREASE";
+    case ChangeKind::Unchanged: return "UNCHANGED";
+    }
+    return "";
+}
+
+vector<PositionChange> diffQuarters(ColumnarStore& store, const string& fromQuarter, const string& toQuarter,
+                                    int32_t firm, bool includeUnchanged, DiffSummary* summary) {
+    store.sortPartitions();
+    Cursor a = cursorFor(store.partition(fromQuarter), firm);
+    Cursor b = cursorFor(store.partition(toQuarter), firm);
+
+    DiffSummary counts;
+    vector<PositionChange> changes;
+
+    while (!a.done() || !b.done()) {
+        PositionChange c{};
+        int order;
+        if (a.done()) order = 1;
+        else if (b.done()) order = -1;
+        else if (a.firm() != b.firm()) order = a.firm() < b.firm() ? -1 : 1;
+        else order = a.security() == b.security() ? 0 : (a.security() < b.security() ? -1 : 1);
+
+        if (order < 0) {
+            c.firm = a.firm();
+            c.security = a.security();
+            a.take(c.sharesBefore, c.valueBefore);
+            c.kind = ChangeKind::Exit;
+            ++counts.exits;
+        } else if (order > 0) {
+            c.firm = b.firm();
+            c.security = b.security();
+            b.take(c.sharesAfter, c.valueAfter);
+            c.kind = ChangeKind::New;
+            ++counts.newPositions;
+        } else {
+            c.firm = a.firm();
+            c.security = a.security();
+            a.take(c.sharesBefore, c.valueBefore);
+            b.take(c.sharesAfter, c.valueAfter);
+            int64_t delta = c.sharesAfter != c.sharesBefore ? c.sharesAfter - c.sharesBefore
+                                                            : c.valueAfter - c.valueBefore;
+            if (delta > 0) {
+                c.kind = ChangeKind::Increase;
+                ++counts.increases;
+            } else if (delta < 0) {
+                c.kind = ChangeKind::Decrease;
+                ++counts.decreases;
+            } else {
+                c.kind = ChangeKind::Unchanged;
+                ++counts.unchanged;
+                if (!includeUnchanged) continue;
+            }
+        }
+        changes.push_back(c);
+    }
+
+    if (summary) *summary = counts;
+    return changes;
+}
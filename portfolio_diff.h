@@ -0,0 +1,47 @@
+// portfolio_diff.h
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "columnar_store.h"
+
+enum class ChangeKind { New, Exit, Increase, Decrease, Unchanged };
+
+const char* changeKindName(ChangeKind kind);
+
+// One (firm, security) position compared across two quarters. Codes refer to
+// the ColumnarStore the diff was computed from.
+struct PositionChange {
+    int32_t firm;
+    int32_t security;
+    ChangeKind kind;
+    int64_t sharesBefore = 0;
+    int64_t sharesAfter = 0;
+    int64_t valueBefore = 0;
+    int64_t valueAfter = 0;
+};
+
+struct DiffSummary {
+    size_t newPositions = 0;
+    size_t exits = 0;
+    size_t increases = 0;
+    size_t decreases = 0;
+    size_t unchanged = 0;
+};
+
+// Quarter-over-quarter portfolio diff.
+//
+// Both quarter partitions are sorted by (firm, security), so the diff is a
+// single merge-join pass over the two. Only share positions are compared;
+// the store leaves puts and calls out. Increase/decrease is decided on
+// shares, falling back to value when share counts match. Pass firm = -1 to
+// diff every firm present in either quarter.
+std::vector<PositionChange> diffQuarters(ColumnarStore& store,
+                                         const std::string& fromQuarter,
+                                         const std::string& toQuarter,
+                                         int32_t firm = -1,
+                                         bool includeUnchanged = false,
+                                         DiffSummary* summary = nullptr);
@@ -0,0 +1,124 @@
+// ColumnarStore and diffQuarters on filings that hold options next to
+// shares of the same CUSIP: buying puts on a stock the firm keeps is no
+// share increase, closing a call no decrease, and the store's issuer totals
+// agree with issuer_quarter_stats.
+// Usage: portfolio_diff_test
+
+#include "columnar_store.h"
+#include "portfolio_diff.h"
+#include "schema.h"
+#include "sec_parser.h"
+#include "test_util.h"
+#include <iostream>
+#include <string>
+#include <vector>
+#include <sqlite3.h>
+
+using namespace std;
+
+namespace {
+
+const string kApple = "037833100";
+const string kMicrosoft = "594918104";
+
+Holding row(const string& cusip, const string& putCall, long long shares, long long value) {
+    Holding h;
+    h.cusip = cusip;
+    h.nameOfIssuer = "ISSUER " + cusip;
+    h.titleOfClass = putCall.empty() ? "COM" : putCall;
+    h.shares = shares;
+    h.value = value;
+    h.putCall = putCall;
+    h.sharesType = "SH";
+    h.investmentDiscretion = "SOLE";
+    return h;
+}
+
+const PositionChange* changeFor(const ColumnarStore& store, const vector<PositionChange>& changes,
+                                const string& cusip) {
+    int32_t security = store.cusips().find(cusip);
+    for (const auto& c : changes) {
+        if (c.security == security) return &c;
+    }
+    return nullptr;
+}
+
+void expectChange(const ColumnarStore& store, const vector<PositionChange>& changes, const string& cusip,
+                  ChangeKind kind, int64_t sharesBefore, int64_t sharesAfter) {
+    const PositionChange* c = changeFor(store, changes, cusip);
+    if (!c) {
+        expectEqual(string("no change"), string(changeKindName(kind)), cusip + " change");
+        return;
+    }
+    expectEqual(string(changeKindName(c->kind)), string(changeKindName(kind)), cusip + " change");
+    expectEqual(c->sharesBefore, sharesBefore, cusip + " shares before");
+    expectEqual(c->sharesAfter, sharesAfter, cusip + " shares after");
+}
+
+} // namespace
+
+int main() {
+    sqlite3* db;
+    if (sqlite3_open(":memory:", &db) != SQLITE_OK || !migrateSchema(db)) {
+        cerr << "Can't open database: " << sqlite3_errmsg(db) << endl;
+        sqlite3_close(db);
+        return 1;
+    }
+
+    // Q2: shares and a call on Apple. Q3: the same shares, the call closed
+    // and puts bought; more Microsoft shares.
+    write13F(db, "TEST CAPITAL LLC", "2025Q2", "2025-05-15",
+             {row(kApple, "", 1000, 190000), row(kApple, "Call", 300, 57000), row(kMicrosoft, "", 50, 20000)});
+    write13F(db, "TEST CAPITAL LLC", "2025Q3", "2025-08-14",
+             {row(kApple, "", 1000, 190000), row(kApple, "Put", 500, 100000), row(kMicrosoft, "", 80, 32000)});
+
+    ColumnarStore store;
+    if (!store.load(db)) {
+        sqlite3_close(db);
+        return 1;
+    }
+    expectEqual(store.rows(), 4u, "share positions loaded");
+
+    DiffSummary summary;
+    auto changes = diffQuarters(store, "2025Q2", "2025Q3", -1, true, &summary);
+    expectEqual(changes.size(), 2u, "positions compared");
+    expectChange(store, changes, kApple, ChangeKind::Unchanged, 1000, 1000);
+    expectChange(store, changes, kMicrosoft, ChangeKind::Increase, 50, 80);
+    expectEqual(summary.increases, 1u, "increases");
+    expectEqual(summary.decreases, 0u, "decreases");
+    expectEqual(summary.unchanged, 1u, "unchanged");
+    expectEqual(summary.newPositions, 0u, "new positions");
+    expectEqual(summary.exits, 0u, "exits");
+
+    // Issuer totals match the stats table the writer keeps
+    auto issuers = store.totalsByIssuer("2025Q3");
+    expectEqual(issuers.size(), 2u, "issuers");
+    for (const string& cusip : {kApple, kMicrosoft}) {
+        int32_t issuer = store.issuers().find("ISSUER " + cusip);
+        int64_t shares = -1, value = -1;
+        for (const auto& a : issuers) {
+            if (a.key == issuer) shares = a.shares, value = a.value;
+        }
+        string where = " FROM issuer_quarter_stats i JOIN securities s ON i.security_id = s.id "
+                       "WHERE i.quarter = '2025Q3' AND s.cusip = '" + cusip + "'";
+        expectEqual(shares, queryInt(db, "SELECT total_shares" + where), cusip + " issuer shares");
+        expectEqual(value, queryInt(db, "SELECT total_value" + where), cusip + " issuer value");
+    }
+
+    // Filings appended from the ingest path drop their options too
+    store.addFiling(0, "OTHER PARTNERS LP", "2025Q3", 99,
+                   {row(kApple, "", 10, 2000), row(kApple, "Put", 20, 4000)});
+    auto holders = store.topHolders(kApple, "2025Q3");
+    int64_t shares = 0;
+    for (const auto& h : holders) shares += h.shares;
+    expectEqual(holders.size(), 2u, "Apple holders");
+    expectEqual(shares, 1010, "Apple shares held");
+
+    sqlite3_close(db);
+    if (testFailures) {
+        cerr << testFailures << " check(s) failed" << endl;
+        return 1;
+    }
+    cout << "portfolio_diff_test passed" << endl;
+    return 0;
+}
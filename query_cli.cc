@@ -0,0 +1,188 @@
+#include "query_cli.h"
+#include "columnar_store.h"
+#include "portfolio_diff.h"
+#include "holder_index.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+using namespace std;
+
+namespace {
+
+void usage() {
+    cerr << "Usage: FinanceApp query firm-totals [QUARTER] [LIMIT]\n"
+            "       FinanceApp query issuer-totals [QUARTER] [LIMIT]\n"
+            "       FinanceApp query top-holders CUSIP [QUARTER] [LIMIT]\n"
+            "       FinanceApp query diff FROM_QUARTER TO_QUARTER [FIRM_NAME | CIK]\n"
+            "       FinanceApp query stats [QUARTER] [LIMIT]\n"
+            "       FinanceApp query holders CUSIP [QUARTER] [LIMIT]\n"
+            "       FinanceApp query common-holders CUSIP CUSIP [QUARTER]\n"
+            "       FinanceApp query co-holdings CUSIP [QUARTER] [LIMIT]\n"
+            "QUARTER is e.g. 2025Q2, or 'all'" << endl;
+}
+
+string quarterArg(int argc, char* argv[], int i) {
+    if (i >= argc || strcmp(argv[i], "all") == 0) return "";
+    return argv[i];
+}
+
+size_t limitArg(int argc, char* argv[], int i) {
+    return i < argc ? strtoul(argv[i], nullptr, 10) : 20;
+}
+
+// names is the store's FirmDictionary or StringDictionary the keys are codes in
+template <typename Names>
+void printAggregates(const vector<ColumnarStore::Aggregate>& rows, const Names& names, size_t limit) {
+    size_t n = 0;
+    for (const auto& r : rows) {
+        if (limit && n++ >= limit) break;
+        cout << names.at(r.key) << " | value " << r.value << " | shares " << r.shares
+             << " | positions " << r.positions << endl;
+    }
+}
+
+// Dashboard totals, read straight from the materialized stats tables
+int runStatsCommand(sqlite3* db, int argc, char* argv[]) {
+    auto start = chrono::steady_clock::now();
+    string quarter = quarterArg(argc, argv, 1);
+    size_t limit = limitArg(argc, argv, 2);
+
+    sqlite3_stmt* stmt;
+    const char* quarterSql = quarter.empty()
+        ? "SELECT quarter, num_filings, total_value, total_shares, num_holdings FROM quarter_stats ORDER BY quarter;"
+        : "SELECT quarter, num_filings, total_value, total_shares, num_holdings FROM quarter_stats WHERE quarter = ?;";
+    if (sqlite3_prepare_v2(db, quarterSql, -1, &stmt, nullptr) != SQLITE_OK) {
+        cerr << "SQL error: " << sqlite3_errmsg(db) << endl;
+        return 1;
+    }
+    if (!quarter.empty()) sqlite3_bind_text(stmt, 1, quarter.c_str(), -1, SQLITE_TRANSIENT);
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        cout << sqlite3_column_text(stmt, 0) << " | filings " << sqlite3_column_int64(stmt, 1)
+             << " | value " << sqlite3_column_int64(stmt, 2) << " | shares " << sqlite3_column_int64(stmt, 3)
+             << " | holdings " << sqlite3_column_int64(stmt, 4) << endl;
+    }
+    sqlite3_finalize(stmt);
+
+    if (!quarter.empty()) {
+        const char* firmSql =
+            "SELECT firm_name, total_value, total_shares, num_holdings FROM quarter_firm_stats "
+            "WHERE quarter = ? ORDER BY total_value DESC LIMIT ?;";
+        if (sqlite3_prepare_v2(db, firmSql, -1, &stmt, nullptr) != SQLITE_OK) {
+            cerr << "SQL error: " << sqlite3_errmsg(db) << endl;
+            return 1;
+        }
+        sqlite3_bind_text(stmt, 1, quarter.c_str(), -1, SQLITE_TRANSIENT);
+        sqlite3_bind_int64(stmt, 2, limit ? static_cast<sqlite3_int64>(limit) : -1);
+        while (sqlite3_step(stmt) == SQLITE_ROW) {
+            cout << sqlite3_column_text(stmt, 0) << " | value " << sqlite3_column_int64(stmt, 1)
+                 << " | shares " << sqlite3_column_int64(stmt, 2)
+                 << " | positions " << sqlite3_column_int64(stmt, 3) << endl;
+        }
+        sqlite3_finalize(stmt);
+    }
+    auto end = chrono::steady_clock::now();
+    cerr << "Query took " << chrono::duration<double, milli>(end - start).count() << " ms" << endl;
+    return 0;
+}
+
+// Explorer queries answered from the holder index alone
+int runHolderIndexCommand(sqlite3* db, const string& command, int argc, char* argv[]) {
+    auto loadStart = chrono::steady_clock::now();
+    HolderIndex index;
+    if (!openHolderIndex(index, db, holderIndexPath(db))) return 1;
+    auto loadEnd = chrono::steady_clock::now();
+    cerr << "Loaded holder index (" << index.postings() << " postings) in "
+         << chrono::duration_cast<chrono::milliseconds>(loadEnd - loadStart).count() << " ms" << endl;
+
+    auto firmOf = [&](int64_t filingId) -> string {
+        const HolderIndex::FilingEntry* f = index.filing(filingId);
+        return f ? index.firms().at(f->firm) + " (" + index.quarters().at(f->quarter) + ")" : "?";
+    };
+
+    auto start = chrono::steady_clock::now();
+    if (command == "holders") {
+        auto postings = index.holders(argv[1], quarterArg(argc, argv, 2));
+        sort(postings.begin(), postings.end(),
+             [](const HolderPosting& a, const HolderPosting& b) { return a.value > b.value; });
+        size_t limit = limitArg(argc, argv, 3);
+        if (limit && postings.size() > limit) postings.resize(limit);
+        for (const auto& p : postings) {
+            cout << firmOf(p.filing) << " | value " << p.value << " | shares " << p.shares << endl;
+        }
+    } else if (command == "common-holders") {
+        for (int64_t filingId : index.commonHolders(argv[1], argv[2], quarterArg(argc, argv, 3))) {
+            cout << firmOf(filingId) << endl;
+        }
+    } else {
+        for (const auto& c : index.coHoldings(argv[1], quarterArg(argc, argv, 2), limitArg(argc, argv, 3))) {
+            cout << index.cusips().at(c.security) << " | holders " << c.holders << " | value " << c.value << endl;
+        }
+    }
+    auto end = chrono::steady_clock::now();
+    cerr << "Query took " << chrono::duration<double, milli>(end - start).count() << " ms" << endl;
+    return 0;
+}
+
+} // namespace
+
+int runQueryCommand(sqlite3* db, int argc, char* argv[]) {
+    if (argc < 1) {
+        usage();
+        return 1;
+    }
+    string command = argv[0];
+    if (command == "stats") return runStatsCommand(db, argc, argv);
+    if ((command == "holders" && argc >= 2) || (command == "common-holders" && argc >= 3) ||
+        (command == "co-holdings" && argc >= 2)) {
+        return runHolderIndexCommand(db, command, argc, argv);
+    }
+
+    auto loadStart = chrono::steady_clock::now();
+    ColumnarStore store;
+    if (!store.load(db)) return 1;
+    auto loadEnd = chrono::steady_clock::now();
+    cerr << "Loaded " << store.rows() << " holdings in "
+         << chrono::duration_cast<chrono::milliseconds>(loadEnd - loadStart).count() << " ms" << endl;
+
+    auto start = chrono::steady_clock::now();
+    if (command == "firm-totals") {
+        printAggregates(store.totalsByFirm(quarterArg(argc, argv, 1)), store.firms(), limitArg(argc, argv, 2));
+    } else if (command == "issuer-totals") {
+        printAggregates(store.totalsByIssuer(quarterArg(argc, argv, 1)), store.issuers(), limitArg(argc, argv, 2));
+    } else if (command == "top-holders" && argc >= 2) {
+        printAggregates(store.topHolders(argv[1], quarterArg(argc, argv, 2), limitArg(argc, argv, 3)),
+                        store.firms(), 0);
+    } else if (command == "diff" && argc >= 3) {
+        int32_t firm = -1;
+        if (argc >= 4) {
+            firm = store.firms().find(argv[3]);
+            if (firm < 0) {
+                cerr << "Unknown firm: " << argv[3] << endl;
+                return 1;
+            }
+        }
+        DiffSummary summary;
+        auto changes = diffQuarters(store, argv[1], argv[2], firm, false, &summary);
+        // Per-position detail only for a single firm; all firms gets the summary
+        if (firm >= 0) {
+            for (const auto& c : changes) {
+                cout << changeKindName(c.kind) << " | " << store.cusips().at(c.security)
+                     << " | shares " << c.sharesBefore << " -> " << c.sharesAfter
+                     << " | value " << c.valueBefore << " -> " << c.valueAfter << endl;
+            }
+        }
+        cout << "new " << summary.newPositions << ", exits " << summary.exits
+             << ", increases " << summary.increases << ", decreases " << summary.decreases
+             << ", unchanged " << summary.unchanged << endl;
+    } else {
+        usage();
+        return 1;
+    }
+    auto end = chrono::steady_clock::now();
+    cerr << "Query took " << chrono::duration<double, milli>(end - start).count() << " ms" << endl;
+    return 0;
+}
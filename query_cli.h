@@ -0,0 +1,9 @@
+// query_cli.h
+
+#pragma once
+
+#include <sqlite3.h>
+
+// Runs `FinanceApp query <command> ...` against an open holdings.db.
+// Returns the process exit code.
+int runQueryCommand(sqlite3* db, int argc, char* argv[]);
@@ -0,0 +1,88 @@
+#include "rate_limiter.h"
+#include <algorithm>
+#include <thread>
+
+using namespace std;
+
+namespace {
+
+const double kMinRate = 0.5;                 // never slow down below one request per 2 s
+const chrono::seconds kMaxPause(60);
+
+} // namespace
+
+TokenBucket::TokenBucket(double rate, double burst)
+    : rate_(rate), burst_(max(burst, 1.0)), effectiveRate_(rate), tokens_(max(burst, 1.0)),
+      last_(Clock::now()), pausedUntil_(last_) {}
+
+void TokenBucket::configure(double rate, double burst) {
+    lock_guard<mutex> lock(mutex_);
+    rate_ = rate;
+    burst_ = max(burst, 1.0);
+    effectiveRate_ = rate;
+    tokens_ = min(tokens_, burst_);
+}
+
+void TokenBucket::refill(Clock::time_point now) {
+    chrono::duration<double> elapsed = now - last_;
+    last_ = now;
+    tokens_ = min(burst_, tokens_ + elapsed.count() * effectiveRate_);
+}
+
+bool TokenBucket::tryAcquire(Clock::duration& wait) {
+    lock_guard<mutex> lock(mutex_);
+    auto now = Clock::now();
+    // rate <= 0 disables limiting
+    if (rate_ <= 0) {
+        wait = Clock::duration::zero();
+        return true;
+    }
+    if (now < pausedUntil_) {
+        last_ = now;
+        wait = pausedUntil_ - now;
+        return false;
+    }
+    refill(now);
+    if (tokens_ >= 1.0) {
+        tokens_ -= 1.0;
+        wait = Clock::duration::zero();
+        return true;
+    }
+    wait = chrono::duration_cast<Clock::duration>(chrono::duration<double>((1.0 - tokens_) / effectiveRate_));
+    return false;
+}
+
+void TokenBucket::acquire() {
+    Clock::duration wait;
+    while (!tryAcquire(wait)) {
+        this_thread::sleep_for(wait);
+    }
+}
+
+void TokenBucket::onThrottled(chrono::seconds retryAfter) {
+    lock_guard<mutex> lock(mutex_);
+    effectiveRate_ = max(kMinRate, effectiveRate_ / 2);
+    ++throttleStreak_;
+
+    chrono::seconds pause = retryAfter;
+    if (pause.count() <= 0) {
+        pause = chrono::seconds(1LL << min(throttleStreak_ - 1, 6));
+    }
+    pause = min(pause, kMaxPause);
+
+    pausedUntil_ = max(pausedUntil_, Clock::now() + pause);
+    tokens_ = 0;
+}
+
+void TokenBucket::onSuccess() {
+    lock_guard<mutex> lock(mutex_);
+    throttleStreak_ = 0;
+    if (effectiveRate_ < rate_) {
+        effectiveRate_ = min(rate_, effectiveRate_ + rate_ / 20);
+    }
+}
+
+double TokenBucket::currentRate() const {
+    lock_guard<mutex> lock(mutex_);
+    return effectiveRate_;
+}
@@ -0,0 +1,43 @@
+// rate_limiter.h
+
+#pragma once
+
+#include <chrono>
+#include <mutex>
+
+// Thread-safe token bucket shared by every outgoing request.
+//
+// Tokens refill at `rate` per second up to `burst`. When the server answers
+// 429 or 503 the effective rate is halved and new requests are held back for
+// the Retry-After delay (or an exponentially growing pause); each successful
+// response then wins back 5% of the configured rate.
+class TokenBucket {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    TokenBucket(double rate, double burst);
+
+    void configure(double rate, double burst);
+
+    // Blocks until a token is available
+    void acquire();
+    // Takes a token if one is available now; otherwise returns how long to wait
+    bool tryAcquire(Clock::duration& wait);
+
+    void onThrottled(std::chrono::seconds retryAfter);
+    void onSuccess();
+
+    double currentRate() const;
+
+private:
+    void refill(Clock::time_point now);
+
+    mutable std::mutex mutex_;
+    double rate_;
+    double burst_;
+    double effectiveRate_;
+    double tokens_;
+    int throttleStreak_ = 0;
+    Clock::time_point last_;
+    Clock::time_point pausedUntil_;
+};
@@ -0,0 +1,550 @@
+#include "schema.h"
+#include "securities.h"
+#include "sqlite_util.h"
+#include <iostream>
+#include <string>
+
+using namespace std;
+
+namespace {
+
+bool hasColumn(sqlite3* db, const char* table, const char* column) {
+    sqlite3_stmt* stmt;
+    string sql = string("PRAGMA table_info(") + table + ");";
+    bool found = false;
+    if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr) != SQLITE_OK) return false;
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        const char* name = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 1));
+        if (name && string(name) == column) found = true;
+    }
+    sqlite3_finalize(stmt);
+    return found;
+}
+
+// True if some UNIQUE index on holdings covers exactly (filing_id, cusip)
+bool hasFilingCusipUnique(sqlite3* db) {
+    sqlite3_stmt* list;
+    bool found = false;
+    if (sqlite3_prepare_v2(db, "PRAGMA index_list(holdings);", -1, &list, nullptr) != SQLITE_OK) return false;
+    while (!found && sqlite3_step(list) == SQLITE_ROW) {
+        if (sqlite3_column_int(list, 2) == 0) continue;   // not unique
+        string info = string("PRAGMA index_info(\"") + reinterpret_cast<const char*>(sqlite3_column_text(list, 1)) + "\");";
+        sqlite3_stmt* cols;
+        if (sqlite3_prepare_v2(db, info.c_str(), -1, &cols, nullptr) != SQLITE_OK) continue;
+        string names;
+        while (sqlite3_step(cols) == SQLITE_ROW) {
+            names += reinterpret_cast<const char*>(sqlite3_column_text(cols, 2));
+            names += ',';
+        }
+        sqlite3_finalize(cols);
+        found = names == "filing_id,cusip,";
+    }
+    sqlite3_finalize(list);
+    return found;
+}
+
+// v1: tables as defined in Database.sql
+bool createTables(sqlite3* db) {
+    return exec(db, R"sql(
+        CREATE TABLE IF NOT EXISTS firms (
+            id INTEGER PRIMARY KEY AUTOINCREMENT,
+            name TEXT UNIQUE
+        );
+        CREATE TABLE IF NOT EXISTS filings (
+            id INTEGER PRIMARY KEY AUTOINCREMENT,
+            firm_id INTEGER,
+            filing_date TEXT,
+            quarter TEXT,
+            created_at TEXT DEFAULT CURRENT_TIMESTAMP,
+            FOREIGN KEY(firm_id) REFERENCES firms(id)
+        );
+        CREATE TABLE IF NOT EXISTS holdings (
+            id INTEGER PRIMARY KEY AUTOINCREMENT,
+            filing_id INTEGER,
+            cusip TEXT,
+            name_of_issuer TEXT,
+            shares INTEGER,
+            value INTEGER,
+            put_call TEXT,
+            created_at TEXT DEFAULT CURRENT_TIMESTAMP,
+            UNIQUE(filing_id, cusip),
+            FOREIGN KEY(filing_id) REFERENCES filings(id)
+        );
+    )sql");
+}
+
+// v2: databases created by the old embedded schema have holdings without
+// put_call or UNIQUE(filing_id, cusip), and so may hold duplicate rows.
+// Rebuild the table keeping the first row per (filing_id, cusip).
+bool upgradeLegacyTables(sqlite3* db) {
+    if (!hasColumn(db, "filings", "created_at") &&
+        !exec(db, "ALTER TABLE filings ADD COLUMN created_at TEXT;")) {
+        return false;
+    }
+
+    bool hasPutCall = hasColumn(db, "holdings", "put_call");
+    if (hasPutCall && hasFilingCusipUnique(db)) return true;
+
+    string copy = string(R"sql(
+        CREATE TABLE holdings_v2 (
+            id INTEGER PRIMARY KEY AUTOINCREMENT,
+            filing_id INTEGER,
+            cusip TEXT,
+            name_of_issuer TEXT,
+            shares INTEGER,
+            value INTEGER,
+            put_call TEXT,
+            created_at TEXT DEFAULT CURRENT_TIMESTAMP,
+            UNIQUE(filing_id, cusip),
+            FOREIGN KEY(filing_id) REFERENCES filings(id)
+        );
+        INSERT OR IGNORE INTO holdings_v2 (id, filing_id, cusip, name_of_issuer, shares, value, put_call)
+            SELECT id, filing_id, cusip, name_of_issuer, shares, value, )sql") +
+        (hasPutCall ? "put_call" : "NULL") + R"sql(
+            FROM holdings ORDER BY id;
+        DROP TABLE holdings;
+        ALTER TABLE holdings_v2 RENAME TO holdings;
+    )sql";
+    return exec(db, copy.c_str());
+}
+
+// v3: indexes for the query paths and the per-quarter firm view
+bool createIndexesAndViews(sqlite3* db) {
+    return exec(db, R"sql(
+        CREATE INDEX IF NOT EXISTS idx_filings_firm_quarter ON filings(firm_id, quarter);
+        CREATE INDEX IF NOT EXISTS idx_filings_quarter ON filings(quarter, firm_id);
+        CREATE VIEW IF NOT EXISTS quarter_firm_stats AS
+        SELECT
+            f.quarter,
+            fi.name AS firm_name,
+            SUM(h.value) AS total_value,
+            SUM(h.shares) AS total_shares,
+            COUNT(*) AS num_holdings
+        FROM holdings h
+        JOIN filings f ON h.filing_id = f.id
+        JOIN firms fi ON f.firm_id = fi.id
+        GROUP BY f.quarter, fi.name;
+        -- The embedded schema had narrower indexes under these names
+        DROP INDEX IF EXISTS idx_holdings_filing_cusip;
+        DROP INDEX IF EXISTS idx_holdings_cusip;
+        CREATE INDEX idx_holdings_filing_cusip ON holdings(filing_id, cusip, shares, value);
+        CREATE INDEX idx_holdings_cusip ON holdings(cusip, filing_id, shares, value);
+    )sql");
+}
+
+// v4: quarter_firm_stats becomes a table kept current by HoldingsWriter,
+// joined by per-issuer and per-quarter rollups. Backfilled from holdings.
+bool createStatsTables(sqlite3* db) {
+    return exec(db, R"sql(
+        DROP VIEW IF EXISTS quarter_firm_stats;
+        CREATE TABLE quarter_firm_stats (
+            quarter TEXT NOT NULL,
+            firm_id INTEGER NOT NULL,
+            firm_name TEXT,
+            total_value INTEGER NOT NULL DEFAULT 0,
+            total_shares INTEGER NOT NULL DEFAULT 0,
+            num_holdings INTEGER NOT NULL DEFAULT 0,
+            PRIMARY KEY (quarter, firm_id)
+        ) WITHOUT ROWID;
+        CREATE TABLE issuer_quarter_stats (
+            quarter TEXT NOT NULL,
+            cusip TEXT NOT NULL,
+            name_of_issuer TEXT,
+            total_value INTEGER NOT NULL DEFAULT 0,
+            total_shares INTEGER NOT NULL DEFAULT 0,
+            num_holders INTEGER NOT NULL DEFAULT 0,
+            PRIMARY KEY (quarter, cusip)
+        ) WITHOUT ROWID;
+        CREATE TABLE quarter_stats (
+            quarter TEXT PRIMARY KEY,
+            num_filings INTEGER NOT NULL DEFAULT 0,
+            total_value INTEGER NOT NULL DEFAULT 0,
+            total_shares INTEGER NOT NULL DEFAULT 0,
+            num_holdings INTEGER NOT NULL DEFAULT 0
+        ) WITHOUT ROWID;
+
+        INSERT INTO quarter_firm_stats
+        SELECT f.quarter, f.firm_id, fi.name, SUM(h.value), SUM(h.shares), COUNT(*)
+        FROM holdings h
+        JOIN filings f ON h.filing_id = f.id
+        JOIN firms fi ON f.firm_id = fi.id
+        GROUP BY f.quarter, f.firm_id;
+
+        INSERT INTO issuer_quarter_stats
+        SELECT f.quarter, h.cusip, MAX(h.name_of_issuer), SUM(h.value), SUM(h.shares), COUNT(*)
+        FROM holdings h
+        JOIN filings f ON h.filing_id = f.id
+        GROUP BY f.quarter, h.cusip;
+
+        INSERT INTO quarter_stats
+        SELECT f.quarter, COUNT(*), COALESCE(SUM(s.total_value), 0), COALESCE(SUM(s.total_shares), 0),
+               COALESCE(SUM(s.num_holdings), 0)
+        FROM filings f
+        LEFT JOIN quarter_firm_stats s ON s.quarter = f.quarter AND s.firm_id = f.firm_id
+        GROUP BY f.quarter;
+    )sql");
+}
+
+// v5: per-accession ingestion state, so interrupted runs resume
+bool createIngestLedger(sqlite3* db) {
+    return exec(db, R"sql(
+        CREATE TABLE ingest_ledger (
+            accession TEXT PRIMARY KEY,
+            cik TEXT,
+            form_type TEXT,
+            firm_name TEXT,
+            quarter TEXT,
+            state TEXT NOT NULL,
+            attempts INTEGER NOT NULL DEFAULT 0,
+            error TEXT,
+            next_attempt_at INTEGER NOT NULL DEFAULT 0,
+            updated_at TEXT DEFAULT CURRENT_TIMESTAMP
+        ) WITHOUT ROWID;
+        CREATE INDEX idx_ingest_ledger_state ON ingest_ledger(state);
+    )sql");
+}
+
+// v6: filing metadata from the submission header
+bool addFilingMetadata(sqlite3* db) {
+    return exec(db, R"sql(
+        ALTER TABLE filings ADD COLUMN accession TEXT;
+        ALTER TABLE filings ADD COLUMN cik TEXT;
+        ALTER TABLE filings ADD COLUMN form_type TEXT;
+        ALTER TABLE filings ADD COLUMN period_of_report TEXT;
+        ALTER TABLE filings ADD COLUMN amendment_type TEXT;
+        CREATE INDEX idx_filings_accession ON filings(accession);
+    )sql");
+}
+
+// v7: firms keyed by CIK. A legacy firm takes the CIK of its filings, else
+// the one the ingest ledger recorded under its name; rows that turn out to
+// share a CIK (renamed filers) merge into the oldest one, their names
+// moving to firm_names. quarter_firm_stats is rebuilt over the merged ids.
+bool keyFirmsByCik(sqlite3* db) {
+    return exec(db, R"sql(
+        CREATE TEMP TABLE ledger_cik AS
+        SELECT firm_name, MAX(CAST(cik AS INTEGER)) AS cik FROM ingest_ledger
+        WHERE firm_name IS NOT NULL AND cik GLOB '[0-9]*' GROUP BY firm_name;
+        CREATE INDEX temp.idx_ledger_cik ON ledger_cik(firm_name);
+
+        CREATE TEMP TABLE firm_cik AS
+        SELECT fi.id, fi.name,
+               COALESCE(NULLIF((SELECT MAX(CAST(f.cik AS INTEGER)) FROM filings f
+                                WHERE f.firm_id = fi.id AND f.cik GLOB '[0-9]*'), 0),
+                        NULLIF((SELECT l.cik FROM ledger_cik l WHERE l.firm_name = fi.name), 0)) AS cik,
+               (SELECT MIN(quarter) FROM filings WHERE firm_id = fi.id) AS first_quarter,
+               (SELECT MAX(quarter) FROM filings WHERE firm_id = fi.id) AS last_quarter
+        FROM firms fi;
+        CREATE TEMP TABLE firm_map AS
+        SELECT c.id, COALESCE((SELECT MIN(o.id) FROM firm_cik o WHERE o.cik = c.cik), c.id) AS canonical
+        FROM firm_cik c;
+
+        CREATE TABLE firms_v7 (
+            id INTEGER PRIMARY KEY AUTOINCREMENT,
+            cik INTEGER UNIQUE,
+            name TEXT
+        );
+        INSERT INTO firms_v7 (id, cik, name)
+        SELECT m.canonical, MAX(c.cik),
+               (SELECT c2.name FROM firm_cik c2 JOIN firm_map m2 ON m2.id = c2.id
+                WHERE m2.canonical = m.canonical
+                ORDER BY c2.last_quarter IS NULL, c2.last_quarter DESC, c2.id DESC LIMIT 1)
+        FROM firm_map m JOIN firm_cik c ON c.id = m.id
+        GROUP BY m.canonical;
+
+        CREATE TABLE firm_names (
+            firm_id INTEGER NOT NULL,
+            name TEXT NOT NULL,
+            first_quarter TEXT,
+            last_quarter TEXT,
+            PRIMARY KEY (firm_id, name),
+            FOREIGN KEY(firm_id) REFERENCES firms(id)
+        ) WITHOUT ROWID;
+        INSERT INTO firm_names (firm_id, name, first_quarter, last_quarter)
+        SELECT m.canonical, c.name, MIN(c.first_quarter), MAX(c.last_quarter)
+        FROM firm_cik c JOIN firm_map m ON m.id = c.id
+        WHERE c.name IS NOT NULL
+        GROUP BY m.canonical, c.name;
+
+        -- Rows keep the name filed in their quarter, as HoldingsWriter does
+        DELETE FROM quarter_firm_stats;
+        INSERT INTO quarter_firm_stats
+        SELECT f.quarter, m.canonical, MAX(c.name), SUM(h.value), SUM(h.shares), COUNT(*)
+        FROM holdings h
+        JOIN filings f ON h.filing_id = f.id
+        JOIN firm_map m ON m.id = f.firm_id
+        JOIN firm_cik c ON c.id = f.firm_id
+        GROUP BY f.quarter, m.canonical;
+
+        UPDATE filings SET firm_id = (SELECT canonical FROM firm_map WHERE id = filings.firm_id)
+        WHERE firm_id IN (SELECT id FROM firm_map WHERE canonical <> id);
+        -- "0001100001" and "1100001" are the same filer
+        UPDATE filings SET cik = CAST(cik AS INTEGER) WHERE cik GLOB '[0-9]*';
+
+        DROP TABLE firms;
+        ALTER TABLE firms_v7 RENAME TO firms;
+        CREATE INDEX idx_firms_name ON firms(name);
+
+
+        DROP TABLE temp.firm_map;
+        DROP TABLE temp.firm_cik;
+        DROP TABLE temp.ledger_cik;
+    )sql");
+}
+
+// v8: CUSIPs and issuer names move to a securities table that holdings and
+// issuer_quarter_stats reference by integer id (packCusip where the CUSIP is
+// well formed). Each security takes the issuer name of its latest row.
+bool createSecurities(sqlite3* db) {
+    return registerCusipFunctions(db) && exec(db, R"sql(
+        CREATE TABLE securities (
+            id INTEGER PRIMARY KEY,
+            cusip TEXT NOT NULL UNIQUE,
+            name_of_issuer TEXT,
+            title_of_class TEXT
+        );
+        INSERT INTO securities (id, cusip, name_of_issuer)
+        SELECT COALESCE(pack_cusip(cusip), -ROW_NUMBER() OVER (PARTITION BY pack_cusip(cusip) IS NULL ORDER BY cusip)),
+               cusip, name_of_issuer
+        FROM (SELECT COALESCE(cusip, '') AS cusip, name_of_issuer FROM holdings
+              WHERE id IN (SELECT MAX(id) FROM holdings GROUP BY COALESCE(cusip, '')));
+
+        CREATE TABLE holdings_v8 (
+            id INTEGER PRIMARY KEY AUTOINCREMENT,
+            filing_id INTEGER,
+            security_id INTEGER,
+            shares INTEGER,
+            value INTEGER,
+            put_call TEXT,
+            UNIQUE(filing_id, security_id),
+            FOREIGN KEY(filing_id) REFERENCES filings(id),
+            FOREIGN KEY(security_id) REFERENCES securities(id)
+        );
+        INSERT INTO holdings_v8 (id, filing_id, security_id, shares, value, put_call)
+            SELECT h.id, h.filing_id, s.id, h.shares, h.value, h.put_call
+            FROM holdings h JOIN securities s ON s.cusip = COALESCE(h.cusip, '')
+            ORDER BY h.id;
+        DROP TABLE holdings;
+        ALTER TABLE holdings_v8 RENAME TO holdings;
+
+        DROP TABLE issuer_quarter_stats;
+        CREATE TABLE issuer_quarter_stats (
+            quarter TEXT NOT NULL,
+            security_id INTEGER NOT NULL,
+            total_value INTEGER NOT NULL DEFAULT 0,
+            total_shares INTEGER NOT NULL DEFAULT 0,
+            num_holders INTEGER NOT NULL DEFAULT 0,
+            PRIMARY KEY (quarter, security_id)
+        ) WITHOUT ROWID;
+        INSERT INTO issuer_quarter_stats
+        SELECT f.quarter, h.security_id, SUM(h.value), SUM(h.shares), COUNT(*)
+        FROM holdings h
+        JOIN filings f ON h.filing_id = f.id
+        GROUP BY f.quarter, h.security_id;
+    )sql") && createSecondaryIndexes(db);
+}
+
+// v9: holdings are keyed by position, (filing, security, put/call), so an
+// option on a security no longer collides with the shares. put_call is ''
+// rather than NULL for shares, as NULLs never conflict in a UNIQUE key.
+// holdings_detail keeps the rows as filed, when ingestion is asked to.
+// issuer_quarter_stats covers share positions only, so a firm holding the
+// shares and an option counts once and option notional stays out of the
+// share totals.
+bool keyHoldingsByPosition(sqlite3* db) {
+    return exec(db, R"sql(
+        CREATE TABLE holdings_v9 (
+            id INTEGER PRIMARY KEY AUTOINCREMENT,
+            filing_id INTEGER,
+            security_id INTEGER,
+            shares INTEGER,
+            value INTEGER,
+            put_call TEXT NOT NULL DEFAULT '',
+            UNIQUE(filing_id, security_id, put_call),
+            FOREIGN KEY(filing_id) REFERENCES filings(id),
+            FOREIGN KEY(security_id) REFERENCES securities(id)
+        );
+        INSERT INTO holdings_v9 (id, filing_id, security_id, shares, value, put_call)
+            SELECT id, filing_id, security_id, shares, value, COALESCE(put_call, '')
+            FROM holdings ORDER BY id;
+        DROP TABLE holdings;
+        ALTER TABLE holdings_v9 RENAME TO holdings;
+
+        CREATE TABLE holdings_detail (
+            filing_id INTEGER NOT NULL,
+            line INTEGER NOT NULL,
+            security_id INTEGER NOT NULL,
+            title_of_class TEXT,
+            shares INTEGER,
+            shares_type TEXT,
+            value INTEGER,
+            put_call TEXT NOT NULL DEFAULT '',
+            investment_discretion TEXT,
+            other_manager TEXT,
+            voting_sole INTEGER,
+            voting_shared INTEGER,
+            voting_none INTEGER,
+            PRIMARY KEY (filing_id, line)
+        ) WITHOUT ROWID;
+
+        -- Share positions only: one row per holder, no option notional in the shares
+        DELETE FROM issuer_quarter_stats;
+        INSERT INTO issuer_quarter_stats
+        SELECT f.quarter, h.security_id, SUM(h.value), SUM(h.shares), COUNT(*)
+        FROM holdings h
+        JOIN filings f ON h.filing_id = f.id
+        WHERE h.put_call = ''
+        GROUP BY f.quarter, h.security_id;
+    )sql") && createSecondaryIndexes(db);
+}
+
+// v10: small key/value table. holdings_version counts committed writer
+// batches that changed holdings, so derived files (the holder index) can
+// tell whether they are current.
+bool createMeta(sqlite3* db) {
+    return exec(db, R"sql(
+        CREATE TABLE meta (
+            key TEXT PRIMARY KEY,
+            value
+        ) WITHOUT ROWID;
+        INSERT INTO meta (key, value) VALUES ('holdings_version', 0);
+    )sql");
+}
+
+// v11: the v7 merge of firms by CIK moved every filing of the merged firms
+// to one firm id, which can leave two originals for the same firm and
+// quarter (the same report stored under an old and a new name). Keep the
+// latest filed of each set, drop the others' rows and refresh the stats
+// they fed.
+bool dropDuplicateFilings(sqlite3* db) {
+    if (!exec(db, R"sql(
+        CREATE TEMP TABLE duplicate_filings AS
+        SELECT f.id, f.firm_id, f.quarter FROM filings f
+        WHERE f.form_type IS NOT '13F-HR/A' AND EXISTS (
+            SELECT 1 FROM filings g
+            WHERE g.firm_id = f.firm_id AND g.quarter = f.quarter AND g.id <> f.id
+              AND g.form_type IS NOT '13F-HR/A'
+              AND (g.period_of_report IS NULL OR f.period_of_report IS NULL
+                   OR g.period_of_report = f.period_of_report)
+              AND (COALESCE(g.filing_date, '') > COALESCE(f.filing_date, '')
+                   OR (COALESCE(g.filing_date, '') = COALESCE(f.filing_date, '') AND g.id > f.id)));
+    )sql")) {
+        return false;
+    }
+
+    sqlite3_stmt* stmt;
+    int duplicates = 0;
+    if (sqlite3_prepare_v2(db, "SELECT COUNT(*) FROM temp.duplicate_filings;", -1, &stmt, nullptr) == SQLITE_OK) {
+        if (sqlite3_step(stmt) == SQLITE_ROW) duplicates = sqlite3_column_int(stmt, 0);
+        sqlite3_finalize(stmt);
+    }
+    if (duplicates) cout << "Dropping " << duplicates << " duplicate filing(s) left by the v7 firm merge" << endl;
+
+    return exec(db, R"sql(
+        DELETE FROM holdings_detail WHERE filing_id IN (SELECT id FROM temp.duplicate_filings);
+        DELETE FROM holdings WHERE filing_id IN (SELECT id FROM temp.duplicate_filings);
+        DELETE FROM filings WHERE id IN (SELECT id FROM temp.duplicate_filings);
+
+        UPDATE quarter_firm_stats SET total_value = t.value, total_shares = t.shares, num_holdings = t.rows
+        FROM (SELECT f.quarter, f.firm_id, COALESCE(SUM(h.value), 0) AS value,
+                     COALESCE(SUM(h.shares), 0) AS shares, COUNT(h.id) AS rows
+              FROM filings f LEFT JOIN holdings h ON h.filing_id = f.id
+              WHERE (f.quarter, f.firm_id) IN (SELECT quarter, firm_id FROM temp.duplicate_filings)
+              GROUP BY f.quarter, f.firm_id) AS t
+        WHERE quarter_firm_stats.quarter = t.quarter AND quarter_firm_stats.firm_id = t.firm_id;
+
+        DELETE FROM issuer_quarter_stats WHERE quarter IN (SELECT quarter FROM temp.duplicate_filings);
+        INSERT INTO issuer_quarter_stats
+        SELECT f.quarter, h.security_id, SUM(h.value), SUM(h.shares), COUNT(*)
+        FROM holdings h
+        JOIN filings f ON h.filing_id = f.id
+        WHERE h.put_call = '' AND f.quarter IN (SELECT quarter FROM temp.duplicate_filings)
+        GROUP BY f.quarter, h.security_id;
+
+        UPDATE quarter_stats SET num_filings = t.filings, total_value = t.value, total_shares = t.shares,
+                                 num_holdings = t.rows
+        FROM (SELECT f.quarter, COUNT(DISTINCT f.id) AS filings, COALESCE(SUM(h.value), 0) AS value,
+                     COALESCE(SUM(h.shares), 0) AS shares, COUNT(h.id) AS rows
+              FROM filings f LEFT JOIN holdings h ON h.filing_id = f.id
+              WHERE f.quarter IN (SELECT quarter FROM temp.duplicate_filings)
+              GROUP BY f.quarter) AS t
+        WHERE quarter_stats.quarter = t.quarter;
+
+        UPDATE meta SET value = value + 1
+        WHERE key = 'holdings_version' AND EXISTS (SELECT 1 FROM temp.duplicate_filings);
+        DROP TABLE temp.duplicate_filings;
+    )sql");
+}
+
+struct Migration {
+    int version;
+    const char* description;
+    bool (*apply)(sqlite3*);
+};
+
+const Migration kMigrations[] = {
+    {1, "base tables", createTables},
+    {2, "upgrade legacy holdings table", upgradeLegacyTables},
+    {3, "indexes and quarter_firm_stats view", createIndexesAndViews},
+    {4, "materialized firm, issuer and quarter stats", createStatsTables},
+    {5, "ingest ledger", createIngestLedger},
+    {6, "filing metadata columns", addFilingMetadata},
+    {7, "firms keyed by CIK, firm_names history", keyFirmsByCik},
+    {8, "securities table, holdings by security id", createSecurities},
+    {9, "holdings keyed by position, holdings_detail", keyHoldingsByPosition},
+    {10, "meta table, holdings change counter", createMeta},
+    {11, "drop duplicate filings left by the v7 firm merge", dropDuplicateFilings},
+};
+
+} // namespace
+
+const int kSchemaVersion = kMigrations[sizeof(kMigrations) / sizeof(kMigrations[0]) - 1].version;
+
+// Covering indexes: per-filing scans (diffs, stats) and per-security lookups
+// (top holders) are answered without touching the table rows.
+bool createSecondaryIndexes(sqlite3* db) {
+    return exec(db, R"sql(
+        CREATE INDEX IF NOT EXISTS idx_holdings_filing_security ON holdings(filing_id, security_id, shares, value);
+        CREATE INDEX IF NOT EXISTS idx_holdings_security ON holdings(security_id, filing_id, shares, value);
+    )sql");
+}
+
+bool dropSecondaryIndexes(sqlite3* db) {
+    return exec(db, R"sql(
+        DROP INDEX IF EXISTS idx_holdings_filing_security;
+        DROP INDEX IF EXISTS idx_holdings_security;
+    )sql");
+}
+
+int schemaVersion(sqlite3* db) {
+    sqlite3_stmt* stmt;
+    int version = 0;
+    if (sqlite3_prepare_v2(db, "PRAGMA user_version;", -1, &stmt, nullptr) == SQLITE_OK) {
+        if (sqlite3_step(stmt) == SQLITE_ROW) version = sqlite3_column_int(stmt, 0);
+        sqlite3_finalize(stmt);
+    }
+    return version;
+}
+
+bool migrateSchema(sqlite3* db) {
+    int current = schemaVersion(db);
+    if (current > kSchemaVersion) {
+        cerr << "holdings.db is at schema version " << current
+             << ", newer than this build (" << kSchemaVersion << ")" << endl;
+        return false;
+    }
+
+    for (const auto& m : kMigrations) {
+        if (m.version <= current) continue;
+        cout << "Migrating schema to version " << m.version << ": " << m.description << endl;
+        if (!exec(db, "BEGIN IMMEDIATE;")) return false;
+        string setVersion = "PRAGMA user_version = " + to_string(m.version) + ";";
+        if (!m.apply(db) || !exec(db, setVersion.c_str())) {
+            exec(db, "ROLLBACK;");
+            return false;
+        }
+        if (!exec(db, "COMMIT;")) return false;
+        current = m.version;
+    }
+    return true;
+}
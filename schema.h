@@ -0,0 +1,17 @@
+// schema.h
+
+#pragma once
+
+#include <sqlite3.h>
+
+// holdings.db schema, kept as an ordered list of migrations. The version a
+// database is at lives in PRAGMA user_version; migrateSchema applies every
+// newer migration, each in its own transaction.
+extern const int kSchemaVersion;
+
+int schemaVersion(sqlite3* db);
+bool migrateSchema(sqlite3* db);
+
+// Read-side indexes on holdings, dropped and rebuilt around bulk loads
+bool createSecondaryIndexes(sqlite3* db);
+bool dropSecondaryIndexes(sqlite3* db);
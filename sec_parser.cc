@@ -1,23 +1,20 @@
 #include "sec_parser.h"
+#include "http_client.h"
+#include "http_cache.h"
+#include "infotable_parser.h"
+#include "idx_scanner.h"
+#include "holdings_writer.h"
+#include "metrics.h"
+#include <cstdint>
 #include <iostream>
-#include <fstream>
-#include <sstream>
 #include <regex>
-#include <unordered_map>
+#include <string_view>
 #include <unordered_set>
 #include <curl/curl.h>
-#include <tinyxml2.h>
-#include <chrono>
 #include <thread>
+#include <functional>
 
 using namespace std;
-using namespace tinyxml2;
-
-// Callback for libcurl
-size_t WriteCallback(void* contents, size_t size, size_t nmemb, string* output) {
-    output->append((char*)contents, size * nmemb);
-    return size * nmemb;
-}
 
 string trim(const string& s) {
     size_t start = s.find_first_not_of(" \t\n\r");
@@ -41,31 +38,8 @@ string getQuarterFromDate(const string& dateStr) {
     return to_string(year) + "Q" + to_string(q);
 }
 
-const char* schema = R"sql(
-    CREATE TABLE IF NOT EXISTS firms (
-        id INTEGER PRIMARY KEY AUTOINCREMENT,
-        name TEXT UNIQUE
-    );
-    CREATE TABLE IF NOT EXISTS filings (
-        id INTEGER PRIMARY KEY AUTOINCREMENT,
-        firm_id INTEGER,
-        filing_date TEXT,
-        quarter TEXT,
-        FOREIGN KEY(firm_id) REFERENCES firms(id)
-    );
-    CREATE TABLE IF NOT EXISTS holdings (
-        id INTEGER PRIMARY KEY AUTOINCREMENT,
-        filing_id INTEGER,
-        cusip TEXT,
-        name_of_issuer TEXT,
-        shares INTEGER,
-        value INTEGER,
-        FOREIGN KEY(filing_id) REFERENCES filings(id)
-    );
-)sql";
-
 vector<string> extractXmlLinks(const string& html, const string& baseUrl) {
-    auto start = std::chrono::high_resolution_clock::now();
+    StageTimer timer(Stage::ExtractLinks);
     vector<string> links;
     unordered_set<string> seen;
     smatch match;
@@ -89,263 +63,185 @@ vector<string> extractXmlLinks(const string& html, const string& baseUrl) {
         // Build full URL
         links.push_back(baseUrl + cleanFilename);
     }
-
-    auto endd = std::chrono::high_resolution_clock::now();
-    //std::cout << "Time taken for extractXmlLinks: "
-    //      << std::chrono::duration_cast<std::chrono::milliseconds>(endd - start).count()
-    //      << " ms" << std::endl;
-
     return links;
 }
 
-// returns: (firmName, folderUrl, quarter)
-vector<tuple<string, string,string, string>> extract13FHRUrls(const string& idxPath) {
-    auto start = std::chrono::high_resolution_clock::now();
-    ifstream file(idxPath);
-    vector<tuple<string, string,string, string>> filings;
-    if (!file.is_open()) {
+// returns every 13F-HR and 13F-HR/A filing in the index
+vector<FilingRef> extract13FHRUrls(const string& idxPath) {
+    StageTimer timer(Stage::ScanIndex);
+    MappedFile file;
+    if (!file.open(idxPath)) {
         cerr << "Could not open file: " << idxPath << "\n";
-        return filings;
-    }    
-
-    string line;
-    bool startReading = false;
-
-    while (getline(file, line)) {
-        // Skip header until the real data starts
-        if (!startReading) {
-            if (line.find("CIK|Company Name|Form Type|Date Filed|Filename") != string::npos) {
-                startReading = true;
-            }
-            continue;
-        }
-
-        vector<string> fields;
-        stringstream ss(line);
-        string field;
-
-        while (getline(ss, field, '|')) {
-            fields.push_back(field);
-        }
-
-        if (fields.size() != 5) continue;
-
-        string cik = fields[0];
-        string name = fields[1];
-        string formType = fields[2];
-        string dateFiled = fields[3]; // Format: YYYY-MM-DD
-        string filename = fields[4];
-
-        if (formType != "13F-HR") continue;
-
-        // Extract accession number and format it
-        smatch match;
-        if (regex_search(filename, match, regex(R"(data/(\d+)/([^/]+)\.txt)"))) {
-            string folderCIK = match[1].str();
-            string accessionDashes = match[2].str();
-            string accessionNoDashes = accessionDashes;
-            accessionNoDashes.erase(remove(accessionNoDashes.begin(), accessionNoDashes.end(), '-'), accessionNoDashes.end());
-
-            // Build base folder URL
-            string folderUrl = "https://www.sec.gov/Archives/edgar/data/" + folderCIK + "/" + accessionNoDashes + "/";
-
-            string quarter;
-            if (dateFiled.size() >= 7) {
-                int month = stoi(dateFiled.substr(5, 2));
-                int year = stoi(dateFiled.substr(0, 4));
-                int q = (month - 1) / 3 + 1;
-                quarter = to_string(year) + "Q" + to_string(q);
-            } else {
-                quarter = "Unknown";
-            }
-            filings.emplace_back(name, folderUrl, quarter, dateFiled); 
-        }
+        return {};
     }
 
-    auto end = std::chrono::high_resolution_clock::now();
-    //std::cout << "Time taken for extract13FHRUrls: "
-    //      << std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count()
-    //      << " ms" << std::endl;
-    return filings;
+    return scan13FHRFilings(file.data(), file.size());
 }
 
-// Download a URL into a string
+// Download a URL into a string. Connections are reused across calls and
+// successful responses are served from the on-disk cache on later runs.
 string fetchURL(const string& url) {
-    auto start = std::chrono::high_resolution_clock::now();
-    CURL* curl = curl_easy_init();
-    string response;
-
-    if (!curl) {
-        cerr << "curl_easy_init() failed" << endl;
+    HttpCache& cache = httpCache();
+    string cached;
+    if (cache.lookup(url, cached)) {
+        countMetric(Counter::CacheHits);
+        return cached;
+    }
+    if (cache.offline()) {
+        cerr << "Offline and not in cache: " << url << endl;
         return "";
     }
 
-    struct curl_slist* headers = nullptr;
-    headers = curl_slist_append(headers, "Accept: application/xml, text/xml, */*;q=0.9");
-    headers = curl_slist_append(headers, "Connection: keep-alive");
-
-    // 🛠 Replace with your company/project info
-    const char* userAgent = "FinanceApp/1.0 (Contact: vilhelm.helsing@gmail.com)";
-
-    curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
-    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
-    curl_easy_setopt(curl, CURLOPT_USERAGENT, userAgent);
-    curl_easy_setopt(curl, CURLOPT_REFERER, "https://www.sec.gov/");
-    curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
-    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteCallback);
-    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &response);
-
-    CURLcode res = curl_easy_perform(curl);
+    FetchResult result = httpClient().get(url);
 
-    long http_code = 0;
-    curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &http_code);
-
-    //cout << "HTTP response code: " << http_code << endl;
-
-    if (res != CURLE_OK) {
-        cerr << "curl_easy_perform() failed: " << curl_easy_strerror(res) << endl;
-    } else if (http_code != 200) {
-        //cerr << "Server returned non-200 response: " << http_code << endl;
-        response = "";
+    if (result.code != CURLE_OK) {
+        cerr << "curl_easy_perform() failed: " << curl_easy_strerror(result.code) << endl;
+        result.body.clear();
+    } else if (result.status != 200) {
+        result.body.clear();
+    } else {
+        cache.store(url, result.body);
     }
-
-    curl_slist_free_all(headers);
-    curl_easy_cleanup(curl);
-    auto end = std::chrono::high_resolution_clock::now();
-    //std::cout << "Time taken for fetchURL: "
-    //      << std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count()
-    //      << " ms" << std::endl;
-
-    return response;
+    return result.body;
 }
 
-void parse13F(string const& xmlContent, string const& name, string const& quarter, string const& filing_date, sqlite3* db) {
-    auto start = std::chrono::high_resolution_clock::now();
-    if (xmlContent.find("<html") != string::npos || xmlContent.find("<!DOCTYPE html") != string::npos) {
-        cerr << "Received HTML instead of XML. Probably an error page." << endl;
-        return;
+// Stream a URL through onChunk without buffering the body. Cache hits are
+// replayed in one chunk; on a miss the body is only kept in memory when it
+// has to be written to the cache afterwards.
+bool fetchURLStreaming(const string& url, const function<bool(const char*, size_t)>& onChunk) {
+    HttpCache& cache = httpCache();
+    string cached;
+    if (cache.lookup(url, cached)) {
+        countMetric(Counter::CacheHits);
+        return onChunk(cached.data(), cached.size());
     }
-
-    tinyxml2::XMLDocument doc;
-    if (doc.Parse(xmlContent.c_str()) != tinyxml2::XML_SUCCESS) {
-        cerr << "Failed to parse XML" << endl;
-        return;
+    if (cache.offline()) {
+        cerr << "Offline and not in cache: " << url << endl;
+        return false;
     }
 
-    tinyxml2::XMLElement* root = doc.RootElement(); 
-    unordered_map<string, long long> totalValue;
-    unordered_map<string, long long> totalShares;
-
-    // Insert or ignore firm
-    sqlite3_stmt* stmt;
-
-    // Insert or ignore firm (prepared)
-    sqlite3_prepare_v2(db, "INSERT OR IGNORE INTO firms (name) VALUES (?);", -1, &stmt, nullptr);
-    sqlite3_bind_text(stmt, 1, name.c_str(), -1, SQLITE_TRANSIENT);
-    sqlite3_step(stmt);
-    sqlite3_finalize(stmt);
+    string copy;
+    FetchResult result = httpClient().stream(url, [&](const char* data, size_t len) {
+        if (cache.enabled()) copy.append(data, len);
+        return onChunk(data, len);
+    });
 
-    // Select firm ID
-    sqlite3_prepare_v2(db, "SELECT id FROM firms WHERE name = ?;", -1, &stmt, nullptr);
-    sqlite3_bind_text(stmt, 1, name.c_str(), -1, SQLITE_TRANSIENT);
-    int firm_id = -1;
-    if (sqlite3_step(stmt) == SQLITE_ROW) {
-        firm_id = sqlite3_column_int(stmt, 0);
+    if (result.code == CURLE_WRITE_ERROR) {
+        return false;   // aborted by onChunk
     }
-    sqlite3_finalize(stmt);
-
-    // Add a sample filing (e.g., "2025-03-31", "2025Q1")
-    sqlite3_prepare_v2(db, 
-        "INSERT OR IGNORE INTO filings (firm_id, filing_date, quarter) VALUES (?, ?, ?);",
-        -1, &stmt, nullptr);
-    sqlite3_bind_int(stmt, 1, firm_id);
-    sqlite3_bind_text(stmt, 2, filing_date.c_str(), -1, SQLITE_TRANSIENT);
-    sqlite3_bind_text(stmt, 3, quarter.c_str(), -1, SQLITE_TRANSIENT);
-    sqlite3_step(stmt);
-    sqlite3_finalize(stmt);
-
-    // Get filing ID
-    int filing_id = -1;
-    sqlite3_prepare_v2(db,
-        "SELECT id FROM filings WHERE firm_id = ? AND quarter = ?;",
-        -1, &stmt, nullptr);
-    sqlite3_bind_int(stmt, 1, firm_id);
-    sqlite3_bind_text(stmt, 2, quarter.c_str(), -1, SQLITE_TRANSIENT);
-    if (sqlite3_step(stmt) == SQLITE_ROW) {
-        filing_id = sqlite3_column_int(stmt, 0);
+    if (result.code != CURLE_OK) {
+        cerr << "curl_easy_perform() failed: " << curl_easy_strerror(result.code) << endl;
+        return false;
     }
-    sqlite3_finalize(stmt);
-
-    sqlite3_prepare_v2(db,
-        "INSERT OR IGNORE INTO holdings (filing_id, cusip, name_of_issuer, shares, value, put_call) VALUES (?, ?, ?, ?, ?, ?);",
-        -1, &stmt, nullptr);
-
-    sqlite3_exec(db, "BEGIN TRANSACTION;", nullptr, nullptr, nullptr);
-    for (XMLElement* entry = root->FirstChildElement(); entry; entry = entry->NextSiblingElement()) {
-        if (stripNamespace(entry->Name()) != "infoTable") continue;
-
-        auto getText = [&](XMLElement* elem, const char* tagName) -> const char* {
-            for (XMLElement* child = elem->FirstChildElement(); child; child = child->NextSiblingElement()) {
-                if (stripNamespace(child->Name()) == tagName)
-                    return child->GetText();
-            }
-            return nullptr;
-        };
+    if (result.status != 200) {
+        return false;
+    }
+    cache.store(url, copy);
+    return true;
+}
 
-        const char* name = getText(entry, "nameOfIssuer");
-        const char* cusip = getText(entry, "cusip");
-        const char* value = getText(entry, "value");
-        const char* put_call = getText(entry, "putCall");  
+bool fetchInfoTable(const string& url, vector<Holding>& holdings) {
+    // An information table names its first <infoTable> within a few KB
+    const size_t kSniffBytes = 8 * 1024;
 
-        // sshPrnamt is nested inside <shrsOrPrnAmt>
-        const char* shares = nullptr;
+    holdings.clear();
+    InfoTableParser parser([&](const Holding& h) { holdings.push_back(h); });
+    size_t received = 0;
+    bool isInfoTable = false;
+    bool parseError = false;
 
-        XMLElement* shrsOrPrnAmt = nullptr;
-        for (XMLElement* child = entry->FirstChildElement(); child; child = child->NextSiblingElement()) {
-            if (stripNamespace(child->Name()) == "shrsOrPrnAmt") {
-                shrsOrPrnAmt = child;
-                break;
-            }
+    bool ok = fetchURLStreaming(url, [&](const char* data, size_t len) {
+        if (!parser.feed(data, len)) {
+            parseError = true;
+            return false;
         }
-        if (shrsOrPrnAmt) {
-            shares = getText(shrsOrPrnAmt, "sshPrnamt");
+        received += len;
+        if (!isInfoTable) {
+            isInfoTable = parser.sawInfoTable();
+            // Give up on primary_doc.xml and friends without downloading them
+            if (!isInfoTable && received >= kSniffBytes) return false;
         }
+        return true;
+    });
 
-        if (filing_id == -1) {
-            std::cerr << "Error: filing_id not found for firm_id " << firm_id << " and quarter " << quarter << std::endl;
-            return;
-        }
+    if (parseError && isInfoTable) {
+        cerr << "Failed to parse XML: " << url << endl;
+    }
+    if (!ok || !isInfoTable || !parser.finish()) {
+        holdings.clear();
+        return false;
+    }
+    return true;
+}
 
-        if (!name || !cusip || !shares) {
-            std::cerr << "Skipping entry — missing fields: "
-                      << (name ? "" : "name ") 
-                      << (cusip ? "" : "cusip ") 
-                      << (shares ? "" : "shares ") 
-                      << std::endl;
-            continue;
-        }        
-        
-        string cusipStr = trim(cusip);
+vector<Holding> parse13FHoldings(const string& xmlContent) {
+    StageTimer timer(Stage::ParseInfoTable);
+    vector<Holding> holdings;
+    if (xmlContent.find("<html") != string::npos || xmlContent.find("<!DOCTYPE html") != string::npos) {
+        cerr << "Received HTML instead of XML. Probably an error page." << endl;
+        return holdings;
+    }
 
-        // Insert all entries
-        
-        sqlite3_bind_int(stmt, 1, filing_id);
-        sqlite3_bind_text(stmt, 2, cusipStr.c_str(), -1, SQLITE_STATIC);
-        sqlite3_bind_text(stmt, 3, name, -1, SQLITE_STATIC);
-        sqlite3_bind_int64(stmt, 4, atoll(shares));
-        // Safely handle NULL value
-        sqlite3_bind_int64(stmt, 5, value ? atoll(value) : 0);
-        // Safely handle NULL put_call
-        sqlite3_bind_text(stmt, 6, put_call ? put_call : nullptr, -1, SQLITE_STATIC);
-        sqlite3_step(stmt);   
+    InfoTableParser parser([&](const Holding& h) { holdings.push_back(h); });
+    if (!parser.feed(xmlContent.data(), xmlContent.size()) || !parser.finish()) {
+        cerr << "Failed to parse XML" << endl;
+    }
+    return holdings;
+}
 
-        
+size_t consolidateHoldings(vector<Holding>& holdings) {
+    size_t n = holdings.size();
+    if (n < 2) return 0;
+
+    // Open addressing over indexes into the kept prefix of `holdings`, at
+    // most half full; one probe per row in the usual case of no duplicates
+    const uint32_t kEmpty = UINT32_MAX;
+    size_t mask = 1;
+    while (mask < n * 2) mask <<= 1;
+    vector<uint32_t> slots(mask, kEmpty);
+    --mask;
+
+    hash<string_view> hasher;
+    size_t kept = 0;
+    for (size_t i = 0; i < n; ++i) {
+        Holding& h = holdings[i];
+        size_t slot = (hasher(h.cusip) * 31 + hasher(h.putCall)) & mask;
+        while (slots[slot] != kEmpty) {
+            const Holding& p = holdings[slots[slot]];
+            if (p.cusip == h.cusip && p.putCall == h.putCall) break;
+            slot = (slot + 1) & mask;
+        }
+        if (slots[slot] == kEmpty) {
+            slots[slot] = static_cast<uint32_t>(kept);
+            if (kept != i) holdings[kept] = std::move(h);
+            ++kept;
+            continue;
+        }
+        Holding& p = holdings[slots[slot]];
+        p.shares += h.shares;
+        p.value += h.value;
+        p.votingSole += h.votingSole;
+        p.votingShared += h.votingShared;
+        p.votingNone += h.votingNone;
     }
-    sqlite3_finalize(stmt); 
-    sqlite3_exec(db, "END TRANSACTION;", nullptr, nullptr, nullptr);
+    holdings.resize(kept);
+    return n - kept;
+}
 
-    auto end = std::chrono::high_resolution_clock::now();
-    //std::cout << "Time taken for parse13F: "
-    //      << std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count()
-    //      << " ms" << std::endl;
-}
\ No newline at end of file
+void write13F(sqlite3* db, const string& name, const string& quarter, const string& filing_date, const vector<Holding>& holdings) {
+    HoldingsWriter writer(db);
+    FilingRecord record;
+    record.firmName = name;
+    record.quarter = quarter;
+    record.filingDate = filing_date;
+    record.holdings = holdings;
+    record.consolidate(false);
+    writer.write(record);
+    writer.flush();
+}
+
+void parse13F(string const& xmlContent, string const& name, string const& quarter, string const& filing_date, sqlite3* db) {
+    // Timed as its parse_info_table and write_filing stages
+    vector<Holding> holdings = parse13FHoldings(xmlContent);
+    write13F(db, name, quarter, filing_date, holdings);
+}
@@ -2,23 +2,57 @@
 
 #pragma once
 
+#include <functional>
 #include <string>
 #include <vector>
-#include <tuple>
 #include <sqlite3.h>
+#include "idx_scanner.h"
+
+// One <infoTable> row of a 13F-HR information table
+struct Holding {
+    std::string cusip;
+    std::string nameOfIssuer;
+    std::string titleOfClass;
+    long long shares = 0;
+    long long value = 0;
+    std::string putCall;
+    // Per-line detail, stored only in holdings_detail
+    std::string sharesType;             // SH or PRN
+    std::string investmentDiscretion;   // SOLE, DFND or OTR
+    std::string otherManager;
+    long long votingSole = 0;
+    long long votingShared = 0;
+    long long votingNone = 0;
+};
+
+// Filers split one position over several rows, by investment discretion or
+// other manager. Sums rows with the same CUSIP and put/call into the first
+// of them, keeping row order; returns the number of rows merged away.
+size_t consolidateHoldings(std::vector<Holding>& holdings);
 
 std::string fetchURL(const std::string& url);
+// Streams the body through onChunk; false if the fetch failed or onChunk aborted it
+bool fetchURLStreaming(const std::string& url, const std::function<bool(const char*, size_t)>& onChunk);
+// Downloads and parses an information table in one pass. Returns false, after
+// reading only the first few KB, if the document is not an information table.
+bool fetchInfoTable(const std::string& url, std::vector<Holding>& holdings);
 std::string trim(const std::string& s);
 std::string stripNamespace(const char* tagName);
 std::string getQuarterFromDate(const std::string& dateStr);
 
 std::vector<std::string> extractXmlLinks(const std::string& html, const std::string& baseUrl);
-std::vector<std::tuple<std::string, std::string, std::string, std::string>> extract13FHRUrls(const std::string& idxPath);
+std::vector<FilingRef> extract13FHRUrls(const std::string& idxPath);
+
+// Parsing and storing are split so they can run on different threads
+std::vector<Holding> parse13FHoldings(const std::string& xmlContent);
+void write13F(sqlite3* db,
+              const std::string& name,
+              const std::string& quarter,
+              const std::string& filing_date,
+              const std::vector<Holding>& holdings);
 
 void parse13F(const std::string& xmlContent,
               const std::string& name,
               const std::string& quarter,
               const std::string& filing_date,
               sqlite3* db);
-
-extern const char* schema;
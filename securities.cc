@@ -0,0 +1,141 @@
+#include "securities.h"
+#include <iostream>
+
+using namespace std;
+
+namespace {
+
+// '#' '*' 0-9 '@' A-Z, the CUSIP alphabet in ASCII order
+const char kAlphabet[] = "#*0123456789@ABCDEFGHIJKLMNOPQRSTUVWXYZ";
+const int64_t kBase = 40;
+
+int digitOf(char c) {
+    if (c >= '0' && c <= '9') return 3 + (c - '0');
+    if (c >= 'A' && c <= 'Z') return 14 + (c - 'A');
+    switch (c) {
+    case '#': return 1;
+    case '*': return 2;
+    case '@': return 13;
+    }
+    return 0;
+}
+
+void bindOptional(sqlite3_stmt* stmt, int index, const string& value) {
+    if (value.empty()) sqlite3_bind_null(stmt, index);
+    else sqlite3_bind_text(stmt, index, value.c_str(), static_cast<int>(value.size()), SQLITE_STATIC);
+}
+
+void packCusipSql(sqlite3_context* ctx, int, sqlite3_value** argv) {
+    const unsigned char* text = sqlite3_value_text(argv[0]);
+    int64_t id = text ? packCusip(reinterpret_cast<const char*>(text)) : -1;
+    if (id < 0) sqlite3_result_null(ctx);
+    else sqlite3_result_int64(ctx, id);
+}
+
+} // namespace
+
+int64_t packCusip(string_view cusip) {
+    if (cusip.size() != 9) return -1;
+    int64_t id = 0;
+    for (char c : cusip) {
+        int d = digitOf(c);
+        if (!d) return -1;
+        id = id * kBase + d;
+    }
+    return id;
+}
+
+string unpackCusip(int64_t id) {
+    string cusip(9, ' ');
+    for (int i = 8; i >= 0; --i) {
+        int64_t d = id % kBase;
+        if (d <= 0) return "";
+        cusip[i] = kAlphabet[d - 1];
+        id /= kBase;
+    }
+    return id == 0 ? cusip : "";
+}
+
+bool registerCusipFunctions(sqlite3* db) {
+    if (sqlite3_create_function(db, "pack_cusip", 1, SQLITE_UTF8 | SQLITE_DETERMINISTIC, nullptr, packCusipSql,
+                                nullptr, nullptr) != SQLITE_OK) {
+        cerr << "SQL error: " << sqlite3_errmsg(db) << endl;
+        return false;
+    }
+    return true;
+}
+
+SecurityTable::SecurityTable(sqlite3* db) : db_(db) {}
+
+SecurityTable::~SecurityTable() {
+    sqlite3_finalize(upsert_);
+    sqlite3_finalize(selectOther_);
+    sqlite3_finalize(insertOther_);
+}
+
+bool SecurityTable::prepare() {
+    if (upsert_) return true;
+
+    struct { sqlite3_stmt** stmt; const char* sql; } statements[] = {
+        // Fills in a name or title an earlier filing left out
+        {&upsert_,
+         "INSERT INTO securities (id, cusip, name_of_issuer, title_of_class) VALUES (?, ?, ?, ?) "
+         "ON CONFLICT(id) DO UPDATE SET name_of_issuer = COALESCE(name_of_issuer, excluded.name_of_issuer), "
+         "title_of_class = COALESCE(title_of_class, excluded.title_of_class);"},
+        {&selectOther_,
+         "SELECT id FROM securities WHERE cusip = ?;"},
+        {&insertOther_,
+         "INSERT INTO securities (id, cusip, name_of_issuer, title_of_class) "
+         "VALUES ((SELECT MIN(COALESCE(MIN(id), 0), 0) - 1 FROM securities), ?, ?, ?) RETURNING id;"},
+    };
+    for (auto& s : statements) {
+        if (sqlite3_prepare_v3(db_, s.sql, -1, SQLITE_PREPARE_PERSISTENT, s.stmt, nullptr) != SQLITE_OK) {
+            cerr << "SQL error: " << sqlite3_errmsg(db_) << endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+int64_t SecurityTable::intern(const Holding& h) {
+    int64_t id = packCusip(h.cusip);
+    if (id > 0 && known_.count(id)) return id;
+    if (id < 0) {
+        auto it = others_.find(h.cusip);
+        if (it != others_.end()) return it->second;
+    }
+    if (!prepare()) return 0;
+
+    if (id > 0) {
+        sqlite3_bind_int64(upsert_, 1, id);
+        sqlite3_bind_text(upsert_, 2, h.cusip.c_str(), static_cast<int>(h.cusip.size()), SQLITE_STATIC);
+        bindOptional(upsert_, 3, h.nameOfIssuer);
+        bindOptional(upsert_, 4, h.titleOfClass);
+        bool ok = sqlite3_step(upsert_) == SQLITE_DONE;
+        if (!ok) cerr << "SQL error: " << sqlite3_errmsg(db_) << endl;
+        sqlite3_reset(upsert_);
+        if (!ok) return 0;
+        known_.insert(id);
+        return id;
+    }
+
+    id = 0;
+    sqlite3_bind_text(selectOther_, 1, h.cusip.c_str(), static_cast<int>(h.cusip.size()), SQLITE_STATIC);
+    if (sqlite3_step(selectOther_) == SQLITE_ROW) id = sqlite3_column_int64(selectOther_, 0);
+    sqlite3_reset(selectOther_);
+    if (!id) {
+        sqlite3_bind_text(insertOther_, 1, h.cusip.c_str(), static_cast<int>(h.cusip.size()), SQLITE_STATIC);
+        bindOptional(insertOther_, 2, h.nameOfIssuer);
+        bindOptional(insertOther_, 3, h.titleOfClass);
+        if (sqlite3_step(insertOther_) == SQLITE_ROW) id = sqlite3_column_int64(insertOther_, 0);
+        else cerr << "SQL error: " << sqlite3_errmsg(db_) << endl;
+        sqlite3_reset(insertOther_);
+    }
+    if (id) others_.emplace(h.cusip, id);
+    return id;
+}
+
+void SecurityTable::clear() {
+    known_.clear();
+    others_.clear();
+}
@@ -0,0 +1,55 @@
+// securities.h
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <sqlite3.h>
+#include "sec_parser.h"
+
+// A 9-character CUSIP (0-9, A-Z, '*', '@', '#') read as a base-40 number
+// whose digits 1..39 follow ASCII order: ids are positive, sort like the
+// CUSIPs, and one issuer's securities (same first six characters) form a
+// contiguous range. -1 if `cusip` is not of that form.
+int64_t packCusip(std::string_view cusip);
+// Inverse of packCusip; empty for ids it does not produce
+std::string unpackCusip(int64_t id);
+
+// The securities dimension: one row per CUSIP with its issuer name and title
+// of class, referenced by holdings.security_id.
+//
+// Well-formed CUSIPs use their packed value as the id, so a security seen
+// before in this run costs one hash-set probe and no SQL. Anything else
+// (short, lowercase, placeholder CUSIPs) is looked up by text once and given
+// the next negative id. The first name and title filed for a CUSIP are kept.
+class SecurityTable {
+public:
+    explicit SecurityTable(sqlite3* db);
+    ~SecurityTable();
+
+    SecurityTable(const SecurityTable&) = delete;
+    SecurityTable& operator=(const SecurityTable&) = delete;
+
+    // securities.id for the holding's CUSIP, adding the row on first sight;
+    // 0 on error
+    int64_t intern(const Holding& h);
+    // Forgets cached ids, e.g. after the transaction that added them rolled back
+    void clear();
+
+private:
+    bool prepare();
+
+    sqlite3* db_;
+    sqlite3_stmt* upsert_ = nullptr;
+    sqlite3_stmt* selectOther_ = nullptr;
+    sqlite3_stmt* insertOther_ = nullptr;
+
+    std::unordered_set<int64_t> known_;
+    std::unordered_map<std::string, int64_t> others_;
+};
+
+// Registers pack_cusip(text) on the connection: packCusip, NULL for -1
+bool registerCusipFunctions(sqlite3* db);
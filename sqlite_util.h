@@ -0,0 +1,27 @@
+// sqlite_util.h
+
+#pragma once
+
+// Small SQLite helpers shared by the modules that talk to the database
+// directly (schema, storage, columnar_store, holder_index).
+
+#include <iostream>
+#include <string>
+#include <sqlite3.h>
+
+// Runs statements that return no rows; prints the error and the SQL on failure
+inline bool exec(sqlite3* db, const std::string& sql) {
+    char* errMsg = nullptr;
+    if (sqlite3_exec(db, sql.c_str(), nullptr, nullptr, &errMsg) != SQLITE_OK) {
+        std::cerr << "SQL error: " << (errMsg ? errMsg : sqlite3_errmsg(db)) << " (" << sql << ")" << std::endl;
+        sqlite3_free(errMsg);
+        return false;
+    }
+    return true;
+}
+
+// Text of a result column, "" for NULL
+inline const char* columnText(sqlite3_stmt* stmt, int col) {
+    const unsigned char* text = sqlite3_column_text(stmt, col);
+    return text ? reinterpret_cast<const char*>(text) : "";
+}
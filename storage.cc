@@ -0,0 +1,81 @@
+#include "storage.h"
+#include "schema.h"
+#include "sqlite_util.h"
+#include <algorithm>
+#include <cctype>
+#include <iostream>
+
+using namespace std;
+
+namespace {
+
+long long pragmaInt(sqlite3* db, const char* sql) {
+    sqlite3_stmt* stmt;
+    long long v = 0;
+    if (sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr) == SQLITE_OK) {
+        if (sqlite3_step(stmt) == SQLITE_ROW) v = sqlite3_column_int64(stmt, 0);
+        sqlite3_finalize(stmt);
+    }
+    return v;
+}
+
+bool bulkLoadPending(sqlite3* db) {
+    sqlite3_stmt* stmt;
+    bool pending = false;
+    if (sqlite3_prepare_v2(db, "SELECT 1 FROM meta WHERE key = 'bulk_load';", -1, &stmt, nullptr) == SQLITE_OK) {
+        pending = sqlite3_step(stmt) == SQLITE_ROW;
+        sqlite3_finalize(stmt);
+    }
+    return pending;
+}
+
+} // namespace
+
+bool applyStorageProfile(sqlite3* db, const StorageProfile& profile) {
+    sqlite3_busy_timeout(db, profile.busyTimeoutMs);
+
+    // page_size is fixed once the first table exists (and for good under WAL)
+    if (profile.pageSize > 0 && pragmaInt(db, "PRAGMA page_count;") == 0) {
+        if (!exec(db, "PRAGMA page_size = " + to_string(profile.pageSize) + ";")) return false;
+    }
+    if (!exec(db, string("PRAGMA journal_mode = ") + (profile.wal ? "WAL" : "DELETE") + ";")) return false;
+    string synchronous = profile.synchronous;
+    transform(synchronous.begin(), synchronous.end(), synchronous.begin(),
+              [](unsigned char c) { return static_cast<char>(toupper(c)); });
+    if (synchronous != "OFF" && synchronous != "NORMAL" && synchronous != "FULL" && synchronous != "EXTRA") {
+        cerr << "Unknown --sync mode: " << profile.synchronous << " (OFF, NORMAL, FULL or EXTRA)" << endl;
+        return false;
+    }
+    if (!exec(db, "PRAGMA synchronous = " + synchronous + ";")) return false;
+    // Negative cache_size is in KiB
+    if (!exec(db, "PRAGMA cache_size = " + to_string(-static_cast<long long>(profile.cacheSizeMb) * 1024) + ";")) return false;
+    if (!exec(db, "PRAGMA mmap_size = " + to_string(profile.mmapSizeMb * 1024 * 1024) + ";")) return false;
+    return exec(db, "PRAGMA temp_store = MEMORY;");
+}
+
+bool beginBulkLoad(sqlite3* db) {
+    if (!exec(db, "BEGIN IMMEDIATE;")) return false;
+    if (!exec(db, "INSERT OR REPLACE INTO meta (key, value) VALUES ('bulk_load', 1);") || !dropSecondaryIndexes(db)) {
+        exec(db, "ROLLBACK;");
+        return false;
+    }
+    return exec(db, "COMMIT;");
+}
+
+bool endBulkLoad(sqlite3* db) {
+    if (!exec(db, "BEGIN IMMEDIATE;")) return false;
+    if (!createSecondaryIndexes(db) || !exec(db, "DELETE FROM meta WHERE key = 'bulk_load';")) {
+        exec(db, "ROLLBACK;");
+        return false;
+    }
+    if (!exec(db, "COMMIT;")) return false;
+    exec(db, "PRAGMA optimize;");
+    // Fold the load back into the main file so the WAL does not stay huge
+    return exec(db, "PRAGMA wal_checkpoint(TRUNCATE);");
+}
+
+bool resumeBulkLoad(sqlite3* db) {
+    if (!bulkLoadPending(db)) return true;
+    cout << "Rebuilding indexes dropped by an unfinished --bulk-load run..." << endl;
+    return endBulkLoad(db);
+}
@@ -0,0 +1,28 @@
+// storage.h
+
+#pragma once
+
+#include <string>
+#include <sqlite3.h>
+
+// Connection settings for holdings.db
+struct StorageProfile {
+    bool wal = true;                      // readers keep querying while a quarter loads
+    std::string synchronous = "NORMAL";   // OFF, NORMAL, FULL or EXTRA; NORMAL is durable enough under WAL
+    int pageSize = 16384;                 // only takes effect on a new database
+    int cacheSizeMb = 256;
+    long long mmapSizeMb = 1024;
+    int busyTimeoutMs = 5000;
+};
+
+bool applyStorageProfile(sqlite3* db, const StorageProfile& profile);
+
+// Bulk-load mode drops the secondary holdings indexes so inserts only touch
+// the table and its UNIQUE key, then rebuilds them once at the end. A
+// bulk_load row in meta marks the indexes as dropped until then, so a run
+// that dies midway leaves them to resumeBulkLoad.
+bool beginBulkLoad(sqlite3* db);
+bool endBulkLoad(sqlite3* db);
+// Rebuilds the indexes of a bulk load that never finished; call after
+// migrateSchema, before writing
+bool resumeBulkLoad(sqlite3* db);
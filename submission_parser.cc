@@ -0,0 +1,232 @@
+#include "submission_parser.h"
+#include "infotable_parser.h"
+#include <functional>
+#include <iostream>
+
+using namespace std;
+
+namespace {
+
+const size_t kMaxLine = 64 * 1024;
+const size_t kMaxCoverPage = 256 * 1024;
+
+const string_view kXmlOpen = "<XML>";
+const string_view kXmlClose = "</XML>";
+const string_view kDocClose = "</DOCUMENT>";
+
+string_view trimView(string_view s) {
+    while (!s.empty() && (s.front() == ' ' || s.front() == '\t')) s.remove_prefix(1);
+    while (!s.empty() && (s.back() == ' ' || s.back() == '\t' || s.back() == '\r')) s.remove_suffix(1);
+    return s;
+}
+
+// "20250630" -> "2025-06-30"
+string isoDate(string_view d) {
+    if (d.size() != 8) return string(d);
+    string out(d.substr(0, 4));
+    out += '-';
+    out += d.substr(4, 2);
+    out += '-';
+    out += d.substr(6, 2);
+    return out;
+}
+
+// "06-30-2025" -> "2025-06-30"
+string isoDateMdy(const string& d) {
+    if (d.size() != 10 || d[2] != '-' || d[5] != '-') return d;
+    return d.substr(6, 4) + "-" + d.substr(0, 2) + "-" + d.substr(3, 2);
+}
+
+// Text of the first <...name>value</...> in xml, namespace prefix ignored
+string elementText(const string& xml, string_view name) {
+    size_t pos = 0;
+    while ((pos = xml.find(name, pos)) != string::npos) {
+        size_t end = pos + name.size();
+        bool opening = pos > 0 && (xml[pos - 1] == '<' || xml[pos - 1] == ':') && end < xml.size() && xml[end] == '>';
+        if (opening) {
+            size_t close = xml.find('<', end + 1);
+            if (close == string::npos) return "";
+            return string(trimView(string_view(xml).substr(end + 1, close - end - 1)));
+        }
+        pos = end;
+    }
+    return "";
+}
+
+// Runs the bytes `source` produces through a splitter and an information
+// table parser; `source` returns false if it could not deliver them all
+bool readSubmission(const function<bool(const function<bool(const char*, size_t)>&)>& source,
+                    const string& what, SubmissionHeader& header, vector<Holding>& holdings) {
+    holdings.clear();
+    InfoTableParser parser([&](const Holding& h) { holdings.push_back(h); });
+    bool parseError = false;
+    SubmissionSplitter splitter([&](const char* data, size_t len) {
+        if (!parseError && !parser.feed(data, len)) parseError = true;
+    });
+
+    bool ok = source([&](const char* data, size_t len) {
+        splitter.feed(data, len);
+        return !parseError;
+    });
+    splitter.finish();
+    header = splitter.header();
+
+    if (parseError) cerr << "Failed to parse information table in " << what << endl;
+    if (!ok || !splitter.sawInfoTable() || !parser.sawInfoTable() || !parser.finish()) {
+        holdings.clear();
+        return false;
+    }
+    return true;
+}
+
+} // namespace
+
+SubmissionSplitter::SubmissionSplitter(XmlSink onInfoTable) : sink_(std::move(onInfoTable)) {}
+
+void SubmissionSplitter::feed(const char* data, size_t len) {
+    pending_.append(data, len);
+    size_t pos = 0;
+    while (pos < pending_.size()) {
+        if (state_ == State::DocText) {
+            size_t next = scanText(pos);
+            if (next == pos) break;
+            pos = next;
+            continue;
+        }
+        size_t nl = pending_.find('\n', pos);
+        if (nl == string::npos) {
+            // A header line this long is not SGML; drop it rather than grow
+            if (pending_.size() - pos > kMaxLine) pos = pending_.size();
+            break;
+        }
+        handleLine(string_view(pending_).substr(pos, nl - pos));
+        pos = nl + 1;
+    }
+    pending_.erase(0, pos);
+}
+
+void SubmissionSplitter::finish() {
+    if (state_ != State::DocText && !pending_.empty()) handleLine(pending_);
+    pending_.clear();
+}
+
+void SubmissionSplitter::handleLine(string_view line) {
+    line = trimView(line);
+    if (state_ == State::Header) {
+        if (line == "</SEC-HEADER>") {
+            state_ = State::Outside;
+            return;
+        }
+        size_t colon = line.find(':');
+        if (colon == string_view::npos) return;
+        string_view key = trimView(line.substr(0, colon));
+        string_view value = trimView(line.substr(colon + 1));
+        if (key == "ACCESSION NUMBER") header_.accession = value;
+        else if (key == "CONFORMED SUBMISSION TYPE") header_.formType = value;
+        else if (key == "CONFORMED PERIOD OF REPORT") header_.periodOfReport = isoDate(value);
+        else if (key == "FILED AS OF DATE") header_.filedAsOf = isoDate(value);
+        // The filer comes first; later CIKs belong to other parties
+        else if (key == "CENTRAL INDEX KEY" && header_.cik.empty()) header_.cik = value;
+        else if (key == "COMPANY CONFORMED NAME" && header_.companyName.empty()) header_.companyName = value;
+        return;
+    }
+
+    if (state_ == State::Outside) {
+        if (line == "<DOCUMENT>") {
+            state_ = State::DocHeader;
+            doc_ = Doc::Other;
+            ++documents_;
+        }
+        return;
+    }
+
+    // DocHeader: <TYPE>, <SEQUENCE>, <FILENAME>, <DESCRIPTION> up to <TEXT>
+    if (line.substr(0, 6) == "<TYPE>") {
+        string_view type = trimView(line.substr(6));
+        if (type == "INFORMATION TABLE") doc_ = Doc::InfoTable;
+        else if (type.substr(0, 3) == "13F") doc_ = Doc::CoverPage;
+    } else if (line == "<TEXT>") {
+        state_ = State::DocText;
+        phase_ = Phase::BeforeXml;
+        if (doc_ == Doc::InfoTable) sawInfoTable_ = true;
+    } else if (line == kDocClose) {
+        endDocument();
+    }
+}
+
+// Consumes document body from pending_[pos]; returns where it stopped. Up to
+// one marker's length is left unconsumed when no marker is found, in case it
+// straddles two chunks.
+size_t SubmissionSplitter::scanText(size_t pos) {
+    string_view buf(pending_);
+    if (phase_ == Phase::InXml) {
+        size_t xmlEnd = buf.find(kXmlClose, pos);
+        size_t stop = xmlEnd != string_view::npos ? xmlEnd
+                    : buf.size() >= pos + kXmlClose.size() ? buf.size() - kXmlClose.size() + 1
+                    : pos;
+        if (stop > pos) {
+            if (doc_ == Doc::InfoTable) {
+                sink_(buf.data() + pos, stop - pos);
+            } else if (doc_ == Doc::CoverPage && coverPage_.size() < kMaxCoverPage) {
+                coverPage_.append(buf.data() + pos, stop - pos);
+            }
+        }
+        if (xmlEnd == string_view::npos) return stop;
+        phase_ = Phase::AfterXml;
+        return xmlEnd + kXmlClose.size();
+    }
+
+    size_t docEnd = buf.find(kDocClose, pos);
+    if (phase_ == Phase::BeforeXml && doc_ != Doc::Other) {
+        size_t xmlStart = buf.find(kXmlOpen, pos);
+        if (xmlStart != string_view::npos && (docEnd == string_view::npos || xmlStart < docEnd)) {
+            phase_ = Phase::InXml;
+            return xmlStart + kXmlOpen.size();
+        }
+    }
+
+    if (docEnd != string_view::npos) {
+        endDocument();
+        return docEnd + kDocClose.size();
+    }
+    return buf.size() >= pos + kDocClose.size() ? buf.size() - kDocClose.size() + 1 : pos;
+}
+
+void SubmissionSplitter::endDocument() {
+    if (doc_ == Doc::CoverPage) parseCoverPage(coverPage_, header_);
+    coverPage_.clear();
+    doc_ = Doc::Other;
+    state_ = State::Outside;
+}
+
+void parseCoverPage(const string& xml, SubmissionHeader& header) {
+    auto fill = [](string& field, string value) {
+        if (field.empty()) field = std::move(value);
+    };
+    fill(header.formType, elementText(xml, "submissionType"));
+    fill(header.cik, elementText(xml, "cik"));
+    // filingManager's <name> precedes other managers' and the signer's
+    fill(header.companyName, elementText(xml, "name"));
+    fill(header.periodOfReport, isoDateMdy(elementText(xml, "periodOfReport")));
+    fill(header.filedAsOf, isoDateMdy(elementText(xml, "signatureDate")));
+    fill(header.amendmentType, elementText(xml, "amendmentType"));
+}
+
+string submissionUrl(const FilingRef& filing) {
+    if (filing.accession.empty()) return "";
+    return filing.folderUrl + filing.accession + ".txt";
+}
+
+bool fetchSubmission(const string& url, SubmissionHeader& header, vector<Holding>& holdings) {
+    return readSubmission([&](const function<bool(const char*, size_t)>& onChunk) {
+        return fetchURLStreaming(url, onChunk);
+    }, url, header, holdings);
+}
+
+bool parseSubmission(const char* data, size_t len, const string& name, SubmissionHeader& header,
+                     vector<Holding>& holdings) {
+    return readSubmission([&](const function<bool(const char*, size_t)>& onChunk) {
+        onChunk(data, len);
+        return true;
+    }, name, header, holdings);
+}
@@ -0,0 +1,78 @@
+// submission_parser.h
+
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <vector>
+#include "idx_scanner.h"
+#include "sec_parser.h"
+
+// Metadata from a full submission's <SEC-HEADER> and 13F cover page
+struct SubmissionHeader {
+    std::string accession;
+    std::string formType;        // CONFORMED SUBMISSION TYPE
+    std::string periodOfReport;  // YYYY-MM-DD
+    std::string filedAsOf;       // YYYY-MM-DD
+    std::string cik;             // filer's CENTRAL INDEX KEY, leading zeros kept
+    std::string companyName;
+    std::string amendmentType;   // RESTATEMENT or NEW HOLDINGS, amendments only
+};
+
+// Streaming splitter for EDGAR full-text submissions (<accession>.txt).
+//
+// The header is read line by line. Each <DOCUMENT> is classified by its
+// <TYPE>; the body of the INFORMATION TABLE between <XML> and </XML> is
+// passed to the sink as it arrives, without being buffered. The 13F cover
+// page is kept (it is a few KB) only to read its amendment type. Every other
+// document is skipped.
+class SubmissionSplitter {
+public:
+    using XmlSink = std::function<void(const char*, size_t)>;
+
+    explicit SubmissionSplitter(XmlSink onInfoTable);
+
+    void feed(const char* data, size_t len);
+    void finish();
+
+    const SubmissionHeader& header() const { return header_; }
+    bool sawInfoTable() const { return sawInfoTable_; }
+    size_t documents() const { return documents_; }
+
+private:
+    enum class State { Header, Outside, DocHeader, DocText };
+    enum class Doc { Other, CoverPage, InfoTable };
+    enum class Phase { BeforeXml, InXml, AfterXml };
+
+    void handleLine(std::string_view line);
+    size_t scanText(size_t pos);
+    void endDocument();
+
+    XmlSink sink_;
+    std::string pending_;    // bytes not yet consumed
+    State state_ = State::Header;
+    Doc doc_ = Doc::Other;
+    Phase phase_ = Phase::BeforeXml;
+    std::string coverPage_;
+
+    SubmissionHeader header_;
+    bool sawInfoTable_ = false;
+    size_t documents_ = 0;
+};
+
+// Fills the empty fields of `header` from a 13F cover page (primary_doc.xml):
+// filing manager name, CIK, submission and amendment type, period of report,
+// and the signature date standing in for the filing date
+void parseCoverPage(const std::string& xml, SubmissionHeader& header);
+
+// https://www.sec.gov/Archives/edgar/data/<cik>/<accession without dashes>/<accession>.txt
+std::string submissionUrl(const FilingRef& filing);
+
+// Downloads a full submission in one request, parsing its information table
+// while it streams. False if the fetch failed or there was no table.
+bool fetchSubmission(const std::string& url, SubmissionHeader& header, std::vector<Holding>& holdings);
+// Same for a submission already in memory, e.g. a .nc entry of a feed archive;
+// `name` only labels error messages
+bool parseSubmission(const char* data, size_t len, const std::string& name, SubmissionHeader& header,
+                     std::vector<Holding>& holdings);
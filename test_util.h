@@ -0,0 +1,63 @@
+// test_util.h
+
+#pragma once
+
+// Helpers for the ctest programs (*_test.cc): failure counting, one-value
+// queries on holdings.db and running FinanceApp in a scratch directory.
+
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <sqlite3.h>
+
+inline int testFailures = 0;
+
+template <typename T, typename U>
+void expectEqual(const T& actual, const U& expected, const std::string& what) {
+    if (actual == expected) return;
+    std::cerr << "FAILED: " << what << ": got " << actual << ", expected " << expected << std::endl;
+    ++testFailures;
+}
+
+// First column of the first row, or -1 when the query fails or returns nothing
+inline long long queryInt(sqlite3* db, const std::string& sql) {
+    sqlite3_stmt* stmt;
+    if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr) != SQLITE_OK) {
+        std::cerr << "Query failed: " << sqlite3_errmsg(db) << ": " << sql << std::endl;
+        return -1;
+    }
+    long long value = sqlite3_step(stmt) == SQLITE_ROW ? sqlite3_column_int64(stmt, 0) : -1;
+    sqlite3_finalize(stmt);
+    return value;
+}
+
+// A fresh directory under the system temp dir, removed by the destructor
+struct ScratchDir {
+    std::filesystem::path path;
+
+    explicit ScratchDir(const std::string& name)
+        : path(std::filesystem::temp_directory_path() /
+               (name + "-" + std::to_string(std::chrono::steady_clock::now().time_since_epoch().count()))) {
+        std::filesystem::remove_all(path);
+        std::filesystem::create_directories(path);
+    }
+    ~ScratchDir() {
+        std::error_code ec;
+        std::filesystem::remove_all(path, ec);
+    }
+};
+
+// Single-quoted for the shell; the paths the tests use hold no quotes
+inline std::string quoted(const std::string& word) {
+    return "'" + word + "'";
+}
+
+// Runs `program` inside `dir` through the shell; `args` goes in as is, so
+// quote paths with quoted(). True when it exits with status 0
+inline bool runIn(const std::filesystem::path& dir, const std::string& program, const std::string& args) {
+    std::string command = "cd " + quoted(dir.string()) + " && " + quoted(program) + " " + args;
+    std::cout << "$ " << command << std::endl;
+    return std::system(command.c_str()) == 0;
+}